@@ -0,0 +1,47 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A replacement for the global operator new which counts its calls, for the
+tests and benchmarks which check how often we allocate.  A program may
+replace operator new only once, so include this from just one of its
+translation units.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/* The number of calls to the global operator new so far. */
+static std::size_t alloc_count = 0;
+
+void *operator new(std::size_t size) {
+  ++alloc_count;
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }  // if
+  throw std::bad_alloc();
+}
+
+/* Kept out of line, lest gcc, seeing free() inlined where the memory came
+   from operator new, warn of a mismatch. */
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  operator delete(ptr);
+}
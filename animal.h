@@ -1,5 +1,6 @@
 #pragma once
 
+#include "horse.h"
 #include "variant.h"
 
 // ---------------------------------------------------------------------------
@@ -20,21 +21,12 @@ struct cat_t {
 // ---------------------------------------------------------------------------
 
 
-// ---------------------------------------------------------------------------
-// "horse.h"
-
-struct horse_t {
-  // stuff about neighing, running fast, and carrying people and cargo
-};
-// ---------------------------------------------------------------------------
-
 // ---------------------------------------------------------------------------
 // "animal.h"
 
 /*
 #include "dog.h"
 #include "cat.h"
-#include "horse.h"
 */
 
 using animal_t = cppcon14::variant::variant_t<dog_t, cat_t, horse_t>;
@@ -0,0 +1,150 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Poll a published variant from 1 to 32 reader threads while one writer keeps
+publishing new values, and report the total loads per second.  We compare
+each strategy of atomic_variant_t (one word, two words and sequence lock)
+against a variant_t guarded by a mutex.
+
+Usage: atomic_variant.bench [ms per run]
+--------------------------------------------------------------------------- */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "atomic_variant.h"
+#include "bench.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* Status values of three sizes, each made from just its code. */
+struct small_t {
+  explicit small_t(uint32_t code = 0) : code(code) {}
+  uint32_t code;
+};
+
+struct medium_t {
+  explicit medium_t(uint32_t code = 0) : code(code), a(0), b(0) {}
+  uint32_t code, a, b;
+};
+
+struct large_t {
+  explicit large_t(uint64_t code = 0) : code(code), a(0), b(0), c(0) {}
+  uint64_t code, a, b, c;
+};
+
+/* A variant_t guarded by a mutex, with the same interface as an
+   atomic_variant_t. */
+template <typename... elems_t>
+class locked_variant_t final {
+  public:
+
+  using variant_t = cppcon14::variant::variant_t<elems_t...>;
+
+  explicit locked_variant_t(const variant_t &init) : val(init) {}
+
+  variant_t load() const {
+    lock_guard<mutex> lock(mtx);
+    return val;
+  }
+
+  void store(const variant_t &desired) {
+    lock_guard<mutex> lock(mtx);
+    val = desired;
+  }
+
+  private:
+
+  mutable mutex mtx;
+
+  variant_t val;
+
+};  // locked_variant_t<elems_t...>
+
+/* Sum the codes of whatever we load. */
+struct get_code_t final {
+  using ret_t = uint64_t;
+  uint64_t operator()(uint32_t val) const { return val; }
+  template <typename elem_t>
+  uint64_t operator()(const elem_t &elem) const { return elem.code; }
+};
+
+/* Run the given number of readers against one writer for the given time,
+   and return the total number of loads per second, in millions. */
+template <typename shared_t, typename elem_t>
+static double run(size_t readers, chrono::milliseconds duration) {
+  shared_t shared{typename shared_t::variant_t(elem_t{})};
+  atomic<bool> done{false};
+  vector<uint64_t> counts(readers);
+  vector<thread> threads;
+  threads.emplace_back([&] {
+    for (uint32_t i = 0; !done.load(memory_order_relaxed); ++i) {
+      shared.store(i % 2 ? typename shared_t::variant_t(elem_t{i})
+                         : typename shared_t::variant_t(i));
+    }  // for
+  });
+  for (size_t i = 0; i < readers; ++i) {
+    threads.emplace_back([&, i] {
+      uint64_t count = 0, sum = 0;
+      while (!done.load(memory_order_relaxed)) {
+        sum += apply(get_code_t(), shared.load());
+        ++count;
+      }  // while
+      keep(sum);
+      counts[i] = count;
+    });
+  }  // for
+  this_thread::sleep_for(duration);
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }  // for
+  uint64_t total = 0;
+  for (uint64_t count : counts) {
+    total += count;
+  }  // for
+  return total / chrono::duration<double>(duration).count() / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  chrono::milliseconds duration(get_size(argc, argv, 200));
+  cout << "millions of loads per second, with one writer" << endl
+       << setw(8) << "readers" << setw(12) << "1 word" << setw(12)
+       << "2 words" << setw(12) << "seqlock" << setw(12) << "mutex" << endl;
+  for (size_t readers = 1; readers <= 32; readers *= 2) {
+    cout << setw(8) << readers << fixed << setprecision(2) << setw(12)
+         << run<atomic_variant_t<uint32_t, small_t>, small_t>(
+                readers, duration)
+         << setw(12)
+         << run<atomic_variant_t<uint32_t, medium_t>, medium_t>(
+                readers, duration)
+         << setw(12)
+         << run<atomic_variant_t<uint32_t, large_t>, large_t>(
+                readers, duration)
+         << setw(12)
+         << run<locked_variant_t<uint32_t, large_t>, large_t>(
+                readers, duration)
+         << endl;
+  }  // for
+  return 0;
+}
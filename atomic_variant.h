@@ -0,0 +1,372 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A variant which many threads can load, store and compare-and-exchange at
+once, without a mutex.
+
+A variant_t itself can't be updated atomically: its tag and its contents are
+separate words, and it has a vtable besides.  So an atomic_variant_t keeps
+its value packed into a few 64-bit words instead: the bytes of the contents,
+followed by the index of their type in the last byte.  Loading unpacks the
+words into a variant_t and storing packs a variant_t into words.  This is
+only sound if the types are trivially copyable, so we insist on that.
+
+How the words are kept depends on how many there are:
+
+  * 1 word (contents of up to 7 bytes) is a std::atomic<uint64_t>, so every
+    operation is lock-free and loads are plain reads.
+  * 2 words (contents of up to 15 bytes) are updated with a double-width
+    compare-and-swap (cmpxchg16b, on x86-64).  Every operation is lock-free,
+    but loading is a compare-and-swap too, so readers write to the cache
+    line they share.  This needs compiler support, which for gcc and clang on
+    x86-64 means -mcx16; without it, we fall back as for 3+ words.
+    Note that the index takes up a byte of the 16, so contents of exactly
+    16 bytes, such as a pair of 64-bit ints, need 3 words, and so the
+    sequence lock.  Check is_always_lock_free if it matters.
+  * 3 or more words are guarded by a sequence lock.  Readers never write;
+    they read the sequence number, copy the words, and try again if the
+    sequence number changed or was odd, meaning a writer was busy.  Writers
+    exclude each other by making the sequence number odd, so they aren't
+    lock-free.
+
+Compare-and-exchange compares the packed words, so, like std::atomic, it
+compares object representations, not values.  Padding within the contents
+takes part in the comparison.
+
+See "atomic_variant.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace variant {
+
+/* The words of an atomic_variant_t, packed as described above.  The number
+   of words selects the strategy. */
+template <size_t size>
+struct atomic_words_t final {
+  uint64_t words[size];
+};
+
+/* How an atomic_variant_t keeps its words, with specializations per
+   strategy.  This is the general case: a sequence lock. */
+template <size_t size>
+class atomic_cell_t final {
+  public:
+
+  using words_t = atomic_words_t<size>;
+
+  static constexpr bool is_always_lock_free = false;
+
+  explicit atomic_cell_t(const words_t &init) noexcept {
+    for (size_t i = 0; i < size; ++i) {
+      words[i].store(init.words[i], std::memory_order_relaxed);
+    }  // for
+  }
+
+  words_t load() const noexcept {
+    words_t result;
+    for (;;) {
+      uint64_t before = seq.load(std::memory_order_acquire);
+      if (!(before & 1)) {
+        copy_out(result);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == before) {
+          return result;
+        }  // if
+      }  // if
+    }  // for
+  }
+
+  void store(const words_t &desired) noexcept {
+    uint64_t before = lock();
+    copy_in(desired);
+    seq.store(before + 2, std::memory_order_release);
+  }
+
+  bool compare_exchange(words_t &expected, const words_t &desired) noexcept {
+    uint64_t before = lock();
+    words_t actual;
+    copy_out(actual);
+    if (std::memcmp(&actual, &expected, sizeof(words_t)) != 0) {
+      seq.store(before, std::memory_order_release);
+      expected = actual;
+      return false;
+    }  // if
+    copy_in(desired);
+    seq.store(before + 2, std::memory_order_release);
+    return true;
+  }
+
+  private:
+
+  /* Wait until no other writer is busy, then make the sequence number odd.
+     Returns the (even) sequence number from before.  Taking the lock
+     acquires the previous writer's release of it, so we see its words; the
+     fence after keeps our writes to the words from moving above the odd
+     sequence number, for the readers' sake. */
+  uint64_t lock() noexcept {
+    uint64_t before = seq.load(std::memory_order_relaxed);
+    for (;;) {
+      if (!(before & 1) &&
+          seq.compare_exchange_weak(before, before + 1,
+                                    std::memory_order_acquire,
+                                    std::memory_order_relaxed)) {
+        break;
+      }  // if
+      before = seq.load(std::memory_order_relaxed);
+    }  // for
+    std::atomic_thread_fence(std::memory_order_release);
+    return before;
+  }
+
+  /* Copy our words out, without regard to writers. */
+  void copy_out(words_t &that) const noexcept {
+    for (size_t i = 0; i < size; ++i) {
+      that.words[i] = words[i].load(std::memory_order_relaxed);
+    }  // for
+  }
+
+  /* Copy words in; the caller must hold the lock. */
+  void copy_in(const words_t &that) noexcept {
+    for (size_t i = 0; i < size; ++i) {
+      words[i].store(that.words[i], std::memory_order_relaxed);
+    }  // for
+  }
+
+  /* Odd while a writer is busy.  Bumped by 2 for every write. */
+  std::atomic<uint64_t> seq{0};
+
+  /* Our value. */
+  std::atomic<uint64_t> words[size];
+
+};  // atomic_cell_t<size>
+
+/* One word, kept in a std::atomic. */
+template <>
+class atomic_cell_t<1> final {
+  public:
+
+  using words_t = atomic_words_t<1>;
+
+  static constexpr bool is_always_lock_free = true;
+
+  explicit atomic_cell_t(const words_t &init) noexcept : word(init.words[0]) {}
+
+  words_t load() const noexcept {
+    return { { word.load(std::memory_order_acquire) } };
+  }
+
+  void store(const words_t &desired) noexcept {
+    word.store(desired.words[0], std::memory_order_release);
+  }
+
+  bool compare_exchange(words_t &expected, const words_t &desired) noexcept {
+    return word.compare_exchange_strong(expected.words[0], desired.words[0],
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire);
+  }
+
+  private:
+
+  std::atomic<uint64_t> word;
+
+};  // atomic_cell_t<1>
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+/* Two words, kept in a 16-byte integer and updated with the double-width
+   compare-and-swap.  We use the __sync builtins, because gcc inlines those,
+   whereas it turns the __atomic ones into calls to libatomic, which may
+   lock. */
+template <>
+class atomic_cell_t<2> final {
+  public:
+
+  using words_t = atomic_words_t<2>;
+
+  static constexpr bool is_always_lock_free = true;
+
+  explicit atomic_cell_t(const words_t &init) noexcept : pair(pack(init)) {}
+
+  words_t load() const noexcept {
+    /* Swapping zero for zero reads the pair atomically, whatever it is. */
+    return unpack(__sync_val_compare_and_swap(
+        const_cast<pair_t *>(&pair), pair_t(0), pair_t(0)));
+  }
+
+  void store(const words_t &desired) noexcept {
+    /* Guess zero; the first failure tells us what's really there. */
+    pair_t expected = 0, next = pack(desired);
+    for (;;) {
+      pair_t actual = __sync_val_compare_and_swap(&pair, expected, next);
+      if (actual == expected) {
+        break;
+      }  // if
+      expected = actual;
+    }  // for
+  }
+
+  bool compare_exchange(words_t &expected, const words_t &desired) noexcept {
+    pair_t want = pack(expected);
+    pair_t actual = __sync_val_compare_and_swap(&pair, want, pack(desired));
+    if (actual == want) {
+      return true;
+    }  // if
+    expected = unpack(actual);
+    return false;
+  }
+
+  private:
+
+  using pair_t = unsigned __int128;
+
+  static pair_t pack(const words_t &that) noexcept {
+    return (pair_t(that.words[1]) << 64) | that.words[0];
+  }
+
+  static words_t unpack(pair_t that) noexcept {
+    return { { uint64_t(that), uint64_t(that >> 64) } };
+  }
+
+  alignas(16) pair_t pair;
+
+};  // atomic_cell_t<2>
+#endif
+
+/* A variant of the given trivially copyable types which may be loaded,
+   stored and compare-and-exchanged by many threads at once. */
+template <typename... elems_t>
+class atomic_variant_t final {
+  public:
+
+  /* The type of variant we load and store. */
+  using variant_t = variant::variant_t<elems_t...>;
+
+  static_assert(all_of<std::is_trivially_copyable<elems_t>::value...>::value,
+                "The types of an atomic variant must be trivially copyable.");
+
+  /* The number of bytes we need for contents, plus 1 for the index. */
+  static constexpr size_t packed_size =
+      lib::max({sizeof(elems_t)...}) + 1;
+
+  /* The number of 64-bit words into which we pack our value. */
+  static constexpr size_t word_count = (packed_size + 7) / 8;
+
+  /* True iff. our operations are lock-free, for this choice of types. */
+  static constexpr bool is_always_lock_free =
+      atomic_cell_t<word_count>::is_always_lock_free;
+
+  /* No copying or moving. */
+  atomic_variant_t(const atomic_variant_t &) = delete;
+  atomic_variant_t &operator=(const atomic_variant_t &) = delete;
+
+  /* Start off with the given value. */
+  explicit atomic_variant_t(const variant_t &init) : cell(pack(init)) {}
+
+  /* Our value. */
+  variant_t load() const {
+    assert(this);
+    return unpack(cell.load());
+  }
+
+  /* Take on a new value. */
+  void store(const variant_t &desired) {
+    assert(this);
+    cell.store(pack(desired));
+  }
+
+  /* If our value is the expected one, take on the desired value and return
+     true; otherwise, update the expected value to our value and return
+     false. */
+  bool compare_exchange(variant_t &expected, const variant_t &desired) {
+    assert(this);
+    words_t words = pack(expected);
+    if (cell.compare_exchange(words, pack(desired))) {
+      return true;
+    }  // if
+    expected = unpack(words);
+    return false;
+  }
+
+  private:
+
+  using words_t = atomic_words_t<word_count>;
+
+  /* Used by pack() to copy the contents of a variant. */
+  struct packer_t final {
+
+    using ret_t = void;
+
+    template <typename elem_t>
+    void operator()(const elem_t &elem) const {
+      std::memcpy(&words, &elem, sizeof(elem_t));
+    }
+
+    words_t &words;
+
+  };  // packer_t
+
+  /* The words for a variant: its contents, padded with zeros, then its
+     index in the last byte. */
+  static words_t pack(const variant_t &that) {
+    words_t words = {};
+    apply(packer_t{words}, that);
+    reinterpret_cast<unsigned char *>(&words)[sizeof(words_t) - 1] =
+        static_cast<unsigned char>(that.get_index());
+    return words;
+  }
+
+  /* The variant for some words. */
+  static variant_t unpack(const words_t &words) {
+    static constexpr variant_t (*const unpackers[])(const words_t &) = {
+      &unpack_as<elems_t>...
+    };
+    return unpackers[reinterpret_cast<const unsigned char *>(
+        &words)[sizeof(words_t) - 1]](words);
+  }
+
+  /* An entry in the table used by unpack(), above. */
+  template <typename elem_t>
+  static variant_t unpack_as(const words_t &words) {
+    typename std::aligned_storage<sizeof(elem_t), alignof(elem_t)>::type elem;
+    std::memcpy(&elem, &words, sizeof(elem_t));
+    return variant_t(*reinterpret_cast<const elem_t *>(&elem));
+  }
+
+  /* Our value, packed. */
+  atomic_cell_t<word_count> cell;
+
+};  // atomic_variant_t<elems_t...>
+
+template <typename... elems_t>
+constexpr size_t atomic_variant_t<elems_t...>::packed_size;
+
+template <typename... elems_t>
+constexpr size_t atomic_variant_t<elems_t...>::word_count;
+
+template <typename... elems_t>
+constexpr bool atomic_variant_t<elems_t...>::is_always_lock_free;
+
+}  // variant
+}  // cppcon14
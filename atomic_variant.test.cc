@@ -0,0 +1,161 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the atomic variant in "atomic_variant.h".
+--------------------------------------------------------------------------- */
+
+#include "atomic_variant.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+
+/* A small value which is torn if its thirds don't agree. */
+struct trio_t {
+  uint32_t a, b, c;
+  bool is_torn() const { return b != ~a || c != (a ^ 0x55555555); }
+};
+
+/* A larger value which is torn if its thirds don't agree. */
+struct triple_t {
+  uint64_t a, b, c;
+  bool is_torn() const { return b != a + 1 || c != a + 2; }
+};
+
+/* A value of exactly 16 bytes. */
+struct pair_t {
+  uint64_t a, b;
+};
+
+/* One word, two words and a sequence lock. */
+using small_t = atomic_variant_t<int32_t, uint16_t, null_t>;
+using medium_t = atomic_variant_t<uint32_t, trio_t>;
+using large_t = atomic_variant_t<uint32_t, triple_t>;
+
+/* 16 bytes of contents leave no room in 2 words for the index. */
+using pair_var_t = atomic_variant_t<uint32_t, pair_t>;
+static_assert(pair_var_t::word_count == 3 &&
+              !pair_var_t::is_always_lock_free,
+              "16 bytes of contents should take the sequence lock.");
+
+FIXTURE(atomic_strategies) {
+  EXPECT_EQ(small_t::word_count, 1u);
+  EXPECT_EQ(medium_t::word_count, 2u);
+  EXPECT_EQ(large_t::word_count, 4u);
+  EXPECT_EQ(pair_var_t::word_count, 3u);
+  EXPECT_TRUE(small_t::is_always_lock_free);
+  EXPECT_FALSE(large_t::is_always_lock_free);
+  EXPECT_FALSE(pair_var_t::is_always_lock_free);
+  pair_var_t pair(pair_var_t::variant_t(pair_t{1, 2}));
+  EXPECT_EQ(pair.load().as<pair_t>().b, 2u);
+}
+
+FIXTURE(atomic_load_store) {
+  small_t a(small_t::variant_t(int32_t(101)));
+  EXPECT_EQ(a.load().as<int32_t>(), 101);
+  a.store(uint16_t(7));
+  EXPECT_EQ(a.load().as<uint16_t>(), 7);
+  a.store(null_t());
+  EXPECT_FALSE(a.load());
+  large_t b(large_t::variant_t(triple_t{1, 2, 3}));
+  EXPECT_EQ(b.load().as<triple_t>().c, 3u);
+  b.store(uint32_t(5));
+  EXPECT_EQ(b.load().as<uint32_t>(), 5u);
+}
+
+FIXTURE(atomic_compare_exchange) {
+  small_t a(small_t::variant_t(int32_t(101)));
+  small_t::variant_t expected = int32_t(202);
+  EXPECT_FALSE(a.compare_exchange(expected, int32_t(303)));
+  EXPECT_EQ(expected.as<int32_t>(), 101);
+  EXPECT_TRUE(a.compare_exchange(expected, uint16_t(7)));
+  EXPECT_EQ(a.load().as<uint16_t>(), 7);
+  /* The same bytes, but a different type, don't match. */
+  expected = int32_t(7);
+  EXPECT_FALSE(a.compare_exchange(expected, int32_t(0)));
+}
+
+/* Writers store untorn values while readers check that they never see a
+   torn one. */
+template <typename atomic_t, typename elem_t, typename make_t>
+static bool stress_tearing(make_t make) {
+  atomic_t shared{typename atomic_t::variant_t(make(0))};
+  std::atomic<bool> torn{false}, done{false};
+  vector<thread> threads;
+  for (int i = 0; i < 2; ++i) {
+    threads.emplace_back([&, i] {
+      for (uint64_t j = 0; j < 20000; ++j) {
+        shared.store(make(j * 2 + i));
+      }
+    });
+  }
+  for (int i = 0; i < 2; ++i) {
+    threads.emplace_back([&] {
+      while (!done) {
+        if (shared.load().template as<elem_t>().is_torn()) {
+          torn = true;
+        }
+      }
+    });
+  }
+  threads[0].join();
+  threads[1].join();
+  done = true;
+  threads[2].join();
+  threads[3].join();
+  return !torn;
+}
+
+FIXTURE(atomic_stress_tearing) {
+  EXPECT_TRUE((stress_tearing<medium_t, trio_t>([](uint64_t i) {
+    auto a = static_cast<uint32_t>(i);
+    return trio_t{a, ~a, a ^ 0x55555555};
+  })));
+  EXPECT_TRUE((stress_tearing<large_t, triple_t>(
+      [](uint64_t i) { return triple_t{i, i + 1, i + 2}; })));
+}
+
+/* Threads count up together by compare-and-exchange, so no increment may be
+   lost. */
+template <typename atomic_t>
+static uint32_t stress_counting(size_t thread_count, uint32_t per_thread) {
+  atomic_t shared{typename atomic_t::variant_t(uint32_t(0))};
+  vector<thread> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&] {
+      auto expected = shared.load();
+      for (uint32_t j = 0; j < per_thread; ++j) {
+        while (!shared.compare_exchange(
+            expected, uint32_t(expected.template as<uint32_t>() + 1))) {}
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return shared.load().template as<uint32_t>();
+}
+
+FIXTURE(atomic_stress_counting) {
+  EXPECT_EQ((stress_counting<atomic_variant_t<uint32_t, uint16_t>>(4, 10000)),
+            40000u);
+  EXPECT_EQ(stress_counting<medium_t>(4, 10000), 40000u);
+  EXPECT_EQ(stress_counting<large_t>(4, 10000), 40000u);
+}
@@ -0,0 +1,581 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A few helpers shared by the benchmark programs (the "*.bench.cc" modules).
+
+The simple ones time a single run with measure().  Those which track
+regressions between commits use the harness at the bottom instead: flags of
+the form --name=value, untimed warmup runs, repeated trials summarized as
+min/median/p99 nanoseconds per element, and a report written either as a
+table or as JSON.  On Linux, the harness can also read hardware counters
+(cycles, instructions, branch misses, and L1d and LLC misses) around each
+trial and report them per element.  If the counters can't be opened, as in
+a container without permission, it says so and times alone.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cppcon14 {
+namespace bench {
+
+/* Keep the optimizer from discarding a value we computed only so that we
+   could time the computing of it. */
+template <typename val_t>
+inline void keep(const val_t &val) {
+  asm volatile("" : : "r"(&val) : "memory");
+}
+
+/* The number of elements to process, taken from the first command line
+   argument, if any, or else the given default. */
+inline size_t get_size(int argc, char *argv[], size_t def) {
+  return (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : def;
+}
+
+/* Time a call to fn, which processes n elements, and return the average
+   number of nanoseconds spent per element. */
+template <typename fn_t>
+double time_per_elem(size_t n, fn_t &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+/* Time fn, as above, and write the result to strm under the given name. */
+template <typename fn_t>
+void measure(std::ostream &strm, const char *name, size_t n, fn_t &&fn) {
+  double ns = time_per_elem(n, std::forward<fn_t>(fn));
+  strm << std::left << std::setw(32) << name
+       << std::right << std::fixed << std::setprecision(3) << std::setw(10)
+       << ns << " ns/elem" << std::endl;
+}
+
+/* ---------------------------------------------------------------------------
+The harness.
+--------------------------------------------------------------------------- */
+
+/* Command-line flags of the form --name=value.  A flag given more than once
+   takes its last value. */
+class flags_t final {
+  public:
+
+  flags_t(int argc, char *argv[]) : args(argv + 1, argv + argc) {}
+
+  /* The value of the named flag, or def if it wasn't given.  A flag given
+     as just --name has the value "1". */
+  std::string get_str(const char *name, const std::string &def) const {
+    assert(this);
+    std::string result = def;
+    std::string prefix = std::string("--") + name;
+    for (const auto &arg : args) {
+      if (arg == prefix) {
+        result = "1";
+      } else if (arg.compare(0, prefix.size() + 1, prefix + "=") == 0) {
+        result = arg.substr(prefix.size() + 1);
+      }  // if
+    }  // for
+    return result;
+  }
+
+  /* As above, as a number.  A value which isn't one is a usage error. */
+  size_t get_size(const char *name, size_t def) const {
+    assert(this);
+    std::string val = get_str(name, "");
+    return val.empty() ? def : parse_size(name, val);
+  }
+
+  /* As above, as a comma-separated list of numbers. */
+  std::vector<size_t> get_sizes(const char *name, const char *def) const {
+    assert(this);
+    std::vector<size_t> result;
+    for (const auto &item : split(get_str(name, def))) {
+      result.push_back(parse_size(name, item));
+    }  // for
+    return result;
+  }
+
+  /* As get_size() and get_sizes(), but for numbers of elements, which we
+     divide by, so 0 is a usage error too. */
+  size_t get_count(const char *name, size_t def) const {
+    assert(this);
+    size_t result = get_size(name, def);
+    if (!result) {
+      fail(name, "0", "a positive number");
+    }  // if
+    return result;
+  }
+
+  std::vector<size_t> get_counts(const char *name, const char *def) const {
+    assert(this);
+    std::vector<size_t> result = get_sizes(name, def);
+    for (size_t count : result) {
+      if (!count) {
+        fail(name, "0", "positive numbers");
+      }  // if
+    }  // for
+    return result;
+  }
+
+  /* True iff. name is among the comma-separated items of the named flag, or
+     the flag wasn't given, or it's "all". */
+  bool selects(const char *name, const char *item) const {
+    assert(this);
+    std::string val = get_str(name, "all");
+    if (val == "all") {
+      return true;
+    }  // if
+    auto items = split(val);
+    return std::find(items.begin(), items.end(), item) != items.end();
+  }
+
+  private:
+
+  /* The items of a comma-separated list. */
+  static std::vector<std::string> split(const std::string &list) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= list.size()) {
+      size_t end = list.find(',', start);
+      if (end == std::string::npos) {
+        end = list.size();
+      }  // if
+      if (end > start) {
+        items.push_back(list.substr(start, end - start));
+      }  // if
+      start = end + 1;
+    }  // while
+    return items;
+  }
+
+  /* The number, in decimal, in the value of the named flag, or, if it isn't
+     one, a usage error. */
+  static size_t parse_size(const char *name, const std::string &val) {
+    const char *start = val.c_str();
+    char *end = nullptr;
+    errno = 0;
+    size_t result = std::strtoull(start, &end, 10);
+    if (!std::isdigit(static_cast<unsigned char>(*start)) || *end ||
+        errno == ERANGE) {
+      fail(name, val, "a number");
+    }  // if
+    return result;
+  }
+
+  /* Report a bad value for the named flag, and exit. */
+  [[noreturn]] static void fail(
+      const char *name, const std::string &val, const char *expected) {
+    std::cerr << "bad value \"" << val << "\" for --" << name
+              << "; expected " << expected << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  /* The arguments, less the program name. */
+  std::vector<std::string> args;
+
+};  // flags_t
+
+/* How to repeat a measurement. */
+struct trial_opts_t final {
+
+  /* Take the options from --warmup, --trials and --min-elems. */
+  static trial_opts_t from(const flags_t &flags) {
+    return { flags.get_size("warmup", 2), flags.get_size("trials", 11),
+             flags.get_size("min-elems", 4000000) };
+  }
+
+  /* The number of untimed runs before the trials. */
+  size_t warmup;
+
+  /* The number of timed runs. */
+  size_t trials;
+
+  /* Small inputs are processed repeatedly within each trial, until at least
+     this many elements have gone by, so the clock's resolution and the cost
+     of reading it don't swamp the result. */
+  size_t min_elems;
+
+};  // trial_opts_t
+
+/* A summary of several trials, in nanoseconds per element. */
+struct stats_t final {
+  double min, median, p99;
+};
+
+/* Summarize the samples, which mustn't be empty.  The median and p99 are by
+   nearest rank, so with fewer than 100 samples, p99 is the maximum. */
+inline stats_t summarize(std::vector<double> samples) {
+  assert(!samples.empty());
+  std::sort(samples.begin(), samples.end());
+  size_t size = samples.size();
+  return { samples.front(), samples[(size - 1) / 2],
+           samples[std::min(size - 1, (size * 99 + 99) / 100 - 1)] };
+}
+
+/* A count from a hardware counter, per element. */
+struct count_t final {
+  const char *name;
+  double per_elem;
+};
+
+/* The hardware counters, read around the measured loops.  Each counter is
+   opened by itself, not in a group, so that one the machine lacks doesn't
+   cost us the rest.  If the kernel multiplexes them, we scale each count
+   by the fraction of the time it was actually counting. */
+class counters_t final {
+  public:
+
+  /* The number of counters we try to open. */
+  static constexpr size_t size = 5;
+
+  /* No copying or moving. */
+  counters_t(const counters_t &) = delete;
+  counters_t &operator=(const counters_t &) = delete;
+
+  /* Open the counters, if asked to (by --counters) and we can.  If we were
+     asked to but can't open some of them, say so on strm. */
+  counters_t(const flags_t &flags, std::ostream &strm) {
+    for (size_t i = 0; i < size; ++i) {
+      fds[i] = -1;
+    }  // for
+    if (!flags.get_size("counters", 0)) {
+      return;
+    }  // if
+    for (size_t i = 0; i < size; ++i) {
+      fds[i] = open(i);
+      if (fds[i] < 0) {
+        strm << "counter " << get_name(i) << " unavailable ("
+             << std::strerror(errno) << ")" << std::endl;
+      }  // if
+    }  // for
+    if (!is_any_open()) {
+      strm << "no hardware counters; reporting times only" << std::endl;
+    }  // if
+  }
+
+  /* Close whatever we opened. */
+  ~counters_t() {
+#ifdef __linux__
+    for (int fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+      }  // if
+    }  // for
+#endif
+  }
+
+  /* The name of the counter at the given position. */
+  static const char *get_name(size_t idx) {
+    static const char *const names[size] = {
+      "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+    };
+    return names[idx];
+  }
+
+  /* True iff. any counter is open. */
+  bool is_any_open() const {
+    assert(this);
+    for (int fd : fds) {
+      if (fd >= 0) {
+        return true;
+      }  // if
+    }  // for
+    return false;
+  }
+
+  /* Forget what we've counted so far. */
+  void clear() {
+    assert(this);
+    for (size_t i = 0; i < size; ++i) {
+      totals[i] = 0;
+    }  // for
+    elems = 0;
+  }
+
+  /* Start counting.  Resetting zeroes a counter's count, but not its times
+     enabled and running, so we note those, to scale by this trial's. */
+  void start() {
+    assert(this);
+#ifdef __linux__
+    for (size_t i = 0; i < size; ++i) {
+      if (fds[i] >= 0) {
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        uint64_t vals[3];
+        if (read(fds[i], vals, sizeof(vals)) == sizeof(vals)) {
+          enabled_at[i] = vals[1];
+          running_at[i] = vals[2];
+        }  // if
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+      }  // if
+    }  // for
+#endif
+  }
+
+  /* Stop counting, and add what we counted, over the given number of
+     elements, to the totals. */
+  void stop(size_t n) {
+    assert(this);
+#ifdef __linux__
+    for (size_t i = 0; i < size; ++i) {
+      if (fds[i] >= 0) {
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        /* The count, the time enabled and the time running. */
+        uint64_t vals[3];
+        if (read(fds[i], vals, sizeof(vals)) == sizeof(vals)) {
+          uint64_t enabled = vals[1] - enabled_at[i],
+                   running = vals[2] - running_at[i];
+          if (running) {
+            totals[i] += static_cast<double>(vals[0]) * enabled / running;
+          }  // if
+        }  // if
+      }  // if
+    }  // for
+#endif
+    elems += n;
+  }
+
+  /* The totals of the open counters, per element counted. */
+  std::vector<count_t> get_counts() const {
+    assert(this);
+    std::vector<count_t> counts;
+    for (size_t i = 0; i < size; ++i) {
+      if (fds[i] >= 0) {
+        counts.push_back({ get_name(i), elems ? totals[i] / elems : 0 });
+      }  // if
+    }  // for
+    return counts;
+  }
+
+  private:
+
+  /* Open the counter at the given position, for this process, in user
+     mode, disabled.  Returns the file descriptor, or -1 with errno set. */
+  static int open(size_t idx) {
+#ifdef __linux__
+    static const struct {
+      uint32_t type;
+      uint64_t config;
+    } events[size] = {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+      { PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+    };
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[idx].type;
+    attr.config = events[idx].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)idx;
+    errno = ENOSYS;
+    return -1;
+#endif
+  }
+
+  /* The file descriptors of our counters, or -1 for those not open. */
+  int fds[size];
+
+  /* What each counter has counted since we were last cleared. */
+  double totals[size] = {};
+
+  /* Each counter's times enabled and running when we last started it. */
+  uint64_t enabled_at[size] = {}, running_at[size] = {};
+
+  /* The number of elements processed since we were last cleared. */
+  size_t elems = 0;
+
+};  // counters_t
+
+/* Call fn, which processes n elements, in warmup runs and then in trials,
+   and summarize the time spent per element in the trials.  If given
+   counters, clear them, then count each trial. */
+template <typename fn_t>
+stats_t run_trials(size_t n, const trial_opts_t &opts, fn_t &&fn,
+                   counters_t *counters = nullptr) {
+  assert(n);
+  size_t reps = std::max<size_t>(1, (opts.min_elems + n - 1) / n);
+  for (size_t i = 0; i < opts.warmup; ++i) {
+    fn();
+  }  // for
+  if (counters) {
+    counters->clear();
+  }  // if
+  std::vector<double> samples;
+  for (size_t i = 0; i < std::max<size_t>(1, opts.trials); ++i) {
+    if (counters) {
+      counters->start();
+    }  // if
+    samples.push_back(time_per_elem(n * reps, [&] {
+      for (size_t rep = 0; rep < reps; ++rep) {
+        fn();
+      }  // for
+    }));
+    if (counters) {
+      counters->stop(n * reps);
+    }  // if
+  }  // for
+  return summarize(std::move(samples));
+}
+
+/* As above, but call prep, untimed and uncounted, before every call to fn.
+   This is for work which consumes what it works on, such as destroying
+   objects, so that prep can build them again.  Each call to fn is timed by
+   itself, which adds a clock read per call. */
+template <typename prep_t, typename fn_t>
+stats_t run_prepped_trials(size_t n, const trial_opts_t &opts, prep_t &&prep,
+                           fn_t &&fn, counters_t *counters = nullptr) {
+  assert(n);
+  size_t reps = std::max<size_t>(1, (opts.min_elems + n - 1) / n);
+  for (size_t i = 0; i < opts.warmup; ++i) {
+    prep();
+    fn();
+  }  // for
+  if (counters) {
+    counters->clear();
+  }  // if
+  std::vector<double> samples;
+  for (size_t i = 0; i < std::max<size_t>(1, opts.trials); ++i) {
+    double ns = 0;
+    for (size_t rep = 0; rep < reps; ++rep) {
+      prep();
+      if (counters) {
+        counters->start();
+      }  // if
+      ns += time_per_elem(n, fn);
+      if (counters) {
+        counters->stop(n);
+      }  // if
+    }  // for
+    samples.push_back(ns / reps);
+  }  // for
+  return summarize(std::move(samples));
+}
+
+/* One line of a report. */
+struct result_t final {
+
+  /* What we measured, such as the engine. */
+  std::string name;
+
+  /* The number of elements processed per run. */
+  size_t n;
+
+  /* The time per element. */
+  stats_t stats;
+
+  /* The hardware counts per element, if any. */
+  std::vector<count_t> counts;
+
+};  // result_t
+
+/* Collects results and writes them out, either as a table, one row at a
+   time as they come in, or, if asked for, as JSON once they're all in. */
+class report_t final {
+  public:
+
+  /* Write to strm, as JSON if --json was given. */
+  report_t(std::ostream &strm, const flags_t &flags)
+      : strm(strm), json(flags.get_size("json", 0) != 0) {
+    if (!json) {
+      strm << std::left << std::setw(40) << "name" << std::right
+           << std::setw(12) << "n" << std::setw(12) << "min" << std::setw(12)
+           << "median" << std::setw(12) << "p99" << "  (ns/elem)"
+           << std::endl;
+    }  // if
+  }
+
+  /* Write out the JSON, if we owe any. */
+  ~report_t() {
+    if (json) {
+      strm << "[";
+      for (size_t i = 0; i < results.size(); ++i) {
+        const result_t &result = results[i];
+        strm << (i ? "," : "") << "\n  {\"name\": \"" << result.name
+             << "\", \"n\": " << result.n << ", \"min_ns\": "
+             << result.stats.min << ", \"median_ns\": "
+             << result.stats.median << ", \"p99_ns\": " << result.stats.p99;
+        for (const auto &count : result.counts) {
+          strm << ", \"" << count.name << "\": " << count.per_elem;
+        }  // for
+        strm << "}";
+      }  // for
+      strm << "\n]" << std::endl;
+    }  // if
+  }
+
+  /* Add a result. */
+  void add(const result_t &result) {
+    assert(this);
+    if (json) {
+      results.push_back(result);
+    } else {
+      strm << std::left << std::setw(40) << result.name << std::right
+           << std::setw(12) << result.n << std::fixed << std::setprecision(3)
+           << std::setw(12) << result.stats.min << std::setw(12)
+           << result.stats.median << std::setw(12) << result.stats.p99;
+      for (const auto &count : result.counts) {
+        strm << "  " << count.name << '=' << std::setprecision(2)
+             << count.per_elem;
+      }  // for
+      strm << std::endl;
+    }  // if
+  }
+
+  private:
+
+  /* Where we write. */
+  std::ostream &strm;
+
+  /* True iff. we write JSON. */
+  bool json;
+
+  /* The results so far, if we write JSON. */
+  std::vector<result_t> results;
+
+};  // report_t
+
+}  // bench
+}  // cppcon14
@@ -0,0 +1,620 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A compiler from the calculator's expressions to bytecode, and a virtual
+machine to run it.
+
+eval_t walks the tree, which costs, at every node, a dispatch on the node's
+type, a recursive apply(), a switch on the operator and then another
+dispatch, through the operator's functor, on the operands' types.  The
+compiler does the walking once, flattening the tree into a vector of
+instructions in postfix order, each packed into 32 bits, with the literals
+and names off to the side, except that and and or test their left operand
+first and jump past their right one if the left one decides the result, as
+eval_t skips evaluating it.  The machine then runs the instructions against a
+stack of values.  With GCC or Clang, each instruction jumps directly to the
+next one's handler (threaded dispatch); elsewhere, a loop switches on each.
+The arithmetic and comparison operators handle a pair of ints themselves
+and hand anything else to the same functors eval_t uses.
+
+Names are found as eval_t finds them: a lambda's body sees its own
+parameters, then those of its caller, its caller's caller and so on, and
+then the scope given to eval().  The compiler resolves a name which is a
+parameter of the lambda being compiled to its slot, its position among
+the parameters, since a lambda's own frame is always the innermost.  The
+arguments of a call stay where they were pushed, as a flat frame on the
+stack, so such a parameter is found just by indexing.  Any other name
+depends on who's calling, so the machine looks it up when it's reached,
+through the frames of the calls being made and then in the scope, by
+comparing symbols, and throws undef_ref_error_t if it's nowhere.  Lambdas
+written as literals are compiled with the expression they're written in;
+those defined in the scope are compiled when first called.
+
+The machine computes the same values, and throws the same errors, as
+eval_t.
+
+See "bytecode.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <forward_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "calc.h"
+#include "symbol.h"
+#include "val.h"
+#include "variant.h"
+
+namespace cppcon14 {
+namespace calc {
+
+/* ---------------------------------------------------------------------------
+Bytecode.
+--------------------------------------------------------------------------- */
+
+/* The operations of the machine.  Each is stored in the low 8 bits of an
+   instruction; the high 24 bits are its argument, if it has one. */
+enum class opcode_t : uint8_t {
+
+  /* Push a copy of the literal at arg. */
+  lit,
+
+  /* Push a copy of the value of the name at arg, as found in the frames
+     of the callers, innermost first, or else in the scope. */
+  ref,
+
+  /* Push a copy of the parameter, in the current frame, at slot arg. */
+  load,
+
+  /* Replace the top of the stack with the result of an affix_t::op_t. */
+  neg,
+  not_,
+  to_int,
+  to_str,
+
+  /* Replace the top two with the result of an infix_t::op_t. */
+  add,
+  mul,
+  lt,
+  and_,
+  or_,
+
+  /* If the top of the stack is an int which decides an and_ (0) or an or_
+     (not 0), replace it with the result, 0 or 1, and skip the next arg
+     instructions, which compute the right operand and apply the operator.
+     Otherwise, go on to them. */
+  skip_and,
+  skip_or,
+
+  /* Throw if the top of the stack, the callee, isn't a lambda taking arg
+     parameters.  This comes before any of the args are pushed. */
+  check_fn,
+
+  /* Apply the lambda under the top arg values to them, replacing them all
+     with the result. */
+  call,
+
+  /* Return the top of the stack. */
+  ret
+
+};  // opcode_t
+
+/* The number of opcodes. */
+static constexpr size_t opcode_count = static_cast<size_t>(opcode_t::ret) + 1;
+
+/* An expression, compiled. */
+struct code_t final {
+
+  /* The largest argument an instruction can hold. */
+  static constexpr uint32_t max_arg = (1u << 24) - 1;
+
+  /* Make an instruction. */
+  static uint32_t make_instr(opcode_t opcode, size_t arg = 0) {
+    if (arg > max_arg) {
+      throw std::length_error("expression too large to compile");
+    }  // if
+    return static_cast<uint32_t>(opcode) | static_cast<uint32_t>(arg << 8);
+  }
+
+  /* The parts of an instruction. */
+  static opcode_t get_opcode(uint32_t instr) {
+    return static_cast<opcode_t>(instr & 0xff);
+  }
+
+  static uint32_t get_arg(uint32_t instr) { return instr >> 8; }
+
+  /* The instructions, ending in a ret. */
+  std::vector<uint32_t> instrs;
+
+  /* The values of the literals. */
+  std::vector<val_t> lits;
+
+  /* The names looked up when they're reached. */
+  std::vector<symbol_t> names;
+
+};  // code_t
+
+/* ---------------------------------------------------------------------------
+The machine.
+--------------------------------------------------------------------------- */
+
+/* Runs compiled expressions.  It keeps the code of each expression it has
+   compiled, including the bodies of lambdas, so it's cheapest to keep a
+   machine around and run the same expressions on it repeatedly.  A lambda's
+   body is compiled just once for each list of parameters it's applied with,
+   however many places it's applied from. */
+class vm_t final {
+  public:
+
+  /* No copying or moving. */
+  vm_t(const vm_t &) = delete;
+  vm_t &operator=(const vm_t &) = delete;
+
+  /* Start with no code and an empty stack. */
+  vm_t() = default;
+
+  /* The code of the expression, compiling it if we haven't yet.  We keep a
+     reference to the expression, so its address stays ours. */
+  const code_t &get_code(const expr_ptr_t &expr);
+
+  /* Evaluate the expression in the scope.  If it throws, the stack is left
+     as we found it. */
+  val_t eval(const expr_ptr_t &expr, const scope_t &scope);
+
+  private:
+
+  /* Compiles an expression. */
+  struct compile_t;
+
+  /* The arguments of a call, as they lie on the stack. */
+  struct frame_t final {
+
+    /* The frame of the call which made this one, or, for the outermost
+       frame, null. */
+    const frame_t *caller;
+
+    /* The parameters of the lambda being applied, or, for the outermost
+       frame, null. */
+    const lambda_t::params_t *params;
+
+    /* The position on the stack of the first argument. */
+    size_t base;
+
+    /* The scope given to eval(). */
+    const scope_t *scope;
+
+  };  // frame_t
+
+  /* A lambda's body and its code. */
+  struct body_t final {
+
+    /* A reference which keeps the body alive. */
+    expr_ptr_t def;
+
+    /* The lambda's parameters. */
+    lambda_t::params_t params;
+
+    /* The body, compiled. */
+    std::unique_ptr<code_t> code;
+
+  };  // body_t
+
+  /* Compile the expression to run in a frame with the given parameters, or,
+     if null, outside any lambda. */
+  code_t compile(const expr_t &expr, const lambda_t::params_t *params);
+
+  /* The lambda's body, compiling it if we haven't yet.  Lambdas may share
+     a definition but not its parameters, and the code depends on them, so
+     we compile it once for each list of parameters it's applied with. */
+  const body_t &get_body(const lambda_t &lambda) {
+    assert(this);
+    auto &versions = bodies[lambda.def.get()];
+    for (const body_t &body : versions) {
+      if (body.params == lambda.params) {
+        return body;
+      }  // if
+    }  // for
+    auto code = std::make_unique<code_t>(compile(*lambda.def, &lambda.params));
+    versions.push_front(body_t{ lambda.def, lambda.params, std::move(code) });
+    return versions.front();
+  }
+
+  /* The value of the name, as eval_t would find it, in the frame.  The
+     frame's own parameters were searched when compiling, so we start
+     with its caller's. */
+  static const val_t &find(
+      symbol_t name, const frame_t &frame, const std::vector<val_t> &stack) {
+    for (const frame_t *that = frame.caller; that && that->params;
+         that = that->caller) {
+      const auto &params = *that->params;
+      for (size_t slot = params.size(); slot-- > 0; ) {
+        if (params[slot] == name) {
+          return stack[that->base + slot];
+        }  // if
+      }  // for
+    }  // for
+    return frame.scope->ref(name);
+  }
+
+  /* Run the code in the frame, leaving the stack as we found it unless it
+     throws. */
+  val_t run(const code_t &code, const frame_t &frame);
+
+  /* Apply the lambda at the given position of the stack to the arg_count
+     values above it, replacing them all with the result. */
+  void call(size_t arg_count, const frame_t &frame) {
+    assert(this);
+    size_t fn_pos = stack.size() - arg_count - 1;
+    const body_t &body = get_body(stack[fn_pos].as<lambda_t>());
+    frame_t local{ &frame, &body.params, fn_pos + 1, frame.scope };
+    val_t result = run(*body.code, local);
+    stack.erase(stack.begin() + fn_pos, stack.end());
+    stack.push_back(std::move(result));
+  }
+
+  /* Replace the top of the stack with the result of the functor. */
+  template <typename functor_t>
+  void apply_unary() {
+    assert(this);
+    val_t &arg = stack.back();
+    arg = apply(functor_t(), arg);
+  }
+
+  /* Replace the top two values of the stack with the result of the
+     functor. */
+  template <typename functor_t>
+  void apply_binary() {
+    assert(this);
+    val_t &lhs = stack[stack.size() - 2];
+    lhs = apply(functor_t(), lhs, stack.back());
+    stack.pop_back();
+  }
+
+  /* The ints atop the stack, if the top two values are ints. */
+  bool get_ints(int *&lhs, int *&rhs) {
+    assert(this);
+    size_t size = stack.size();
+    lhs = stack[size - 2].try_as<int>();
+    rhs = stack[size - 1].try_as<int>();
+    return lhs && rhs;
+  }
+
+  /* The code of each expression we've compiled, and a reference which
+     keeps the expression alive. */
+  std::unordered_map<const expr_t *,
+                     std::pair<expr_ptr_t, std::unique_ptr<code_t>>> codes;
+
+  /* The body of each lambda we've compiled, by its definition, once for each
+     list of parameters.  A list, so that the bodies stay put as we add to
+     it. */
+  std::unordered_map<const expr_t *, std::forward_list<body_t>> bodies;
+
+  /* The values being computed with, shared by the frames of all the
+     lambdas being applied. */
+  std::vector<val_t> stack;
+
+};  // vm_t
+
+/* Appends the code for an expression to a code_t. */
+struct vm_t::compile_t final {
+
+  using ret_t = void;
+
+  /* A lambda's body is compiled here, too. */
+  void operator()(const lit_t &that) const {
+    if (const auto *lambda = that.val->try_as<lambda_t>()) {
+      vm.get_body(*lambda);
+    }  // if
+    code.lits.push_back(*that.val);
+    emit(opcode_t::lit, code.lits.size() - 1);
+  }
+
+  void operator()(const affix_t &that) const {
+    apply(*this, *that.arg);
+    switch (that.op) {
+      case affix_t::neg: {
+        emit(opcode_t::neg);
+        break;
+      }
+      case affix_t::not_: {
+        emit(opcode_t::not_);
+        break;
+      }
+      case affix_t::to_int: {
+        emit(opcode_t::to_int);
+        break;
+      }
+      case affix_t::to_str: {
+        emit(opcode_t::to_str);
+        break;
+      }
+    }  // switch
+  }
+
+  void operator()(const infix_t &that) const {
+    apply(*this, *that.lhs);
+    switch (that.op) {
+      case infix_t::add: {
+        apply(*this, *that.rhs);
+        emit(opcode_t::add);
+        break;
+      }
+      case infix_t::mul: {
+        apply(*this, *that.rhs);
+        emit(opcode_t::mul);
+        break;
+      }
+      case infix_t::lt: {
+        apply(*this, *that.rhs);
+        emit(opcode_t::lt);
+        break;
+      }
+      case infix_t::and_: {
+        emit_short_circuit(opcode_t::skip_and, opcode_t::and_, *that.rhs);
+        break;
+      }
+      case infix_t::or_: {
+        emit_short_circuit(opcode_t::skip_or, opcode_t::or_, *that.rhs);
+        break;
+      }
+    }  // switch
+  }
+
+  /* Look for the name among the parameters of the lambda being compiled,
+     last first, as a later definition hides an earlier one.  Failing that,
+     it's looked up when reached. */
+  void operator()(const ref_t &that) const {
+    if (params) {
+      for (size_t slot = params->size(); slot-- > 0; ) {
+        if ((*params)[slot] == that.name) {
+          emit(opcode_t::load, slot);
+          return;
+        }  // if
+      }  // for
+    }  // if
+    code.names.push_back(that.name);
+    emit(opcode_t::ref, code.names.size() - 1);
+  }
+
+  void operator()(const apply_t &that) const {
+    apply(*this, *that.fn);
+    emit(opcode_t::check_fn, that.args.size());
+    for (const auto &arg : that.args) {
+      apply(*this, *arg);
+    }  // for
+    emit(opcode_t::call, that.args.size());
+  }
+
+  void emit(opcode_t opcode, size_t arg = 0) const {
+    code.instrs.push_back(code_t::make_instr(opcode, arg));
+  }
+
+  /* With the left operand's code already emitted, the test which may skip
+     the right operand's code and the operator, then those. */
+  void emit_short_circuit(
+      opcode_t skip, opcode_t op, const expr_t &rhs) const {
+    size_t pos = code.instrs.size();
+    emit(skip);
+    apply(*this, rhs);
+    emit(op);
+    code.instrs[pos] =
+        code_t::make_instr(skip, code.instrs.size() - (pos + 1));
+  }
+
+  vm_t &vm;
+  code_t &code;
+  const lambda_t::params_t *params;
+
+};  // vm_t::compile_t
+
+inline code_t vm_t::compile(
+    const expr_t &expr, const lambda_t::params_t *params) {
+  assert(this);
+  code_t code;
+  apply(compile_t{ *this, code, params }, expr);
+  code.instrs.push_back(code_t::make_instr(opcode_t::ret));
+  return code;
+}
+
+inline const code_t &vm_t::get_code(const expr_ptr_t &expr) {
+  assert(this);
+  assert(expr);
+  auto &entry = codes[expr.get()];
+  if (!entry.second) {
+    entry.first = expr;
+    entry.second = std::make_unique<code_t>(compile(*expr, nullptr));
+  }  // if
+  return *entry.second;
+}
+
+inline val_t vm_t::eval(const expr_ptr_t &expr, const scope_t &scope) {
+  assert(this);
+  size_t depth = stack.size();
+  try {
+    frame_t top{ nullptr, nullptr, depth, &scope };
+    return run(get_code(expr), top);
+  } catch (...) {
+    stack.erase(stack.begin() + depth, stack.end());
+    throw;
+  }
+}
+
+/* With GCC and Clang, each handler jumps straight to the next one through
+   a table of label addresses.  Elsewhere, we loop around a switch. */
+#if defined(__GNUC__)
+#define CPPCON14_CALC_VM_NEXT()  \
+  goto *handlers[static_cast<size_t>(code_t::get_opcode(instr = *ip++))]
+#define CPPCON14_CALC_VM_DISPATCH() CPPCON14_CALC_VM_NEXT();
+#define CPPCON14_CALC_VM_CASE(name) do_##name:
+#else
+#define CPPCON14_CALC_VM_DISPATCH()  \
+  switch (code_t::get_opcode(instr = *ip++))
+#define CPPCON14_CALC_VM_CASE(name) case opcode_t::name:
+#define CPPCON14_CALC_VM_NEXT() continue
+#endif
+
+inline val_t vm_t::run(const code_t &code, const frame_t &frame) {
+  assert(this);
+#if defined(__GNUC__)
+  static void *const handlers[opcode_count] = {
+    &&do_lit, &&do_ref, &&do_load, &&do_neg, &&do_not_, &&do_to_int,
+    &&do_to_str, &&do_add, &&do_mul, &&do_lt, &&do_and_, &&do_or_,
+    &&do_skip_and, &&do_skip_or, &&do_check_fn, &&do_call, &&do_ret
+  };
+#endif
+  const uint32_t *ip = code.instrs.data();
+  uint32_t instr;
+  for (;;) {
+    CPPCON14_CALC_VM_DISPATCH() {
+      CPPCON14_CALC_VM_CASE(lit) {
+        stack.push_back(code.lits[code_t::get_arg(instr)]);
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(ref) {
+        stack.push_back(
+            find(code.names[code_t::get_arg(instr)], frame, stack));
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(load) {
+        stack.push_back(stack[frame.base + code_t::get_arg(instr)]);
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(neg) {
+        if (int *arg = stack.back().try_as<int>()) {
+          *arg = -*arg;
+        } else {
+          apply_unary<neg_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(not_) {
+        if (int *arg = stack.back().try_as<int>()) {
+          *arg = !*arg;
+        } else {
+          apply_unary<not_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(to_int) {
+        if (!stack.back().try_as<int>()) {
+          apply_unary<to_int_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(to_str) {
+        apply_unary<to_str_t>();
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(add) {
+        int *lhs, *rhs;
+        if (get_ints(lhs, rhs)) {
+          *lhs += *rhs;
+          stack.pop_back();
+        } else {
+          apply_binary<add_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(mul) {
+        int *lhs, *rhs;
+        if (get_ints(lhs, rhs)) {
+          *lhs *= *rhs;
+          stack.pop_back();
+        } else {
+          apply_binary<mul_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(lt) {
+        int *lhs, *rhs;
+        if (get_ints(lhs, rhs)) {
+          *lhs = *lhs < *rhs;
+          stack.pop_back();
+        } else {
+          apply_binary<lt_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(and_) {
+        int *lhs, *rhs;
+        if (get_ints(lhs, rhs)) {
+          *lhs = *lhs && *rhs;
+          stack.pop_back();
+        } else {
+          apply_binary<and_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(or_) {
+        int *lhs, *rhs;
+        if (get_ints(lhs, rhs)) {
+          *lhs = *lhs || *rhs;
+          stack.pop_back();
+        } else {
+          apply_binary<or_t>();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(skip_and) {
+        int *arg = stack.back().try_as<int>();
+        if (arg && !*arg) {
+          ip += code_t::get_arg(instr);
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(skip_or) {
+        int *arg = stack.back().try_as<int>();
+        if (arg && *arg) {
+          *arg = 1;
+          ip += code_t::get_arg(instr);
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(check_fn) {
+        size_t arg_count = code_t::get_arg(instr);
+        const auto *lambda = stack.back().try_as<lambda_t>();
+        if (!lambda || lambda->params.size() != arg_count) {
+          throw type_mismatch_error_t();
+        }  // if
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(call) {
+        call(code_t::get_arg(instr), frame);
+        CPPCON14_CALC_VM_NEXT();
+      }
+      CPPCON14_CALC_VM_CASE(ret) {
+        val_t result = std::move(stack.back());
+        stack.pop_back();
+        return result;
+      }
+    }  // dispatch
+  }  // for
+}
+
+#undef CPPCON14_CALC_VM_DISPATCH
+#undef CPPCON14_CALC_VM_CASE
+#undef CPPCON14_CALC_VM_NEXT
+
+}  // calc
+}  // cppcon14
@@ -0,0 +1,320 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the bytecode compiler and machine in
+"bytecode.h".
+--------------------------------------------------------------------------- */
+
+#include "bytecode.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::calc;
+
+/* What evaluating gets us: the type and value of the result, or the error
+   thrown. */
+static string get_outcome(const function<val_t ()> &eval) {
+  try {
+    val_t val = eval();
+    if (const auto *that = val.try_as<int>()) {
+      return "int " + to_string(*that);
+    }
+    if (const auto *that = val.try_as<string>()) {
+      return "str " + *that;
+    }
+    if (const auto *that = val.try_as<lambda_t>()) {
+      return "lambda of " + to_string(that->params.size());
+    }
+    return "null";
+  } catch (const type_mismatch_error_t &) {
+    return "type mismatch";
+  } catch (const null_value_error_t &) {
+    return "null value";
+  } catch (const undef_ref_error_t &) {
+    return "undefined ref";
+  }
+}
+
+/* The outcomes of the tree-walker and the machine. */
+static string get_tree_outcome(const expr_ptr_t &expr, const scope_t &scope) {
+  return get_outcome([&] { return apply(eval_t{&scope}, *expr); });
+}
+
+static string get_vm_outcome(
+    vm_t &vm, const expr_ptr_t &expr, const scope_t &scope) {
+  return get_outcome([&] { return vm.eval(expr, scope); });
+}
+
+/* A scope with a few things in it. */
+static void def_some(scope_t &scope) {
+  scope.def("x", 7);
+  scope.def("s", string("abc"));
+  scope.def("nothing", val_t());
+  scope.def("sq", lambda_t({ "n" }, parse_expr("n * n")));
+}
+
+static expr_ptr_t make_lit(val_t val) {
+  return make_shared<expr_t>(lit_t(make_shared<val_t>(move(val))));
+}
+
+static expr_ptr_t make_ref(const string &name) {
+  return make_shared<expr_t>(ref_t(name));
+}
+
+static expr_ptr_t make_apply(
+    const expr_ptr_t &fn, apply_t::args_t args) {
+  return make_shared<expr_t>(apply_t(fn, move(args)));
+}
+
+FIXTURE(compile) {
+  scope_t scope;
+  scope.def("x", 1);
+  vm_t vm;
+  const code_t &code = vm.get_code(parse_expr("1 + x * 2"));
+  if (EXPECT_EQ(code.instrs.size(), 6u)) {
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[0]) == opcode_t::lit);
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[1]) == opcode_t::ref);
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[2]) == opcode_t::lit);
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[3]) == opcode_t::mul);
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[4]) == opcode_t::add);
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[5]) == opcode_t::ret);
+    EXPECT_EQ(code_t::get_arg(code.instrs[2]), 1u);
+  }
+  EXPECT_EQ(code.lits.size(), 2u);
+  if (EXPECT_EQ(code.names.size(), 1u)) {
+    EXPECT_EQ(code.names[0].get_name(), "x");
+  }
+}
+
+FIXTURE(same_as_tree) {
+  scope_t scope;
+  def_some(scope);
+  vm_t vm;
+  for (const char *text : {
+           "1 + 2", "1 + 2 * 3", "-(4 + 5) * 2", "--3", "not 0", "not 5",
+           "1 < 2", "2 < 1", "1 and 0", "0 or 3", "1 < 2 and 2 < 3 or 0",
+           "x * x + 1", "s + s", "s * 3", "s < \"abd\"", "\"b\" < s",
+           "x", "s", "sq", "fn a, b, = a + b", "not s", "-s", "x + s",
+           "s * s", "sq + 1", "y", "x + y", "nothing", "nothing + 1",
+           "1 + nothing", "-nothing" }) {
+    expr_ptr_t expr = parse_expr(text);
+    EXPECT_EQ(get_vm_outcome(vm, expr, scope), get_tree_outcome(expr, scope));
+  }
+  EXPECT_EQ(get_vm_outcome(vm, parse_expr("x * 6"), scope), "int 42");
+  EXPECT_EQ(get_vm_outcome(vm, parse_expr("s * 2"), scope), "str abcabc");
+  EXPECT_EQ(get_vm_outcome(vm, parse_expr("x + s"), scope), "type mismatch");
+  EXPECT_EQ(get_vm_outcome(vm, parse_expr("y"), scope), "undefined ref");
+  EXPECT_EQ(get_vm_outcome(vm, parse_expr("nothing"), scope), "null");
+}
+
+FIXTURE(apply) {
+  scope_t scope;
+  def_some(scope);
+  vm_t vm;
+  vector<expr_ptr_t> exprs = {
+    /* sq 9 */
+    make_apply(make_ref("sq"), { make_lit(9) }),
+    /* (fn a, b, = a * b + x) 5 6 */
+    make_apply(make_lit(lambda_t({ "a", "b" }, parse_expr("a * b + x"))),
+               { make_lit(5), make_lit(6) }),
+    /* Parameters hide the caller's names, and lambdas see their callers'. */
+    make_apply(make_lit(lambda_t({ "x" }, parse_expr("x + s"))),
+               { make_lit(string("def")) }),
+    /* sq (sq 3) */
+    make_apply(make_ref("sq"),
+               { make_apply(make_ref("sq"), { make_lit(3) }) }),
+    /* Lambdas returning lambdas. */
+    make_apply(
+        make_apply(make_lit(lambda_t({ "k" }, parse_expr("fn n, = n * k"))),
+                   { make_lit(4) }),
+        { make_lit(5) }),
+    /* The wrong number of arguments. */
+    make_apply(make_ref("sq"), { make_lit(1), make_lit(2) }),
+    /* Not a lambda: the mismatch comes before the bad argument. */
+    make_apply(make_ref("x"), { make_ref("nothing") }),
+    /* An error in an argument. */
+    make_apply(make_ref("sq"), { make_ref("y") }),
+    /* An error in the body. */
+    make_apply(make_ref("sq"), { make_ref("nothing") })
+  };
+  for (const auto &expr : exprs) {
+    EXPECT_EQ(get_vm_outcome(vm, expr, scope), get_tree_outcome(expr, scope));
+  }
+  EXPECT_EQ(get_vm_outcome(vm, exprs[0], scope), "int 81");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[1], scope), "int 37");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[2], scope), "str defabc");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[3], scope), "int 81");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[5], scope), "type mismatch");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[6], scope), "type mismatch");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[7], scope), "undefined ref");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[8], scope), "null value");
+}
+
+static expr_ptr_t make_infix(
+    infix_t::op_t op, const expr_ptr_t &lhs, const expr_ptr_t &rhs) {
+  return make_shared<expr_t>(infix_t(op, lhs, rhs));
+}
+
+FIXTURE(short_circuit) {
+  scope_t scope;
+  def_some(scope);
+  vm_t vm;
+  /* sq s, which throws from within the call. */
+  expr_ptr_t boom = make_apply(make_ref("sq"), { make_ref("s") });
+  vector<expr_ptr_t> exprs = {
+    make_infix(infix_t::and_, parse_expr("x < 5"), boom),
+    make_infix(infix_t::or_, parse_expr("x"), boom),
+    make_infix(infix_t::and_, parse_expr("0"), parse_expr("nothing + 1")),
+    make_infix(infix_t::and_, parse_expr("x"), boom),
+    make_infix(infix_t::or_, parse_expr("0"), parse_expr("nothing + 1")),
+    make_infix(infix_t::and_, parse_expr("s"), parse_expr("0")),
+    make_infix(infix_t::or_, parse_expr("0"), parse_expr("x < 9")),
+    /* Nested, so that one skip jumps over another. */
+    make_infix(infix_t::or_,
+               make_infix(infix_t::and_, parse_expr("0"), boom),
+               make_infix(infix_t::and_, parse_expr("x"), parse_expr("3")))
+  };
+  for (const auto &expr : exprs) {
+    EXPECT_EQ(get_vm_outcome(vm, expr, scope), get_tree_outcome(expr, scope));
+  }
+  EXPECT_EQ(get_vm_outcome(vm, exprs[0], scope), "int 0");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[1], scope), "int 1");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[2], scope), "int 0");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[3], scope), "type mismatch");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[4], scope), "null value");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[5], scope), "type mismatch");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[6], scope), "int 1");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[7], scope), "int 1");
+  /* The skip jumps past the right operand's code and the operator. */
+  const code_t &code = vm.get_code(exprs[2]);
+  if (EXPECT_EQ(code.instrs.size(), 7u)) {
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[1]) == opcode_t::skip_and);
+    EXPECT_EQ(code_t::get_arg(code.instrs[1]), 4u);
+    EXPECT_TRUE(code_t::get_opcode(code.instrs[5]) == opcode_t::and_);
+  }
+  /* A skip leaves the stack as it should. */
+  EXPECT_EQ(vm.eval(make_infix(infix_t::add, exprs[1], parse_expr("x")),
+                    scope).as<int>(), 8);
+}
+
+FIXTURE(reuse) {
+  vm_t vm;
+  expr_ptr_t expr = parse_expr("x * x");
+  for (int x = 0; x < 10; ++x) {
+    scope_t scope;
+    scope.def("x", x);
+    EXPECT_EQ(vm.eval(expr, scope).as<int>(), x * x);
+  }
+  /* An error leaves the machine fit to carry on. */
+  scope_t scope;
+  scope.def("x", string("a"));
+  EXPECT_EQ(get_vm_outcome(vm, parse_expr("1 + (x * x)"), scope),
+            "type mismatch");
+  EXPECT_EQ(vm.eval(parse_expr("x * 3"), scope).as<string>(), "aaa");
+}
+
+FIXTURE(resolve) {
+  scope_t scope;
+  def_some(scope);
+  scope.def("get_x", lambda_t({}, parse_expr("x")));
+  vm_t vm;
+  vector<expr_ptr_t> exprs = {
+    /* (fn a, b, = (fn c, = (fn d, = a + b * c + d) 4) 3) 1 2 */
+    make_apply(
+        make_lit(lambda_t(
+            { "a", "b" },
+            make_apply(
+                make_lit(lambda_t(
+                    { "c" },
+                    make_apply(make_lit(lambda_t(
+                                   { "d" }, parse_expr("a + b * c + d"))),
+                               { make_lit(4) }))),
+                { make_lit(3) }))),
+        { make_lit(1), make_lit(2) }),
+    /* An inner parameter hides an outer one and the scope's. */
+    make_apply(
+        make_lit(lambda_t(
+            { "x" },
+            make_apply(make_lit(lambda_t({ "x" }, parse_expr("x * 10"))),
+                       { make_ref("x") }))),
+        { make_lit(3) }),
+    /* The later of two parameters of the same name wins. */
+    make_apply(make_lit(lambda_t({ "a", "a" }, parse_expr("a"))),
+               { make_lit(1), make_lit(2) }),
+    /* A lambda applied after the body it's written in has returned sees
+       its caller's names, not that body's. */
+    make_apply(
+        make_apply(make_lit(lambda_t({ "k" }, parse_expr("fn n, = n * k"))),
+                   { make_lit(4) }),
+        { make_lit(5) }),
+    make_apply(
+        make_lit(lambda_t(
+            { "k", "f" }, make_apply(make_ref("f"), { make_lit(5) }))),
+        { make_lit(6),
+          make_apply(
+              make_lit(lambda_t({ "k" }, parse_expr("fn n, = n * k"))),
+              { make_lit(4) }) }),
+    /* The scope's lambda sees its caller's x, which hides the scope's. */
+    make_apply(make_lit(lambda_t({ "x" }, make_apply(make_ref("get_x"), {}))),
+               { make_lit(100) }),
+    make_apply(make_ref("get_x"), {}),
+    /* A name is looked up only when reached. */
+    parse_expr("(1 + s) + y"),
+    parse_expr("fn a, = a + y"),
+    make_infix(infix_t::and_, parse_expr("0"), parse_expr("y"))
+  };
+  for (const auto &expr : exprs) {
+    EXPECT_EQ(get_vm_outcome(vm, expr, scope), get_tree_outcome(expr, scope));
+  }
+  EXPECT_EQ(get_vm_outcome(vm, exprs[0], scope), "int 11");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[1], scope), "int 30");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[2], scope), "int 2");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[3], scope), "undefined ref");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[4], scope), "int 30");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[5], scope), "int 100");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[6], scope), "int 7");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[7], scope), "type mismatch");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[8], scope), "lambda of 1");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[9], scope), "int 0");
+}
+
+FIXTURE(shared_def) {
+  scope_t scope;
+  /* Two lambdas with the same body, but different parameters. */
+  expr_ptr_t body = parse_expr("a + b");
+  scope.def("f", lambda_t({ "a" }, body));
+  scope.def("g", lambda_t({ "b" }, body));
+  vm_t vm;
+  /* (fn b, = f 1) 100, then the same with g, which has no a. */
+  vector<expr_ptr_t> exprs = {
+    make_apply(
+        make_lit(lambda_t({ "b" }, make_apply(make_ref("f"), { make_lit(1) }))),
+        { make_lit(100) }),
+    make_apply(
+        make_lit(lambda_t({ "b" }, make_apply(make_ref("g"), { make_lit(1) }))),
+        { make_lit(100) })
+  };
+  for (const auto &expr : exprs) {
+    EXPECT_EQ(get_vm_outcome(vm, expr, scope), get_tree_outcome(expr, scope));
+  }
+  EXPECT_EQ(get_vm_outcome(vm, exprs[0], scope), "int 101");
+  EXPECT_EQ(get_vm_outcome(vm, exprs[1], scope), "undefined ref");
+}
@@ -0,0 +1,1054 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The calculator benchmark.  Each suite measures one part of the calculator in
+"calc.h" against the alternatives to it:
+
+  eval    Evaluating a few expressions over a few definitions in scope,
+          both by walking the tree with eval_t (tree) and by running the
+          code compiled from it on the machine in "bytecode.h" (vm).  The
+          machine compiles each expression on its first run, which is in
+          the warmup.  Reports ns per evaluation.
+  nested  Applying nests of lambdas, each applying the next one in to its
+          own parameters, the innermost summing parameters of each, so
+          that names are found at every depth.  Under eval_t, each name
+          is looked up through the chain of frames.  The machine finds a
+          lambda's own parameters by slot, and its callers' through the
+          chain of frames.
+          Reports ns per evaluation of the whole nest.
+  fold    Evaluating sums of generated terms, full of constant subtrees and
+          identities, such as 2 * 3 * x, x * 1 + 0 and "a" + "b" < s, as
+          they are (raw) and after fold() of "fold.h" (folded), with each
+          engine.  Each name gives the number of nodes in the tree.
+          Reports ns per evaluation of the whole sum.
+  guards  Evaluating a set of rules, each a cheap guard and-ed with a
+          costly application of lambdas, of which the given percentages of
+          guards pass, summing the rules' results.  Each set is written
+          with and, which skips the application where the guard fails
+          (and), and with mul, which computes the same but always applies
+          (mul).  Reports ns per evaluation of the whole set.
+  scan    Scanning generated rule text of the given sizes into tokens,
+          with the istream-based scanner the calculator used to have
+          (stream), with scanner_t over the text in place (buffer), and
+          with scanner_t reading it from a stream first (istream).
+          Reports ns per byte, and MB/s.
+  parse   Parsing generated rules, a line at a time, and one long sum of
+          the given numbers of terms, with the recursive descent parser,
+          a function per level of precedence, which the calculator used to
+          have (descent), and with expr_parser_t (climb).  Both scan with
+          scanner_t.  Reports ns per byte, and MB/s.
+  rules   Parsing a corpus of generated rules, over a vocabulary of long
+          names and a few string literals, each recurring thousands of
+          times, and then evaluating each rule with each engine.  Reports
+          ns per rule, and, for parsing, the bytes the heap holds for the
+          corpus afterwards, per rule (with glibc only).
+
+Each engine's results are checked against the tree-walker's before timing,
+and the run fails if they differ.
+
+Usage: calc.bench [flags]
+  --suites=all      The suites to run.
+  --exprs=all       The expressions to evaluate, by name.
+  --engines=all     Either or both of tree and vm, and, in the rules
+                    suite, parse.
+  --evals=100000    The number of evaluations per run.
+  --depths=1,4,16   The depths of the nested suite's lambdas.
+  --widths=1,8,32   The numbers of parameters of each.
+  --terms=16,256    The numbers of terms in the fold suite's sums.
+  --rules=64        The number of rules in the guards suite's sets.
+  --passes=0,10,50,100  The percentages of their guards which pass.
+  --bytes=65536,4194304  The sizes of the scan suite's texts.
+  --scanners=all    Any of stream, buffer and istream.
+  --rule-bytes=1048576  The size of the parse suite's rules.
+  --sums=1000,10000  The numbers of terms in its sums.
+  --parsers=all     Either or both of descent and climb.
+  --corpus=20000    The number of rules in the rules suite's corpus.
+  --vocab=500       The number of names they're written in.
+  --warmup, --trials, --min-elems, --counters and --json, as in speed.test.
+--------------------------------------------------------------------------- */
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <cctype>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "bench.h"
+#include "bytecode.h"
+#include "calc.h"
+#include "fold.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::calc;
+
+/* ---------------------------------------------------------------------------
+Building expressions.
+--------------------------------------------------------------------------- */
+
+static expr_ptr_t make_lit(val_t val) {
+  return make_shared<expr_t>(lit_t(make_shared<val_t>(move(val))));
+}
+
+static expr_ptr_t make_ref(const string &name) {
+  return make_shared<expr_t>(ref_t(name));
+}
+
+/* The parser has no syntax for application, so we build it by hand. */
+static expr_ptr_t make_apply(const expr_ptr_t &fn, apply_t::args_t args) {
+  return make_shared<expr_t>(apply_t(fn, move(args)));
+}
+
+/* An expression to evaluate, by name. */
+struct named_expr_t final {
+  const char *name;
+  expr_ptr_t expr;
+};
+
+/* Describe the value, for comparing engines. */
+static string describe(const val_t &val) {
+  if (val.try_as<lambda_t>()) {
+    return "<lambda>";
+  }  // if
+  if (val.try_as<cppcon14::variant::null_t>()) {
+    return "<null>";
+  }  // if
+  return apply(to_str_t(), val).as<string>();
+}
+
+/* ---------------------------------------------------------------------------
+The eval suite.
+--------------------------------------------------------------------------- */
+
+/* The definitions the eval suite's expressions refer to. */
+static void def_eval_scope(scope_t &scope) {
+  scope.def("x", 7);
+  scope.def("y", 12);
+  scope.def("s", string("abc"));
+  scope.def("sq", lambda_t({ "n" }, parse_expr("n * n")));
+  scope.def("poly", lambda_t({ "a", "b", "c" },
+                             parse_expr("a * x * x + b * x + c")));
+}
+
+/* The eval suite's expressions. */
+static vector<named_expr_t> make_eval_exprs() {
+  return {
+    { "arith", parse_expr("x * x + 3 * x + 1 + y * (x + -y) * 2") },
+    { "logic", parse_expr("x < y and not (y < x) or 0 and x < 100") },
+    { "strings", parse_expr("s + s * 2 < s * 3 + \"d\"") },
+    { "calls", make_apply(make_ref("poly"),
+                          { make_apply(make_ref("sq"), { make_ref("x") }),
+                            make_lit(2), make_ref("y") }) },
+    { "lambda", parse_expr("fn a, b, = a + b") }
+  };
+}
+
+/* Evaluate the expression n times with each selected engine, reporting
+   under the given name, after checking that the engines agree. */
+static void run_engines(const flags_t &flags, counters_t &counters,
+                        report_t &report, const string &name,
+                        const expr_ptr_t &expr, const scope_t &scope) {
+  auto opts = trial_opts_t::from(flags);
+  size_t n = flags.get_count("evals", 100000);
+  vm_t vm;
+  string expected = describe(apply(eval_t{&scope}, *expr));
+  string actual = describe(vm.eval(expr, scope));
+  if (actual != expected) {
+    cerr << "vm gets " << actual << " for " << name << ", not " << expected
+         << endl;
+    exit(EXIT_FAILURE);
+  }  // if
+  if (flags.selects("engines", "tree")) {
+    auto stats = run_trials(n, opts, [&] {
+      eval_t eval{&scope};
+      for (size_t i = 0; i < n; ++i) {
+        keep(apply(eval, *expr));
+      }  // for
+    }, &counters);
+    report.add({ name + " tree", n, stats, counters.get_counts() });
+  }  // if
+  if (flags.selects("engines", "vm")) {
+    auto stats = run_trials(n, opts, [&] {
+      for (size_t i = 0; i < n; ++i) {
+        keep(vm.eval(expr, scope));
+      }  // for
+    }, &counters);
+    report.add({ name + " vm", n, stats, counters.get_counts() });
+  }  // if
+}
+
+/* Evaluate each selected expression. */
+static void run_eval(const flags_t &flags, counters_t &counters,
+                     report_t &report) {
+  scope_t scope;
+  def_eval_scope(scope);
+  for (const auto &named : make_eval_exprs()) {
+    if (flags.selects("exprs", named.name)) {
+      run_engines(flags, counters, report, string("eval ") + named.name,
+                  named.expr, scope);
+    }  // if
+  }  // for
+}
+
+/* ---------------------------------------------------------------------------
+The nested suite.
+--------------------------------------------------------------------------- */
+
+/* The name of the given parameter of the lambda at the given depth. */
+static string get_param_name(size_t depth, size_t slot) {
+  return "p" + to_string(depth) + "_" + to_string(slot);
+}
+
+/* A lambda of width parameters, at the given depth of a nest of them, which
+   applies the next one in, if any, to its parameters, and otherwise sums
+   the last parameter of every lambda it's within, and its own first. */
+static expr_ptr_t make_nested_lambda(size_t depth, size_t depths,
+                                     size_t width) {
+  lambda_t::params_t params;
+  for (size_t slot = 0; slot < width; ++slot) {
+    params.push_back(get_param_name(depth, slot));
+  }  // for
+  expr_ptr_t def;
+  if (depth + 1 < depths) {
+    apply_t::args_t args;
+    for (size_t slot = 0; slot < width; ++slot) {
+      args.push_back(make_ref(get_param_name(depth, slot)));
+    }  // for
+    def = make_apply(make_nested_lambda(depth + 1, depths, width),
+                     move(args));
+  } else {
+    def = make_ref(get_param_name(depth, 0));
+    for (size_t outer = 0; outer <= depth; ++outer) {
+      def = make_shared<expr_t>(infix_t(
+          infix_t::add, def, make_ref(get_param_name(outer, width - 1))));
+    }  // for
+  }  // if
+  return make_lit(lambda_t(move(params), def));
+}
+
+/* Apply nests of lambdas, as deep and as wide as asked. */
+static void run_nested(const flags_t &flags, counters_t &counters,
+                       report_t &report) {
+  scope_t scope;
+  for (size_t depths : flags.get_sizes("depths", "1,4,16")) {
+    for (size_t width : flags.get_sizes("widths", "1,8,32")) {
+      if (!depths || !width) {
+        continue;
+      }  // if
+      apply_t::args_t args;
+      for (size_t slot = 0; slot < width; ++slot) {
+        args.push_back(make_lit(static_cast<int>(slot)));
+      }  // for
+      expr_ptr_t expr =
+          make_apply(make_nested_lambda(0, depths, width), move(args));
+      run_engines(flags, counters, report,
+                  "nested depth=" + to_string(depths) + " width=" +
+                      to_string(width),
+                  expr, scope);
+    }  // for
+  }  // for
+}
+
+/* ---------------------------------------------------------------------------
+The fold suite.
+--------------------------------------------------------------------------- */
+
+/* The number of nodes in the tree, counting the bodies of lambdas. */
+static size_t count_nodes(const expr_t &expr) {
+  if (const auto *that = expr.try_as<lit_t>()) {
+    const auto *lambda = that->val->try_as<lambda_t>();
+    return 1 + (lambda ? count_nodes(*lambda->def) : 0);
+  }  // if
+  if (const auto *that = expr.try_as<affix_t>()) {
+    return 1 + count_nodes(*that->arg);
+  }  // if
+  if (const auto *that = expr.try_as<infix_t>()) {
+    return 1 + count_nodes(*that->lhs) + count_nodes(*that->rhs);
+  }  // if
+  if (const auto *that = expr.try_as<apply_t>()) {
+    size_t size = 1 + count_nodes(*that->fn);
+    for (const auto &arg : that->args) {
+      size += count_nodes(*arg);
+    }  // for
+    return size;
+  }  // if
+  return 1;
+}
+
+/* A sum of the given number of int-valued terms, each made from one of a
+   few templates, with its literals drawn at random, in the way our config
+   generators write them. */
+static expr_ptr_t make_fold_expr(size_t terms) {
+  mt19937 gen(terms);
+  uniform_int_distribution<int> dist(2, 9);
+  expr_ptr_t sum;
+  for (size_t i = 0; i < terms; ++i) {
+    string a = to_string(dist(gen)), b = to_string(dist(gen)),
+           c = to_string(dist(gen));
+    string text;
+    switch (i % 6) {
+      case 0: {
+        text = "(" + a + " * " + b + " + " + c + ") * x";
+        break;
+      }
+      case 1: {
+        text = "x * 1 + 0 + y * " + a + " * " + b;
+        break;
+      }
+      case 2: {
+        text = "(\"a\" + \"b\" + \"c\" < s) * " + a;
+        break;
+      }
+      case 3: {
+        text = "not not (x < " + a + " * " + b + ")";
+        break;
+      }
+      case 4: {
+        text = "(1 and (y < " + a + ")) * " + b + " + 0";
+        break;
+      }
+      case 5: {
+        text = "(\"x\" * " + a + " < \"x\" * " + b + ") + 1 * y";
+        break;
+      }
+    }  // switch
+    expr_ptr_t term = parse_expr(text);
+    sum = sum ? make_shared<expr_t>(infix_t(infix_t::add, sum, term)) : term;
+  }  // for
+  return sum;
+}
+
+/* Evaluate generated sums, raw and folded. */
+static void run_fold(const flags_t &flags, counters_t &counters,
+                     report_t &report) {
+  scope_t scope;
+  def_eval_scope(scope);
+  for (size_t terms : flags.get_sizes("terms", "16,256")) {
+    if (!terms) {
+      continue;
+    }  // if
+    expr_ptr_t raw = make_fold_expr(terms), folded = fold(raw);
+    string expected = describe(apply(eval_t{&scope}, *raw));
+    string actual = describe(apply(eval_t{&scope}, *folded));
+    if (actual != expected) {
+      cerr << "folding gets " << actual << " for " << terms
+           << " terms, not " << expected << endl;
+      exit(EXIT_FAILURE);
+    }  // if
+    string name = "fold terms=" + to_string(terms);
+    run_engines(flags, counters, report,
+                name + " raw nodes=" + to_string(count_nodes(*raw)),
+                raw, scope);
+    run_engines(flags, counters, report,
+                name + " folded nodes=" + to_string(count_nodes(*folded)),
+                folded, scope);
+  }  // for
+}
+
+/* ---------------------------------------------------------------------------
+The guards suite.
+--------------------------------------------------------------------------- */
+
+/* The sum of the given number of rules, of which the given percentage of
+   guards pass, each joined to its costly part by op. */
+static expr_ptr_t make_rules(size_t rules, size_t pass, infix_t::op_t op) {
+  expr_ptr_t sum;
+  for (size_t i = 0; i < rules; ++i) {
+    /* x is 7, so x < 100 passes and x < 0 fails. */
+    expr_ptr_t guard = parse_expr(i * 100 < pass * rules ? "x < 100" : "x < 0");
+    /* poly (sq x) i y < 1000 */
+    expr_ptr_t costly = make_shared<expr_t>(infix_t(
+        infix_t::lt,
+        make_apply(make_ref("poly"),
+                   { make_apply(make_ref("sq"), { make_ref("x") }),
+                     make_lit(static_cast<int>(i)), make_ref("y") }),
+        make_lit(1000)));
+    expr_ptr_t rule = make_shared<expr_t>(infix_t(op, guard, costly));
+    sum = sum ? make_shared<expr_t>(infix_t(infix_t::add, sum, rule)) : rule;
+  }  // for
+  return sum;
+}
+
+/* Evaluate sets of guarded rules, with and and with mul. */
+static void run_guards(const flags_t &flags, counters_t &counters,
+                       report_t &report) {
+  scope_t scope;
+  def_eval_scope(scope);
+  size_t rules = flags.get_size("rules", 64);
+  if (!rules) {
+    return;
+  }  // if
+  for (size_t pass : flags.get_sizes("passes", "0,10,50,100")) {
+    string name = "guards rules=" + to_string(rules) + " pass=" +
+                  to_string(pass) + "% ";
+    run_engines(flags, counters, report, name + "and",
+                make_rules(rules, pass, infix_t::and_), scope);
+    run_engines(flags, counters, report, name + "mul",
+                make_rules(rules, pass, infix_t::mul), scope);
+  }  // for
+}
+
+/* ---------------------------------------------------------------------------
+The scan suite.
+--------------------------------------------------------------------------- */
+
+/* The scanner as it was before scanner_t scanned buffers: a character at
+   a time from an istream, through peek() and ignore(), accumulating each
+   token in an ostringstream, converting ints with an istringstream and
+   finding keywords in a map. */
+class stream_scanner_t final {
+  public:
+
+  /* No copying or moving. */
+  stream_scanner_t(const stream_scanner_t &) = delete;
+  stream_scanner_t &operator=(const stream_scanner_t &) = delete;
+
+  /* Scan the stream. */
+  stream_scanner_t(istream &strm)
+      : strm(strm) {}
+
+  /* The next token. */
+  const token_t *operator->() {
+    refresh_cache();
+    return &cached_token;
+  }
+
+  /* Go on to the one after it. */
+  stream_scanner_t &operator++() {
+    refresh_cache();
+    if (cached_token.kind != token_t::end) {
+      cached_token.val.reset();
+      token_is_cached = false;
+    }  // if
+    return *this;
+  }
+
+  private:
+
+  /* The kind of punctuation the character is, or end if none. */
+  static token_t::kind_t get_punct(int c) {
+    switch (c) {
+      case '(': return token_t::open_paren;
+      case ')': return token_t::close_paren;
+      case '+': return token_t::plus;
+      case '-': return token_t::minus;
+      case '*': return token_t::star;
+      case '<': return token_t::lt;
+      case '=': return token_t::eq;
+      case ',': return token_t::comma;
+    }  // switch
+    return token_t::end;
+  }
+
+  /* Scan a token, unless we have one. */
+  void refresh_cache() {
+    static const map<string, token_t::kind_t> kwds = {
+      { "and", token_t::and_kwd }, { "fn", token_t::fn_kwd },
+      { "int", token_t::int_kwd }, { "not", token_t::not_kwd },
+      { "or", token_t::or_kwd }, { "str", token_t::str_kwd }
+    };
+    enum { start, str_lit, int_lit, name } state = start;
+    ostringstream accum;
+    while (!token_is_cached) {
+      auto c = strm.peek();
+      switch (state) {
+        case start: {
+          token_t::kind_t punct = get_punct(c);
+          if (punct != token_t::end) {
+            strm.ignore();
+            cached_token.kind = punct;
+            token_is_cached = true;
+          } else if (c == '"') {
+            strm.ignore();
+            state = str_lit;
+          } else if (c < 0) {
+            cached_token.kind = token_t::end;
+            token_is_cached = true;
+          } else if (isspace(c)) {
+            strm.ignore();
+          } else if (isdigit(c)) {
+            state = int_lit;
+          } else if (isalpha(c) || c == '_') {
+            state = name;
+          } else {
+            throw runtime_error("bad character");
+          }  // if
+          break;
+        }
+        case str_lit: {
+          if (c < 0 || (c != '"' && !isprint(c))) {
+            throw runtime_error("bad string");
+          }  // if
+          strm.ignore();
+          if (c == '"') {
+            cached_token.kind = token_t::lit;
+            cached_token.val = make_shared<val_t>(accum.str());
+            token_is_cached = true;
+          } else {
+            accum.put(static_cast<char>(c));
+          }  // if
+          break;
+        }
+        case int_lit: {
+          if (isdigit(c)) {
+            strm.ignore();
+            accum.put(static_cast<char>(c));
+            break;
+          }  // if
+          istringstream digits(accum.str());
+          int temp;
+          digits >> temp;
+          cached_token.kind = token_t::lit;
+          cached_token.val = make_shared<val_t>(temp);
+          token_is_cached = true;
+          break;
+        }
+        case name: {
+          if (isalnum(c) || c == '_') {
+            strm.ignore();
+            accum.put(static_cast<char>(c));
+            break;
+          }  // if
+          auto iter = kwds.find(accum.str());
+          if (iter != kwds.end()) {
+            cached_token.kind = iter->second;
+          } else {
+            cached_token.kind = token_t::name;
+            cached_token.val = make_shared<val_t>(accum.str());
+          }  // if
+          token_is_cached = true;
+          break;
+        }
+      }  // switch
+    }  // while
+  }
+
+  /* Where we scan from. */
+  istream &strm;
+
+  /* True iff. cached_token is the next token. */
+  bool token_is_cached = false;
+
+  /* The next token. */
+  token_t cached_token;
+
+};  // stream_scanner_t
+
+/* Rule text of at least the given number of bytes, a rule to a line. */
+static string make_rule_text(size_t size) {
+  string text;
+  for (size_t i = 0; text.size() < size; ++i) {
+    string n = to_string(i);
+    switch (i % 4) {
+      case 0: {
+        text += "(x_" + n + " < " + n + " and not (limit_" + n +
+                " < total)) or flag_" + n + "\n";
+        break;
+      }
+      case 1: {
+        text += "fn amount, rate, = amount * rate + -" + n +
+                " * (1 + bonus_" + n + ")\n";
+        break;
+      }
+      case 2: {
+        text += "(str name_" + n + " + \"_suffix\") < \"rule_" + n +
+                "\" * 2\n";
+        break;
+      }
+      case 3: {
+        text += "int (str " + n + " + \"0\") + count_" + n +
+                " * 1048576 < 2147483647\n";
+        break;
+      }
+    }  // switch
+  }  // for
+  return text;
+}
+
+/* The number of tokens the scanner finds. */
+template <typename scanner_t>
+static size_t count_tokens(scanner_t &scanner) {
+  size_t count = 0;
+  for (; scanner->kind != token_t::end; ++scanner) {
+    ++count;
+  }  // for
+  return count;
+}
+
+/* Scan texts of the given sizes with each selected scanner. */
+static void run_scan(const flags_t &flags, counters_t &counters,
+                     report_t &report) {
+  auto opts = trial_opts_t::from(flags);
+  for (size_t size : flags.get_counts("bytes", "65536,4194304")) {
+    string text = make_rule_text(size);
+    size_t n = text.size();
+    istringstream strm(text);
+    stream_scanner_t expected_scanner(strm);
+    size_t expected = count_tokens(expected_scanner);
+    vector<pair<const char *, function<size_t ()>>> scanners = {
+      { "stream", [&] {
+          istringstream strm(text);
+          stream_scanner_t scanner(strm);
+          return count_tokens(scanner);
+        } },
+      { "buffer", [&] {
+          scanner_t scanner(text);
+          return count_tokens(scanner);
+        } },
+      { "istream", [&] {
+          istringstream strm(text);
+          scanner_t scanner(strm);
+          return count_tokens(scanner);
+        } }
+    };
+    for (const auto &named : scanners) {
+      if (!flags.selects("scanners", named.first)) {
+        continue;
+      }  // if
+      size_t actual = named.second();
+      if (actual != expected) {
+        cerr << named.first << " finds " << actual << " tokens, not "
+             << expected << endl;
+        exit(EXIT_FAILURE);
+      }  // if
+      auto stats = run_trials(n, opts, [&] {
+        keep(named.second());
+      }, &counters);
+      auto counts = counters.get_counts();
+      counts.push_back({ "MB/s", 1000 / stats.median });
+      report.add({ "scan bytes=" + to_string(n) + " " + named.first, n,
+                   stats, counts });
+    }  // for
+  }  // for
+}
+
+/* ---------------------------------------------------------------------------
+The parse suite.
+--------------------------------------------------------------------------- */
+
+/* The parser as it was before expr_parser_t climbed precedence, but with
+   and parsed as and: a function per level, each calling the next. */
+class descent_parser_t final {
+  public:
+
+  /* Parse an expression. */
+  static expr_ptr_t parse(scanner_t &scanner) {
+    return descent_parser_t(scanner).parse_expr();
+  }
+
+  private:
+
+  descent_parser_t(scanner_t &scanner)
+      : scanner(scanner) {}
+
+  expr_ptr_t parse_expr() {
+    if (scanner->kind != token_t::fn_kwd) {
+      return parse_or();
+    }  // if
+    ++scanner;
+    lambda_t::params_t params;
+    while (scanner->kind != token_t::eq) {
+      if (scanner->kind != token_t::name) {
+        throw runtime_error("expected a parameter");
+      }  // if
+      params.push_back(scanner->sym);
+      ++scanner;
+      match(token_t::comma);
+    }  // while
+    ++scanner;
+    return make_lit(lambda_t(move(params), parse_expr()));
+  }
+
+  expr_ptr_t parse_or() {
+    return parse_binary(token_t::or_kwd, infix_t::or_,
+                        &descent_parser_t::parse_and);
+  }
+
+  expr_ptr_t parse_and() {
+    return parse_binary(token_t::and_kwd, infix_t::and_,
+                        &descent_parser_t::parse_not);
+  }
+
+  expr_ptr_t parse_not() {
+    bool flag = false;
+    for (; scanner->kind == token_t::not_kwd; ++scanner) {
+      flag = !flag;
+    }  // for
+    expr_ptr_t result = parse_cmp();
+    return flag ? make_shared<expr_t>(affix_t(affix_t::not_, result))
+                : result;
+  }
+
+  expr_ptr_t parse_cmp() {
+    expr_ptr_t result = parse_arith();
+    if (scanner->kind == token_t::lt) {
+      ++scanner;
+      result = make_shared<expr_t>(
+          infix_t(infix_t::lt, result, parse_arith()));
+    }  // if
+    return result;
+  }
+
+  expr_ptr_t parse_arith() {
+    return parse_binary(token_t::plus, infix_t::add,
+                        &descent_parser_t::parse_term);
+  }
+
+  expr_ptr_t parse_term() {
+    return parse_binary(token_t::star, infix_t::mul,
+                        &descent_parser_t::parse_factor);
+  }
+
+  expr_ptr_t parse_factor() {
+    bool flag = false;
+    for (;; ++scanner) {
+      if (scanner->kind == token_t::minus) {
+        flag = !flag;
+      } else if (scanner->kind != token_t::plus) {
+        break;
+      }  // if
+    }  // for
+    expr_ptr_t result = parse_atom();
+    return flag ? make_shared<expr_t>(affix_t(affix_t::neg, result))
+                : result;
+  }
+
+  expr_ptr_t parse_atom() {
+    expr_ptr_t result;
+    switch (scanner->kind) {
+      case token_t::lit: {
+        result = make_shared<expr_t>(lit_t(scanner->val));
+        ++scanner;
+        break;
+      }
+      case token_t::name: {
+        result = make_shared<expr_t>(ref_t(scanner->sym));
+        ++scanner;
+        break;
+      }
+      case token_t::open_paren: {
+        ++scanner;
+        result = parse_expr();
+        match(token_t::close_paren);
+        break;
+      }
+      default: {
+        throw runtime_error("expected an atom");
+      }
+    }  // switch
+    return result;
+  }
+
+  /* Operands from the next level, joined by the operator. */
+  expr_ptr_t parse_binary(token_t::kind_t kind, infix_t::op_t op,
+                          expr_ptr_t (descent_parser_t::*next)()) {
+    expr_ptr_t result = (this->*next)();
+    while (scanner->kind == kind) {
+      ++scanner;
+      result = make_shared<expr_t>(infix_t(op, result, (this->*next)()));
+    }  // while
+    return result;
+  }
+
+  void match(token_t::kind_t kind) {
+    if (scanner->kind != kind) {
+      throw runtime_error("unexpected token");
+    }  // if
+    ++scanner;
+  }
+
+  scanner_t &scanner;
+
+};  // descent_parser_t
+
+/* True iff. the trees are alike, node for node. */
+static bool is_same_tree(const expr_t &lhs, const expr_t &rhs) {
+  if (lhs.get_index() != rhs.get_index()) {
+    return false;
+  }  // if
+  if (const auto *that = lhs.try_as<lit_t>()) {
+    const val_t &val = *that->val, &other = *rhs.as<lit_t>().val;
+    const auto *lambda = val.try_as<lambda_t>();
+    if (lambda || other.try_as<lambda_t>()) {
+      return lambda && other.try_as<lambda_t>() &&
+             lambda->params == other.as<lambda_t>().params &&
+             is_same_tree(*lambda->def, *other.as<lambda_t>().def);
+    }  // if
+    return describe(val) == describe(other) &&
+           !val.try_as<int>() == !other.try_as<int>();
+  }  // if
+  if (const auto *that = lhs.try_as<affix_t>()) {
+    const auto &other = rhs.as<affix_t>();
+    return that->op == other.op && is_same_tree(*that->arg, *other.arg);
+  }  // if
+  if (const auto *that = lhs.try_as<infix_t>()) {
+    const auto &other = rhs.as<infix_t>();
+    return that->op == other.op && is_same_tree(*that->lhs, *other.lhs) &&
+           is_same_tree(*that->rhs, *other.rhs);
+  }  // if
+  if (const auto *that = lhs.try_as<ref_t>()) {
+    return that->name == rhs.as<ref_t>().name;
+  }  // if
+  return false;
+}
+
+/* Rules, a line apiece, of at least the given number of bytes in all. */
+static vector<string> make_rules_to_parse(size_t size) {
+  vector<string> rules;
+  for (size_t i = 0, total = 0; total < size; ++i) {
+    string n = to_string(i);
+    switch (i % 4) {
+      case 0: {
+        rules.push_back("(x_" + n + " < " + n + " and not limit_" + n +
+                        " < total) or flag_" + n);
+        break;
+      }
+      case 1: {
+        rules.push_back("fn amount, rate, = amount * rate + -" + n +
+                        " * (1 + bonus_" + n + ")");
+        break;
+      }
+      case 2: {
+        rules.push_back("name_" + n + " + \"_suffix\" < \"rule_" + n +
+                        "\" * 2 or not enabled");
+        break;
+      }
+      case 3: {
+        rules.push_back("count_" + n + " * 1048576 + -(base + " + n +
+                        ") < 2147483647 and --x");
+        break;
+      }
+    }  // switch
+    total += rules.back().size();
+  }  // for
+  return rules;
+}
+
+/* Parse the texts with each selected parser, reporting under the name,
+   after checking that the parsers agree. */
+static void run_parsers(const flags_t &flags, counters_t &counters,
+                        report_t &report, const string &name,
+                        const vector<string> &texts) {
+  auto opts = trial_opts_t::from(flags);
+  size_t n = 0;
+  for (const auto &text : texts) {
+    n += text.size();
+    scanner_t expected_scanner(text), actual_scanner(text);
+    if (!is_same_tree(*descent_parser_t::parse(expected_scanner),
+                      *expr_parser_t::parse(actual_scanner))) {
+      cerr << "the parsers differ on " << text.substr(0, 80) << endl;
+      exit(EXIT_FAILURE);
+    }  // if
+  }  // for
+  vector<pair<const char *, function<expr_ptr_t (scanner_t &)>>> parsers = {
+    { "descent", &descent_parser_t::parse },
+    { "climb", &expr_parser_t::parse }
+  };
+  for (const auto &named : parsers) {
+    if (!flags.selects("parsers", named.first)) {
+      continue;
+    }  // if
+    auto stats = run_trials(n, opts, [&] {
+      for (const auto &text : texts) {
+        scanner_t scanner(text);
+        keep(named.second(scanner));
+      }  // for
+    }, &counters);
+    auto counts = counters.get_counts();
+    counts.push_back({ "MB/s", 1000 / stats.median });
+    report.add({ name + " " + named.first, n, stats, counts });
+  }  // for
+}
+
+/* Parse rules, and long sums. */
+static void run_parse(const flags_t &flags, counters_t &counters,
+                      report_t &report) {
+  size_t size = flags.get_count("rule-bytes", 1048576);
+  run_parsers(flags, counters, report,
+              "parse rules bytes=" + to_string(size),
+              make_rules_to_parse(size));
+  for (size_t terms : flags.get_sizes("sums", "1000,10000")) {
+    string text = "x";
+    for (size_t i = 1; i < terms; ++i) {
+      text += (i % 2) ? " + " + to_string(i) : " * y";
+    }  // for
+    run_parsers(flags, counters, report,
+                "parse sum terms=" + to_string(terms), { text });
+  }  // for
+}
+
+/* ---------------------------------------------------------------------------
+The rules suite.
+--------------------------------------------------------------------------- */
+
+/* The name of the given word of the vocabulary, as long as the names in our
+   rule files tend to be. */
+static string get_word(size_t idx) {
+  return "account_field_" + to_string(idx);
+}
+
+/* A corpus of the given number of rules over the given number of words. */
+static vector<string> make_corpus(size_t size, size_t vocab) {
+  mt19937 gen(size);
+  uniform_int_distribution<size_t> pick(0, vocab - 1);
+  uniform_int_distribution<int> num(0, 999);
+  auto word = [&] { return get_word(pick(gen)); };
+  vector<string> corpus;
+  for (size_t i = 0; i < size; ++i) {
+    string n = to_string(num(gen));
+    switch (i % 4) {
+      case 0: {
+        corpus.push_back("(" + word() + " < " + n + " and not " + word() +
+                         " < " + word() + ") or " + word() + " + " + n +
+                         " < " + word());
+        break;
+      }
+      case 1: {
+        corpus.push_back("to_str_" + to_string(pick(gen) % 8) +
+                         " + \"_status_suffix\" < \"customer_rule\" * 2 "
+                         "or not " + word());
+        break;
+      }
+      case 2: {
+        corpus.push_back(word() + " * " + n + " + -(" + word() + " + " + n +
+                         ") < " + word() + " and " + word());
+        break;
+      }
+      case 3: {
+        corpus.push_back(word() + " + " + word() + " * " + word() + " + " +
+                         word() + " * " + n + " < " + word() + " * " +
+                         word());
+        break;
+      }
+    }  // switch
+  }  // for
+  return corpus;
+}
+
+/* The bytes the heap holds, if we can tell. */
+static size_t get_heap_bytes() {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+/* Parse a corpus of rules, and evaluate each of them. */
+static void run_rules(const flags_t &flags, counters_t &counters,
+                      report_t &report) {
+  auto opts = trial_opts_t::from(flags);
+  size_t size = flags.get_size("corpus", 20000);
+  size_t vocab = flags.get_size("vocab", 500);
+  if (!size || !vocab) {
+    return;
+  }  // if
+  vector<string> corpus = make_corpus(size, vocab);
+  scope_t scope;
+  for (size_t i = 0; i < vocab; ++i) {
+    scope.def(get_word(i), static_cast<int>(i % 1000));
+  }  // for
+  for (size_t i = 0; i < 8; ++i) {
+    scope.def("to_str_" + to_string(i), string(i, 'a'));
+  }  // for
+  string name = "rules corpus=" + to_string(size) + " vocab=" +
+                to_string(vocab);
+  /* The heap it takes to hold the parsed corpus. */
+  vector<expr_ptr_t> exprs;
+  exprs.reserve(size);
+  size_t before = get_heap_bytes();
+  for (const auto &text : corpus) {
+    exprs.push_back(parse_expr(text));
+  }  // for
+  double bytes = static_cast<double>(get_heap_bytes() - before) / size;
+  if (flags.selects("engines", "parse")) {
+    auto stats = run_trials(size, opts, [&] {
+      for (const auto &text : corpus) {
+        keep(parse_expr(text));
+      }  // for
+    }, &counters);
+    auto counts = counters.get_counts();
+    if (before) {
+      counts.push_back({ "bytes", bytes });
+    }  // if
+    report.add({ name + " parse", size, stats, counts });
+  }  // if
+  vm_t vm;
+  for (const auto &expr : exprs) {
+    string expected = describe(apply(eval_t{&scope}, *expr));
+    string actual = describe(vm.eval(expr, scope));
+    if (actual != expected) {
+      cerr << "vm gets " << actual << " for a rule, not " << expected
+           << endl;
+      exit(EXIT_FAILURE);
+    }  // if
+  }  // for
+  if (flags.selects("engines", "tree")) {
+    auto stats = run_trials(size, opts, [&] {
+      eval_t eval{&scope};
+      for (const auto &expr : exprs) {
+        keep(apply(eval, *expr));
+      }  // for
+    }, &counters);
+    report.add({ name + " tree", size, stats, counters.get_counts() });
+  }  // if
+  if (flags.selects("engines", "vm")) {
+    auto stats = run_trials(size, opts, [&] {
+      for (const auto &expr : exprs) {
+        keep(vm.eval(expr, scope));
+      }  // for
+    }, &counters);
+    report.add({ name + " vm", size, stats, counters.get_counts() });
+  }  // if
+}
+
+int main(int argc, char *argv[]) {
+  flags_t flags(argc, argv);
+  counters_t counters(flags, cerr);
+  report_t report(cout, flags);
+  if (flags.selects("suites", "eval")) {
+    run_eval(flags, counters, report);
+  }  // if
+  if (flags.selects("suites", "nested")) {
+    run_nested(flags, counters, report);
+  }  // if
+  if (flags.selects("suites", "fold")) {
+    run_fold(flags, counters, report);
+  }  // if
+  if (flags.selects("suites", "guards")) {
+    run_guards(flags, counters, report);
+  }  // if
+  if (flags.selects("suites", "scan")) {
+    run_scan(flags, counters, report);
+  }  // if
+  if (flags.selects("suites", "parse")) {
+    run_parse(flags, counters, report);
+  }  // if
+  if (flags.selects("suites", "rules")) {
+    run_rules(flags, counters, report);
+  }  // if
+  return 0;
+}
@@ -0,0 +1,59 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The one translation unit which instantiates the variants of the calculator
+and the functors applied to them.  The headers declare these extern, so no
+other translation unit has to.  Link this module with anything that
+includes "calc.h".
+--------------------------------------------------------------------------- */
+
+#include "calc.h"
+
+#ifndef CALC_NO_EXTERN_TEMPLATES
+CPPCON14_VARIANT_INSTANTIATE(
+    int, std::string, cppcon14::calc::lambda_t, cppcon14::variant::null_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(
+    cppcon14::calc::neg_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(
+    cppcon14::calc::not_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(
+    cppcon14::calc::to_int_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(
+    cppcon14::calc::to_str_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(cppcon14::calc::add_t,
+                                   cppcon14::calc::val_variant_t,
+                                   cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(cppcon14::calc::mul_t,
+                                   cppcon14::calc::val_variant_t,
+                                   cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(cppcon14::calc::and_t,
+                                   cppcon14::calc::val_variant_t,
+                                   cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(cppcon14::calc::or_t,
+                                   cppcon14::calc::val_variant_t,
+                                   cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(cppcon14::calc::lt_t,
+                                   cppcon14::calc::val_variant_t,
+                                   cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_INSTANTIATE(cppcon14::calc::lit_t,
+                             cppcon14::calc::affix_t,
+                             cppcon14::calc::infix_t,
+                             cppcon14::calc::ref_t,
+                             cppcon14::calc::apply_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(
+    cppcon14::calc::eval_t, cppcon14::calc::expr_variant_t);
+CPPCON14_VARIANT_INSTANTIATE_APPLY(
+    const cppcon14::calc::eval_t, cppcon14::calc::expr_variant_t);
+#endif
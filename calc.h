@@ -0,0 +1,1063 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A little calculator language: scopes, expressions, evaluation, scanning and
+parsing.  The values it computes with are in "val.h".
+
+See "calc.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "symbol.h"
+#include "val.h"
+#include "variant.h"
+
+namespace cppcon14 {
+namespace calc {
+
+/* ---------------------------------------------------------------------------
+TODO
+--------------------------------------------------------------------------- */
+
+/* Room for the arguments of the lambdas being applied.  Frames are taken
+   and given back in stack order, each a contiguous run of values, from
+   chunks which, once allocated, are kept for reuse, so once the arena has
+   grown to the deepest nesting of calls, taking a frame allocates nothing.
+   Take frames through frame_t, which gives them back as it goes out of
+   scope, even if an exception is on its way through. */
+class frame_arena_t final {
+  public:
+
+  /* See below. */
+  class frame_t;
+
+  /* No copying. */
+  frame_arena_t(const frame_arena_t &) = delete;
+  frame_arena_t &operator=(const frame_arena_t &) = delete;
+
+  /* Start with no chunks. */
+  frame_arena_t() noexcept : top(0), size(0) {}
+
+  /* Every frame must have been given back. */
+  ~frame_arena_t() {
+    assert(!size);
+  }
+
+  /* The number of values' worth of room taken in frames now. */
+  size_t get_size() const noexcept {
+    assert(this);
+    return size;
+  }
+
+  private:
+
+  /* Room for one value. */
+  using slot_t = std::aligned_storage_t<sizeof(val_t), alignof(val_t)>;
+
+  /* A run of slots, the first used of which are in frames. */
+  struct chunk_t final {
+    std::unique_ptr<slot_t[]> slots;
+    size_t cap, used;
+  };
+
+  /* The fewest slots we allocate at once. */
+  static constexpr size_t min_chunk_size = 256;
+
+  /* Take room for n values.  Every chunk below the top is in use, so
+     giving back the last frame of the top chunk moves us down to one. */
+  val_t *alloc(size_t n) {
+    assert(this);
+    if (!n) {
+      return nullptr;
+    }
+    if (!chunks.empty() && chunks[top].used &&
+        chunks[top].used + n > chunks[top].cap) {
+      ++top;
+    }
+    if (top == chunks.size()) {
+      chunks.push_back({ nullptr, 0, 0 });
+    }
+    chunk_t &chunk = chunks[top];
+    if (chunk.used + n > chunk.cap) {
+      /* It's empty, but too small. */
+      chunk.cap = (n > min_chunk_size) ? n : min_chunk_size;
+      chunk.slots.reset(new slot_t[chunk.cap]);
+    }
+    slot_t *slots = chunk.slots.get() + chunk.used;
+    chunk.used += n;
+    size += n;
+    return reinterpret_cast<val_t *>(slots);
+  }
+
+  /* Give back the room for n values last taken. */
+  void free(size_t n) noexcept {
+    assert(this);
+    if (!n) {
+      return;
+    }
+    chunk_t &chunk = chunks[top];
+    assert(chunk.used >= n);
+    chunk.used -= n;
+    size -= n;
+    if (!chunk.used && top) {
+      --top;
+    }
+  }
+
+  /* The chunks, and the index of the last one in use. */
+  std::vector<chunk_t> chunks;
+  size_t top;
+
+  /* See get_size(). */
+  size_t size;
+
+};  // frame_arena_t
+
+/* The room for a fixed number of values, taken from an arena when
+   constructed and given back when destroyed, and the values pushed into it
+   so far. */
+class frame_arena_t::frame_t final {
+  public:
+
+  /* No copying. */
+  frame_t(const frame_t &) = delete;
+  frame_t &operator=(const frame_t &) = delete;
+
+  /* Take room for the given number of values. */
+  frame_t(frame_arena_t &arena, size_t size)
+      : arena(arena), size(size), count(0), slots(arena.alloc(size)) {}
+
+  /* Destroy the values pushed and give back the room. */
+  ~frame_t() {
+    while (count) {
+      slots[--count].~val_t();
+    }
+    arena.free(size);
+  }
+
+  /* Add a value after those pushed so far, of which there mustn't already
+     be as many as we have room for. */
+  void push(val_t &&val) {
+    assert(this);
+    assert(count < size);
+    new (slots + count) val_t(std::move(val));
+    ++count;
+  }
+
+  /* The values pushed so far. */
+  const val_t *get_slots() const noexcept {
+    assert(this);
+    return slots;
+  }
+
+  private:
+
+  /* The arena we took our room from. */
+  frame_arena_t &arena;
+
+  /* The number of values we have room for, and have pushed. */
+  size_t size, count;
+
+  /* Our room. */
+  val_t *slots;
+
+};  // frame_arena_t::frame_t
+
+/* TODO */
+class scope_t final {
+  public:
+
+  /* TODO */
+  scope_t(const scope_t &) = delete;
+  scope_t &operator=(const scope_t &) = delete;
+
+  /* The definitions, by the ids of their names. */
+  using defs_t = std::unordered_map<symbol_t, val_t, symbol_t::hash_t>;
+
+  /* TODO */
+  explicit scope_t(const scope_t *parent = nullptr) noexcept : parent(parent) {}
+
+  /* A frame, in which the lambda's parameters have the values in slots, one
+     for each.  Neither is copied, so both must outlive the scope.  The
+     parameters hide anything def()'d here, and, like def(), a later
+     parameter hides an earlier one of the same name. */
+  scope_t(const scope_t *parent, const lambda_t::params_t &params,
+          const val_t *slots) noexcept
+      : parent(parent), params(&params), slots(slots) {}
+
+  /* TODO */
+  void def(symbol_t name, val_t &&val) {
+    assert(this);
+    defs[name] = std::move(val);
+  }
+
+  /* TODO */
+  const val_t &ref(symbol_t name) const {
+    assert(this);
+    const scope_t *scope = this;
+    do {
+      if (scope->params) {
+        for (size_t i = scope->params->size(); i-- > 0; ) {
+          if ((*scope->params)[i] == name) {
+            return scope->slots[i];
+          }
+        }
+      }
+      auto iter = scope->defs.find(name);
+      if (iter != scope->defs.end()) {
+        return iter->second;
+      }
+      scope = scope->parent;
+    } while (scope);
+    throw undef_ref_error_t();
+  }
+
+  private:
+
+  /* TODO */
+  const scope_t *parent;
+
+  /* If we're a frame, the parameters and their values. */
+  const lambda_t::params_t *params = nullptr;
+  const val_t *slots = nullptr;
+
+  /* TODO */
+  defs_t defs;
+
+};  // scope_t;
+
+
+/* ---------------------------------------------------------------------------
+TODO
+--------------------------------------------------------------------------- */
+
+/* TODO */
+struct lit_t final {
+  lit_t(const val_ptr_t &val) : val(val) {}
+  val_ptr_t val;
+};
+
+/* TODO */
+struct affix_t final {
+  enum op_t {
+    neg,
+    not_,
+    to_int,
+    to_str
+  };
+  affix_t(op_t op, expr_ptr_t arg) : op(op), arg(std::move(arg)) {}
+  op_t op;
+  expr_ptr_t arg;
+};
+
+/* TODO */
+struct infix_t final {
+  enum op_t {
+    add,
+    mul,
+    lt,
+    and_,
+    or_
+  };
+  infix_t(op_t op, expr_ptr_t lhs, expr_ptr_t rhs)
+      : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
+  op_t op;
+  expr_ptr_t lhs, rhs;
+};
+
+/* TODO */
+struct ref_t final {
+  ref_t(symbol_t name) : name(name) {}
+  symbol_t name;
+};
+
+/* TODO */
+struct apply_t final {
+  using args_t = std::vector<expr_ptr_t>;
+  apply_t(const expr_ptr_t &fn, args_t args)
+      : fn(fn), args(std::move(args)) {}
+  expr_ptr_t fn;
+  args_t args;
+};
+
+/* The variant underlying expr_t. */
+using expr_variant_t =
+    variant::variant_t<lit_t, affix_t, infix_t, ref_t, apply_t>;
+
+/* TODO */
+struct expr_t final
+    : public expr_variant_t {
+  using variant_t::variant_t;
+};
+
+/* ---------------------------------------------------------------------------
+TODO
+--------------------------------------------------------------------------- */
+
+/* TODO */
+struct eval_t final {
+
+  /* TODO */
+  using ret_t = val_t;
+
+  /* TODO */
+  val_t operator()(std::nullptr_t) const { return val_t(); }
+
+  /* TODO */
+  val_t operator()(const lit_t &that) const {
+    return *that.val;
+  }
+
+  /* TODO */
+  val_t operator()(const affix_t &that) const {
+    val_t result, arg = apply(*this, *that.arg);
+    switch (that.op) {
+      case affix_t::neg: {
+        result = apply(neg_t(), arg);
+        break;
+      }
+      case affix_t::not_: {
+        result = apply(not_t(), arg);
+        break;
+      }
+      case affix_t::to_int: {
+        result = apply(to_int_t(), arg);
+        break;
+      }
+      case affix_t::to_str: {
+        result = apply(to_str_t(), arg);
+        break;
+      }
+    }  // switch
+    return std::move(result);
+  }
+
+  /* And and or short-circuit: if the left operand is an int which decides
+     the result, the right one isn't evaluated at all, so neither its cost
+     nor its errors are incurred.  Otherwise, both go to the functor as
+     before, which is what throws if the left one isn't an int. */
+  val_t operator()(const infix_t &that) const {
+    val_t result, lhs = apply(*this, *that.lhs);
+    if (that.op == infix_t::and_ || that.op == infix_t::or_) {
+      bool is_or = (that.op == infix_t::or_);
+      const int *val = lhs.try_as<int>();
+      if (val && (*val != 0) == is_or) {
+        return static_cast<int>(is_or);
+      }  // if
+    }  // if
+    val_t rhs = apply(*this, *that.rhs);
+    switch (that.op) {
+      case infix_t::add: {
+        result = apply(add_t(), lhs, rhs);
+        break;
+      }
+      case infix_t::mul: {
+        result = apply(mul_t(), lhs, rhs);
+        break;
+      }
+      case infix_t::lt: {
+        result = apply(lt_t(), lhs, rhs);
+        break;
+      }
+      case infix_t::and_: {
+        result = apply(and_t(), lhs, rhs);
+        break;
+      }
+      case infix_t::or_: {
+        result = apply(or_t(), lhs, rhs);
+        break;
+      }
+    }  // switch
+    return std::move(result);
+  }
+
+  /* TODO */
+  val_t operator()(const ref_t &that) const {
+    return scope->ref(that.name);
+  }
+
+  /* TODO */
+  val_t operator()(const apply_t &that) const {
+    /* Get the lambda we're going to apply. */
+    val_t temp;
+    const auto *lambda = get_fn(*that.fn, temp).try_as<lambda_t>();
+    if (!lambda || lambda->params.size() != that.args.size()) {
+      throw type_mismatch_error_t();
+    }
+    /* Evaluate the arguments into a frame and put them into scope. */
+    frame_arena_t::frame_t frame(get_arena(), that.args.size());
+    for (const auto &arg : that.args) {
+      frame.push(apply(*this, *arg));
+    }
+    scope_t local_scope(scope, lambda->params, frame.get_slots());
+    /* Evaluate the lambda's definition. */
+    return apply(eval_t{&local_scope}, *lambda->def);
+  }
+
+  /* The frames of the lambdas this thread is applying. */
+  static frame_arena_t &get_arena() {
+    static thread_local frame_arena_t arena;
+    return arena;
+  }
+
+  const scope_t *scope;
+
+  private:
+
+  /* The value of the lambda to apply.  A ref or a literal we find where it
+     lies, rather than copying it, parameters and all; anything else we
+     evaluate into temp. */
+  const val_t &get_fn(const expr_t &fn, val_t &temp) const {
+    if (const auto *that = fn.try_as<ref_t>()) {
+      return scope->ref(that->name);
+    }
+    if (const auto *that = fn.try_as<lit_t>()) {
+      return *that->val;
+    }
+    temp = apply(*this, fn);
+    return temp;
+  }
+
+};
+
+/* ---------------------------------------------------------------------------
+TODO
+--------------------------------------------------------------------------- */
+
+/* TODO */
+struct token_t final {
+  enum kind_t {
+    end,
+    open_paren,
+    close_paren,
+    plus,
+    minus,
+    star,
+    lt,
+    eq,
+    comma,
+    lit,
+    name,
+    and_kwd,
+    fn_kwd,
+    int_kwd,
+    not_kwd,
+    or_kwd,
+    str_kwd
+  };
+  kind_t kind;
+  val_ptr_t val;
+  symbol_t sym;
+};
+
+/* The value of a string literal, shared by every literal of the same
+   string, so that repeating a literal costs no more room. */
+inline val_ptr_t get_str_lit(symbol_t str) {
+  static std::mutex mutex;
+  static std::vector<val_ptr_t> lits;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (lits.size() <= str.get_id()) {
+    lits.resize(str.get_id() + 1);
+  }
+  val_ptr_t &lit = lits[str.get_id()];
+  if (!lit) {
+    lit = std::make_shared<val_t>(str.get_name());
+  }
+  return lit;
+}
+
+/* ---------------------------------------------------------------------------
+TODO
+--------------------------------------------------------------------------- */
+
+/* Scans tokens directly out of a contiguous run of characters, such as a
+   string or a memory-mapped file, by pointer.  Ints are converted as
+   they're scanned, and keywords are matched by a switch on their length and
+   first letter.  Names are interned, becoming the symbols of the tokens,
+   and so are string literals, whose values are shared by get_str_lit(). */
+class scanner_t final {
+  public:
+
+  /* No copying or moving. */
+  scanner_t(const scanner_t &) = delete;
+  scanner_t &operator=(const scanner_t &) = delete;
+
+  /* Scan the characters from start up to limit, which must outlive us. */
+  scanner_t(const char *start, const char *limit)
+      : cursor(start), limit(limit), token_is_cached(false) {
+    assert(start <= limit);
+  }
+
+  /* Scan the text, which must outlive us. */
+  scanner_t(const std::string &text)
+      : scanner_t(text.data(), text.data() + text.size()) {}
+
+  /* Scan the rest of the stream, which we read into a buffer of our own
+     all at once. */
+  scanner_t(std::istream &strm)
+      : buffer(std::istreambuf_iterator<char>(strm),
+               std::istreambuf_iterator<char>()),
+        cursor(buffer.data()), limit(buffer.data() + buffer.size()),
+        token_is_cached(false) {
+    assert(strm);
+  }
+
+  /* TODO */
+  const token_t &operator*() const {
+    assert(this);
+    refresh_cache();
+    return cached_token;
+  }
+
+  /* TODO */
+  const token_t *operator->() const {
+    assert(this);
+    refresh_cache();
+    return &cached_token;
+  }
+
+  /* TODO */
+  scanner_t &operator++() {
+    assert(this);
+    refresh_cache();
+    if (token_is_cached && cached_token.kind != token_t::end) {
+      cached_token.val.reset();
+      token_is_cached = false;
+    }
+    return *this;
+  }
+
+  private:
+
+  /* The <cctype> tests, for chars, which may be negative. */
+  static bool is_space(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  }
+
+  static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+  }
+
+  static bool is_name_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+  }
+
+  static bool is_name_part(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+  }
+
+  /* The keyword the size characters at start spell, or name if none. */
+  static token_t::kind_t get_kwd(const char *start, size_t size) {
+    switch (size) {
+      case 2: {
+        if (start[0] == 'f' && start[1] == 'n') {
+          return token_t::fn_kwd;
+        }
+        if (start[0] == 'o' && start[1] == 'r') {
+          return token_t::or_kwd;
+        }
+        break;
+      }
+      case 3: {
+        switch (start[0]) {
+          case 'a': {
+            return std::memcmp(start, "and", 3)
+                ? token_t::name : token_t::and_kwd;
+          }
+          case 'i': {
+            return std::memcmp(start, "int", 3)
+                ? token_t::name : token_t::int_kwd;
+          }
+          case 'n': {
+            return std::memcmp(start, "not", 3)
+                ? token_t::name : token_t::not_kwd;
+          }
+          case 's': {
+            return std::memcmp(start, "str", 3)
+                ? token_t::name : token_t::str_kwd;
+          }
+        }  // switch
+        break;
+      }
+    }  // switch
+    return token_t::name;
+  }
+
+  /* Cache the next token, unless we already have. */
+  void refresh_cache() const {
+    assert(this);
+    if (token_is_cached) {
+      return;
+    }
+    while (cursor != limit && is_space(*cursor)) {
+      ++cursor;
+    }
+    token_is_cached = true;
+    if (cursor == limit) {
+      cached_token.kind = token_t::end;
+      return;
+    }
+    const char *start = cursor++;
+    switch (*start) {
+      case '(': {
+        cached_token.kind = token_t::open_paren;
+        break;
+      }
+      case ')': {
+        cached_token.kind = token_t::close_paren;
+        break;
+      }
+      case '+': {
+        cached_token.kind = token_t::plus;
+        break;
+      }
+      case '-': {
+        cached_token.kind = token_t::minus;
+        break;
+      }
+      case '*': {
+        cached_token.kind = token_t::star;
+        break;
+      }
+      case '<': {
+        cached_token.kind = token_t::lt;
+        break;
+      }
+      case '=': {
+        cached_token.kind = token_t::eq;
+        break;
+      }
+      case ',': {
+        cached_token.kind = token_t::comma;
+        break;
+      }
+      case '"': {
+        for (;;) {
+          if (cursor == limit) {
+            throw;
+          }
+          if (*cursor == '"') {
+            break;
+          }
+          if (!std::isprint(static_cast<unsigned char>(*cursor))) {
+            throw;
+          }
+          ++cursor;
+        }  // for
+        cached_token.kind = token_t::lit;
+        cached_token.val =
+            get_str_lit(symbol_t(start + 1, cursor - (start + 1)));
+        ++cursor;
+        break;
+      }
+      default: {
+        if (is_digit(*start)) {
+          /* Too big a literal becomes the biggest int, as it did when we
+             read it with a stream. */
+          long long val = *start - '0';
+          while (cursor != limit && is_digit(*cursor)) {
+            if (val <= std::numeric_limits<int>::max()) {
+              val = val * 10 + (*cursor - '0');
+            }
+            ++cursor;
+          }
+          if (val > std::numeric_limits<int>::max()) {
+            val = std::numeric_limits<int>::max();
+          }
+          cached_token.kind = token_t::lit;
+          cached_token.val = std::make_shared<val_t>(static_cast<int>(val));
+          break;
+        }
+        if (is_name_start(*start)) {
+          while (cursor != limit && is_name_part(*cursor)) {
+            ++cursor;
+          }
+          cached_token.kind = get_kwd(start, cursor - start);
+          if (cached_token.kind == token_t::name) {
+            cached_token.sym = symbol_t(start, cursor - start);
+          }
+          break;
+        }
+        throw;
+      }
+    }  // switch
+  }
+
+  /* The text, if we read it from a stream. */
+  std::string buffer;
+
+  /* The next character to scan, and the end of the text. */
+  mutable const char *cursor;
+  const char *limit;
+
+  /* TODO */
+  mutable bool token_is_cached;
+
+  /* TODO */
+  mutable token_t cached_token;
+
+};  // scanner_t
+
+
+/* ---------------------------------------------------------------------------
+TODO
+--------------------------------------------------------------------------- */
+
+/* Parses expressions by precedence climbing, in one loop, with a stack of
+   the operators, parentheses and lambdas still waiting for their operands
+   instead of a function per level of precedence, so that neither long
+   chains of operators nor deep nests of parentheses use any more of the
+   machine's stack.
+
+   In order of precedence, from loosest to tightest, the grammar is:
+
+     expr   = "fn" (name ",")* "=" expr | or
+     or     = and ("or" and)*
+     and    = not ("and" not)*
+     not    = "not"* cmp
+     cmp    = arith ["<" arith]
+     arith  = term ("+" term)*
+     term   = factor ("*" factor)*
+     factor = ("+" | "-")* atom
+     atom   = lit | name | "(" expr ")"
+
+   A run of nots, or of minuses, becomes one operator, or none if there are
+   an even number of them.  Parsing stops at the first token which can't go
+   on with the expression. */
+class expr_parser_t final {
+  public:
+
+  /* TODO */
+  static expr_ptr_t parse(scanner_t &scanner) {
+    return expr_parser_t(scanner).parse_expr();
+  }
+
+  private:
+
+  /* The levels of precedence, loosest first.  An operand begun at a level
+     may start with the prefixes of that level and those after it. */
+  enum prec_t {
+    none_prec,
+    expr_prec,
+    or_prec,
+    and_prec,
+    not_prec,
+    cmp_prec,
+    arith_prec,
+    term_prec,
+    factor_prec
+  };
+
+  /* A binary operator, as found in the table by the token which spells it:
+     its precedence, or none_prec for a token which isn't one; the operator
+     itself; and whether it associates left, as all but < do. */
+  struct binary_op_t final {
+    prec_t prec;
+    infix_t::op_t op;
+    bool is_left_assoc;
+  };
+
+  /* An operator, parenthesis or lambda waiting for its last operand. */
+  struct pending_t final {
+    enum kind_t { paren, lambda, prefix, binary };
+    pending_t(kind_t kind)
+        : kind(kind), prec(expr_prec) {}
+    pending_t(prec_t prec, affix_t::op_t affix_op)
+        : kind(prefix), prec(prec), affix_op(affix_op) {}
+    pending_t(prec_t prec, infix_t::op_t infix_op)
+        : kind(binary), prec(prec), infix_op(infix_op) {}
+    kind_t kind;
+    prec_t prec;
+    affix_t::op_t affix_op;
+    infix_t::op_t infix_op;
+    lambda_t::params_t params;
+  };
+
+  /* TODO */
+  expr_parser_t(scanner_t &scanner)
+      : scanner(scanner) {
+    operands.reserve(16);
+    pending.reserve(16);
+  }
+
+  /* The binary operator the token spells. */
+  static const binary_op_t &get_binary_op(token_t::kind_t kind) {
+    static const binary_op_t table[] = {
+      /* end         */ { none_prec, infix_t::add, true },
+      /* open_paren  */ { none_prec, infix_t::add, true },
+      /* close_paren */ { none_prec, infix_t::add, true },
+      /* plus        */ { arith_prec, infix_t::add, true },
+      /* minus       */ { none_prec, infix_t::add, true },
+      /* star        */ { term_prec, infix_t::mul, true },
+      /* lt          */ { cmp_prec, infix_t::lt, false },
+      /* eq          */ { none_prec, infix_t::add, true },
+      /* comma       */ { none_prec, infix_t::add, true },
+      /* lit         */ { none_prec, infix_t::add, true },
+      /* name        */ { none_prec, infix_t::add, true },
+      /* and_kwd     */ { and_prec, infix_t::and_, true },
+      /* fn_kwd      */ { none_prec, infix_t::add, true },
+      /* int_kwd     */ { none_prec, infix_t::add, true },
+      /* not_kwd     */ { none_prec, infix_t::add, true },
+      /* or_kwd      */ { or_prec, infix_t::or_, true },
+      /* str_kwd     */ { none_prec, infix_t::add, true }
+    };
+    static_assert(sizeof(table) / sizeof(table[0]) == token_t::str_kwd + 1,
+                  "one row per kind of token");
+    return table[kind];
+  }
+
+  /* TODO */
+  expr_ptr_t parse_expr() {
+    assert(this);
+    prec_t prec = expr_prec;
+    do {
+      parse_operand(prec);
+    } while (parse_operator(prec));
+    while (!pending.empty()) {
+      if (pending.back().kind == pending_t::paren) {
+        throw;
+      }
+      reduce();
+    }
+    assert(operands.size() == 1);
+    return std::move(operands.back());
+  }
+
+  /* Parse an operand begun at the given level of precedence: its prefixes,
+     which we leave pending, and then the atom they apply to.  An open
+     parenthesis begins a new expression, so we go around again. */
+  void parse_operand(prec_t prec) {
+    assert(this);
+    for (;;) {
+      if (prec <= expr_prec && scanner->kind == token_t::fn_kwd) {
+        ++scanner;
+        pending_t lambda(pending_t::lambda);
+        for (;;) {
+          if (scanner->kind == token_t::eq) {
+            ++scanner;
+            break;
+          }
+          if (scanner->kind != token_t::name) {
+            throw;
+          }
+          lambda.params.push_back(scanner->sym);
+          ++scanner;
+          match(token_t::comma);
+        }
+        pending.push_back(std::move(lambda));
+        continue;
+      }
+      if (prec < not_prec) {
+        if (skip_odd(token_t::not_kwd, token_t::not_kwd)) {
+          pending.emplace_back(not_prec, affix_t::not_);
+        }
+      }
+      if (skip_odd(token_t::minus, token_t::plus)) {
+        pending.emplace_back(factor_prec, affix_t::neg);
+      }
+      switch (scanner->kind) {
+        case token_t::lit: {
+          operands.push_back(std::make_shared<expr_t>(lit_t(scanner->val)));
+          ++scanner;
+          return;
+        }
+        case token_t::name: {
+          operands.push_back(std::make_shared<expr_t>(ref_t(scanner->sym)));
+          ++scanner;
+          return;
+        }
+        case token_t::open_paren: {
+          ++scanner;
+          pending.emplace_back(pending_t::paren);
+          ++open_paren_count;
+          prec = expr_prec;
+          break;
+        }
+        default: {
+          throw;
+        }
+      }  // switch
+    }  // for
+  }
+
+  /* Parse what follows an operand: close parentheses, and then a binary
+     operator, which we leave pending, returning true, with prec set to its
+     level, for its right operand.  Return false if the expression ends
+     here instead. */
+  bool parse_operator(prec_t &prec) {
+    assert(this);
+    for (;;) {
+      const binary_op_t &op = get_binary_op(scanner->kind);
+      if (op.prec != none_prec) {
+        /* Apply what binds at least as tightly, or, for an operator
+           associating neither way, more tightly.  If that leaves another
+           of the same operator pending, this one can't go on with it. */
+        reduce(op.is_left_assoc ? op.prec : static_cast<prec_t>(op.prec + 1));
+        if (!op.is_left_assoc && !pending.empty() &&
+            pending.back().kind == pending_t::binary &&
+            pending.back().infix_op == op.op) {
+          return false;
+        }
+        ++scanner;
+        pending.emplace_back(op.prec, op.op);
+        prec = op.prec;
+        return true;
+      }
+      if (scanner->kind != token_t::close_paren || !open_paren_count) {
+        return false;
+      }
+      while (pending.back().kind != pending_t::paren) {
+        reduce();
+      }
+      pending.pop_back();
+      --open_paren_count;
+      ++scanner;
+    }  // for
+  }
+
+  /* Skip a run of tokens of either kind, returning true iff. there were an
+     odd number of the first kind among them. */
+  bool skip_odd(token_t::kind_t odd, token_t::kind_t even) {
+    assert(this);
+    bool is_odd = false;
+    for (;;) {
+      if (scanner->kind == odd) {
+        is_odd = !is_odd;
+      } else if (scanner->kind != even) {
+        break;
+      }
+      ++scanner;
+    }
+    return is_odd;
+  }
+
+  /* Apply the pending operators which bind at least as tightly as prec,
+     stopping at any parenthesis or lambda. */
+  void reduce(prec_t prec) {
+    assert(this);
+    while (!pending.empty() &&
+           (pending.back().kind == pending_t::prefix ||
+            pending.back().kind == pending_t::binary) &&
+           pending.back().prec >= prec) {
+      reduce();
+    }
+  }
+
+  /* Apply the last pending operator or lambda to the operands it's been
+     waiting for. */
+  void reduce() {
+    assert(this);
+    pending_t &top = pending.back();
+    expr_ptr_t &last = operands.back();
+    switch (top.kind) {
+      case pending_t::paren: {
+        assert(false);
+        break;
+      }
+      case pending_t::lambda: {
+        last = std::make_shared<expr_t>(lit_t(std::make_shared<val_t>(
+            lambda_t(std::move(top.params), last))));
+        break;
+      }
+      case pending_t::prefix: {
+        last = std::make_shared<expr_t>(
+            affix_t(top.affix_op, std::move(last)));
+        break;
+      }
+      case pending_t::binary: {
+        expr_ptr_t rhs = std::move(last);
+        operands.pop_back();
+        operands.back() = std::make_shared<expr_t>(infix_t(
+            top.infix_op, std::move(operands.back()), std::move(rhs)));
+        break;
+      }
+    }  // switch
+    pending.pop_back();
+  }
+
+  /* TODO */
+  void match(token_t::kind_t kind) {
+    assert(this);
+    if (scanner->kind != kind) {
+      throw;
+    }
+    ++scanner;
+  }
+
+  /* TODO */
+  scanner_t &scanner;
+
+  /* The operands parsed but not yet given to their operators. */
+  std::vector<expr_ptr_t> operands;
+
+  /* The operators, parentheses and lambdas waiting for operands, the
+     innermost last. */
+  std::vector<pending_t> pending;
+
+  /* The number of parentheses among them. */
+  size_t open_paren_count = 0;
+
+};  // expr_parser_t
+
+/* TODO */
+inline expr_ptr_t parse_expr(const std::string &text) {
+  scanner_t scanner(text);
+  return expr_parser_t::parse(scanner);
+}
+
+/* TODO */
+inline val_t eval(const std::string &text) {
+  scope_t scope;
+  return apply(eval_t{&scope}, *parse_expr(text));
+}
+
+/* TODO */
+inline std::string eval_as_str(const std::string &text) {
+  return apply(to_str_t(), eval(text)).as<std::string>();
+}
+
+}  // calc
+}  // cppcon14
+
+/* The variant underlying expr_t, and the evaluator as applied to it, are
+   instantiated just once, in "calc.cc". */
+#ifndef CALC_NO_EXTERN_TEMPLATES
+CPPCON14_VARIANT_EXTERN(cppcon14::calc::lit_t,
+                        cppcon14::calc::affix_t,
+                        cppcon14::calc::infix_t,
+                        cppcon14::calc::ref_t,
+                        cppcon14::calc::apply_t);
+CPPCON14_VARIANT_EXTERN_APPLY(
+    cppcon14::calc::eval_t, cppcon14::calc::expr_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(
+    const cppcon14::calc::eval_t, cppcon14::calc::expr_variant_t);
+#endif
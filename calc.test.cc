@@ -13,179 +13,19 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 
-TODO
+Unit tests for and examples of the calculator in "calc.h".
 --------------------------------------------------------------------------- */
 
-#include "variant.h"
+#include "calc.h"
 
-#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
-#include <vector>
 
 #include "lick.h"
 
 using namespace std;
-using namespace cppcon14::variant;
-
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-struct expr_t;
-using expr_ptr_t = shared_ptr<expr_t>;
-
-/* TODO */
-struct val_t;
-using val_ptr_t = shared_ptr<val_t>;
-
-/* TODO */
-class type_mismatch_error_t final : public runtime_error {
-  public:
-  type_mismatch_error_t() : runtime_error("type mismatch error") {}
-};
-
-/* TODO */
-class null_value_error_t final : public runtime_error {
-  public:
-  null_value_error_t() : runtime_error("null value error") {}
-};
-
-/* TODO */
-class undef_ref_error_t final : public runtime_error {
-  public:
-  undef_ref_error_t() : runtime_error("undefined ref error") {}
-};
-
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-struct lambda_t final {
-  using params_t = vector<string>;
-  lambda_t(params_t &&params, const expr_ptr_t &def)
-      : params(move(params)), def(move(def)) {}
-  params_t params;
-  expr_ptr_t def;
-};
-
-/* TODO */
-struct val_t final : public variant_t<int, string, lambda_t, null_t> {
-  using variant_t::variant_t;
-};
-
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-struct unary_val_functor_t {
-  using ret_t = val_t;
-  val_t operator()(null_t) const { throw null_value_error_t(); }
-  template <typename that_t>
-  val_t operator()(const that_t &) const {
-    throw type_mismatch_error_t();
-  }
-};
-
-/* TODO */
-struct binary_val_functor_t {
-  using ret_t = val_t;
-  val_t operator()(null_t, null_t) const { throw null_value_error_t(); }
-  template <typename lhs_t>
-  val_t operator()(const lhs_t &, null_t) const {
-    throw null_value_error_t();
-  }
-  template <typename rhs_t>
-  val_t operator()(null_t, const rhs_t &) const {
-    throw null_value_error_t();
-  }
-  template <typename lhs_t, typename rhs_t>
-  val_t operator()(const lhs_t &, const rhs_t &) const {
-    throw type_mismatch_error_t();
-  }
-};
-
-/* TODO */
-struct neg_t final : unary_val_functor_t {
-  using unary_val_functor_t::operator();
-  val_t operator()(int that) const { return -that; }
-};
-
-/* TODO */
-struct not_t final : unary_val_functor_t {
-  using unary_val_functor_t::operator();
-  val_t operator()(int that) const { return static_cast<int>(!that); }
-};
-
-/* TODO */
-struct to_int_t final : unary_val_functor_t {
-  using unary_val_functor_t::operator();
-  val_t operator()(int that) const { return that; }
-  val_t operator()(const string &that) const { return stoi(that); }
-};
-
-/* TODO */
-struct to_str_t final : unary_val_functor_t {
-  using unary_val_functor_t::operator();
-  val_t operator()(int that) const {
-    ostringstream strm;
-    strm << that;
-    return strm.str();
-  }
-  val_t operator()(const string &that) const { return that; }
-};
-
-/* TODO */
-struct add_t final : binary_val_functor_t {
-  using binary_val_functor_t::operator();
-  val_t operator()(int lhs, int rhs) const { return lhs + rhs; }
-  val_t operator()(const string &lhs, const string &rhs) const {
-    return lhs + rhs;
-  }
-};
-
-/* TODO */
-struct mul_t final : binary_val_functor_t {
-  using binary_val_functor_t::operator();
-  val_t operator()(int lhs, int rhs) const { return lhs * rhs; }
-  val_t operator()(const string &lhs, int rhs) const {
-    ostringstream strm;
-    for (int i = 0; i < rhs; ++i) {
-      strm << lhs;
-    }
-    return strm.str();
-  }
-};
-
-/* TODO */
-struct and_t final : binary_val_functor_t {
-  using binary_val_functor_t::operator();
-  val_t operator()(int lhs, int rhs) const {
-    return static_cast<int>(lhs && rhs);
-  }
-};
-
-/* TODO */
-struct or_t final : binary_val_functor_t {
-  using binary_val_functor_t::operator();
-  val_t operator()(int lhs, int rhs) const {
-    return static_cast<int>(lhs || rhs);
-  }
-};
-
-/* TODO */
-struct lt_t final : binary_val_functor_t {
-  using binary_val_functor_t::operator();
-  val_t operator()(int lhs, int rhs) const {
-    return static_cast<int>(lhs < rhs);
-  }
-  val_t operator()(const string &lhs, const string &rhs) const {
-    return static_cast<int>(lhs < rhs);
-  }
-};
+using namespace cppcon14::calc;
 
 FIXTURE(val_functors) {
   EXPECT_EQ(apply(neg_t(), val_t(1)).as<int>(), -1);
@@ -206,54 +46,6 @@ FIXTURE(val_functors) {
   EXPECT_EQ(apply(lt_t(), val_t(string("hello")), val_t(string("doctor"))).as<int>(), 0);
 }
 
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-class scope_t final {
-  public:
-
-  /* TODO */
-  scope_t(const scope_t &) = delete;
-  scope_t &operator=(const scope_t &) = delete;
-
-  /* TODO */
-  using defs_t = map<string, val_t>;
-
-  /* TODO */
-  explicit scope_t(const scope_t *parent = nullptr) noexcept : parent(parent) {}
-
-  /* TODO */
-  void def(const string &name, val_t &&val) {
-    assert(this);
-    defs[name] = move(val);
-  }
-
-  /* TODO */
-  const val_t &ref(const string &name) const {
-    assert(this);
-    const scope_t *scope = this;
-    do {
-      auto iter = scope->defs.find(name);
-      if (iter != scope->defs.end()) {
-        return iter->second;
-      }
-      scope = scope->parent;
-    } while (scope);
-    throw undef_ref_error_t();
-  }
-
-  private:
-
-  /* TODO */
-  const scope_t *parent;
-
-  /* TODO */
-  defs_t defs;
-
-};  // scope_t;
-
 FIXTURE(scope) {
   scope_t s1;
   s1.def("name", string("alice"));
@@ -265,394 +57,6 @@ FIXTURE(scope) {
   EXPECT_EQ(s2.ref("age").as<int>(), 29);
 }
 
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-struct lit_t final {
-  lit_t(const val_ptr_t &val) : val(val) {}
-  val_ptr_t val;
-};
-
-/* TODO */
-struct affix_t final {
-  enum op_t {
-    neg,
-    not_,
-    to_int,
-    to_str
-  };
-  affix_t(op_t op, const expr_ptr_t &arg) : op(op), arg(arg) {}
-  op_t op;
-  expr_ptr_t arg;
-};
-
-/* TODO */
-struct infix_t final {
-  enum op_t {
-    add,
-    mul,
-    lt,
-    and_,
-    or_
-  };
-  infix_t(op_t op, const expr_ptr_t &lhs, const expr_ptr_t &rhs)
-      : op(op), lhs(lhs), rhs(rhs) {}
-  op_t op;
-  expr_ptr_t lhs, rhs;
-};
-
-/* TODO */
-struct ref_t final {
-  ref_t(string name) : name(move(name)) {}
-  string name;
-};
-
-/* TODO */
-struct apply_t final {
-  using args_t = vector<expr_ptr_t>;
-  apply_t(const expr_ptr_t &fn, args_t args) : fn(fn), args(move(args)) {}
-  expr_ptr_t fn;
-  args_t args;
-};
-
-/* TODO */
-struct expr_t final
-    : public variant_t<lit_t, affix_t, infix_t, ref_t, apply_t> {
-  using variant_t::variant_t;
-};
-
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-struct eval_t final {
-
-  /* TODO */
-  using ret_t = val_t;
-
-  /* TODO */
-  val_t operator()(nullptr_t) const { return val_t(); }
-
-  /* TODO */
-  val_t operator()(const lit_t &that) const {
-    return *that.val;
-  }
-
-  /* TODO */
-  val_t operator()(const affix_t &that) const {
-    val_t result, arg = apply(*this, *that.arg);
-    switch (that.op) {
-      case affix_t::neg: {
-        result = apply(neg_t(), arg);
-        break;
-      }
-      case affix_t::not_: {
-        result = apply(not_t(), arg);
-        break;
-      }
-      case affix_t::to_int: {
-        result = apply(to_int_t(), arg);
-        break;
-      }
-      case affix_t::to_str: {
-        result = apply(to_str_t(), arg);
-        break;
-      }
-    }  // switch
-    return move(result);
-  }
-
-  /* TODO */
-  val_t operator()(const infix_t &that) const {
-    val_t result, lhs = apply(*this, *that.lhs), rhs = apply(*this, *that.rhs);
-    switch (that.op) {
-      case infix_t::add: {
-        result = apply(add_t(), lhs, rhs);
-        break;
-      }
-      case infix_t::mul: {
-        result = apply(mul_t(), lhs, rhs);
-        break;
-      }
-      case infix_t::lt: {
-        result = apply(lt_t(), lhs, rhs);
-        break;
-      }
-      case infix_t::and_: {
-        result = apply(and_t(), lhs, rhs);
-        break;
-      }
-      case infix_t::or_: {
-        result = apply(or_t(), lhs, rhs);
-        break;
-      }
-    }  // switch
-    return move(result);
-  }
-
-  /* TODO */
-  val_t operator()(const ref_t &that) const {
-    return scope->ref(that.name);
-  }
-
-  /* TODO */
-  val_t operator()(const apply_t &that) const {
-    /* Get the lambda we're going to apply. */
-    val_t fn = apply(*this, *that.fn);
-    const auto *lambda = fn.try_as<lambda_t>();
-    if (!lambda || lambda->params.size() != that.args.size()) {
-      throw type_mismatch_error_t();
-    }
-    /* Evaluate the arguments and put them into scope. */
-    scope_t local_scope(scope);
-    for (size_t i = 0; i < that.args.size(); ++i) {
-      local_scope.def(lambda->params[i], apply(*this, *that.args[i]));
-    }
-    /* Evaluate the lambda's definition. */
-    return apply(eval_t{&local_scope}, *lambda->def);
-  }
-
-  const scope_t *scope;
-
-};
-
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-struct token_t final {
-  enum kind_t {
-    end,
-    open_paren,
-    close_paren,
-    plus,
-    minus,
-    star,
-    lt,
-    eq,
-    comma,
-    lit,
-    name,
-    and_kwd,
-    fn_kwd,
-    int_kwd,
-    not_kwd,
-    or_kwd,
-    str_kwd
-  };
-  kind_t kind;
-  val_ptr_t val;
-};
-
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-class scanner_t final {
-  public:
-
-  /* No copying or moving. */
-  scanner_t(const scanner_t &) = delete;
-  scanner_t &operator=(const scanner_t &) = delete;
-
-  /* TODO */
-  scanner_t(istream &strm)
-      : strm(strm), token_is_cached(false) {
-    assert(strm);
-  }
-
-  /* TODO */
-  const token_t &operator*() const {
-    assert(this);
-    refresh_cache();
-    return cached_token;
-  }
-
-  /* TODO */
-  const token_t *operator->() const {
-    assert(this);
-    refresh_cache();
-    return &cached_token;
-  }
-
-  /* TODO */
-  scanner_t &operator++() {
-    assert(this);
-    refresh_cache();
-    if (token_is_cached && cached_token.kind != token_t::end) {
-      cached_token.val.reset();
-      token_is_cached = false;
-    }
-    return *this;
-  }
-
-  private:
-
-  /* TODO */
-  void refresh_cache() const {
-    assert(this);
-    if (!token_is_cached) {
-      enum { start, str_lit, int_lit, name } state = start;
-      ostringstream accum;
-      do {
-        auto c = strm.peek();
-        switch (state) {
-          case start: {
-            switch (c) {
-              case '(': {
-                strm.ignore();
-                cached_token.kind = token_t::open_paren;
-                token_is_cached = true;
-                break;
-              }
-              case ')': {
-                strm.ignore();
-                cached_token.kind = token_t::close_paren;
-                token_is_cached = true;
-                break;
-              }
-              case '+': {
-                strm.ignore();
-                cached_token.kind = token_t::plus;
-                token_is_cached = true;
-                break;
-              }
-              case '-': {
-                strm.ignore();
-                cached_token.kind = token_t::minus;
-                token_is_cached = true;
-                break;
-              }
-              case '*': {
-                strm.ignore();
-                cached_token.kind = token_t::star;
-                token_is_cached = true;
-                break;
-              }
-              case '<': {
-                strm.ignore();
-                cached_token.kind = token_t::lt;
-                token_is_cached = true;
-                break;
-              }
-              case '=': {
-                strm.ignore();
-                cached_token.kind = token_t::eq;
-                token_is_cached = true;
-                break;
-              }
-              case ',': {
-                strm.ignore();
-                cached_token.kind = token_t::comma;
-                token_is_cached = true;
-                break;
-              }
-              case '"': {
-                strm.ignore();
-                state = str_lit;
-                break;
-              }
-              default: {
-                if (c < 0) {
-                  cached_token.kind = token_t::end;
-                  token_is_cached = true;
-                  break;
-                }
-                if (isspace(c)) {
-                  strm.ignore();
-                  break;
-                }
-                if (isdigit(c)) {
-                  state = int_lit;
-                  break;
-                }
-                if (isalpha(c) || c == '_') {
-                  state = name;
-                  break;
-                }
-                throw;
-              }
-            }  // switch
-            break;
-          }
-          case str_lit: {
-            if (c < 0) {
-              throw;
-            }
-            if (c == '"') {
-              strm.ignore();
-              cached_token.kind = token_t::lit;
-              cached_token.val = make_shared<val_t>(accum.str());
-              token_is_cached = true;
-              break;
-            }
-            if (isprint(c)) {
-              strm.ignore();
-              accum.put(c);
-              break;
-            }
-            throw;
-          }
-          case int_lit: {
-            if (isdigit(c)) {
-              strm.ignore();
-              accum.put(c);
-              break;
-            }
-            istringstream strm(accum.str());
-            int temp;
-            strm >> temp;
-            cached_token.kind = token_t::lit;
-            cached_token.val = make_shared<val_t>(temp);
-            token_is_cached = true;
-            break;
-          }
-          case name: {
-            if (isalnum(c) || c == '_') {
-              strm.ignore();
-              accum.put(c);
-              break;
-            }
-            string name = accum.str();
-            static const map<string, token_t::kind_t> kwds = {
-              { "and", token_t::and_kwd },
-              { "fn", token_t::fn_kwd },
-              { "int", token_t::int_kwd },
-              { "not", token_t::not_kwd },
-              { "or", token_t::or_kwd },
-              { "str", token_t::str_kwd }
-            };
-            auto iter = kwds.find(name);
-            if (iter != kwds.end()) {
-              cached_token.kind = iter->second;
-            } else {
-              cached_token.kind = token_t::name;
-              cached_token.val = make_shared<val_t>(accum.str());
-            }
-            token_is_cached = true;
-            break;
-          }
-        }  // switch
-      } while (!token_is_cached);
-    }  // if
-  }
-
-  /* TODO */
-  istream &strm;
-
-  /* TODO */
-  mutable bool token_is_cached;
-
-  /* TODO */
-  mutable token_t cached_token;
-
-};  // scanner_t
-
 FIXTURE(scanner) {
   istringstream strm("1 + 2");
   scanner_t scanner(strm);
@@ -669,218 +73,162 @@ FIXTURE(scanner) {
   EXPECT_TRUE(scanner->kind == token_t::end);
 }
 
-/* ---------------------------------------------------------------------------
-TODO
---------------------------------------------------------------------------- */
-
-/* TODO */
-class expr_parser_t final {
-  public:
-
-  /* TODO */
-  static expr_ptr_t parse(scanner_t &scanner) {
-    return expr_parser_t(scanner).parse_expr();
-  }
-
-  private:
-
-  /* TODO */
-  expr_parser_t(scanner_t &scanner)
-      : scanner(scanner) {}
-
-  /* TODO */
-  expr_ptr_t parse_and() {
-    assert(this);
-    expr_ptr_t result = parse_not();
-    while (scanner->kind == token_t::and_kwd) {
-      ++scanner;
-      result = make_shared<expr_t>(
-          infix_t(infix_t::or_, result, parse_not()));
-    }
-    return result;
+FIXTURE(scanner_kwds) {
+  string text = "and andy fn fnx or o int in not str _str\"not\" 99999999999";
+  scanner_t scanner(text);
+  for (auto kind : { token_t::and_kwd, token_t::name, token_t::fn_kwd,
+                     token_t::name, token_t::or_kwd, token_t::name,
+                     token_t::int_kwd, token_t::name, token_t::not_kwd,
+                     token_t::str_kwd, token_t::name, token_t::lit }) {
+    EXPECT_TRUE(scanner->kind == kind);
+    ++scanner;
   }
-
-  /* TODO */
-  expr_ptr_t parse_arith() {
-    assert(this);
-    expr_ptr_t result = parse_term();
-    while (scanner->kind == token_t::plus) {
-      ++scanner;
-      result = make_shared<expr_t>(
-          infix_t(infix_t::add, result, parse_term()));
-    }
-    return result;
+  if (EXPECT_TRUE(scanner->kind == token_t::lit)) {
+    EXPECT_EQ(scanner->val->as<int>(), 2147483647);
   }
+  ++scanner;
+  EXPECT_TRUE(scanner->kind == token_t::end);
+}
 
-  /* TODO */
-  expr_ptr_t parse_atom() {
-    assert(this);
-    expr_ptr_t result;
-    switch (scanner->kind) {
-      case token_t::lit: {
-        result = make_shared<expr_t>(lit_t(scanner->val));
-        ++scanner;
-        break;
-      }
-      case token_t::name: {
-        result = make_shared<expr_t>(ref_t(scanner->val->as<string>()));
-        ++scanner;
-        break;
-      }
-      case token_t::open_paren: {
-        ++scanner;
-        result = parse_expr();
-        match(token_t::close_paren);
-        break;
-      }
-      default: {
-        throw;
-      }
-    }  // switch
-    return result;
+/* Evaluate lhs op rhs, built by hand, or say which error it throws. */
+static string eval_infix(
+    infix_t::op_t op, const char *lhs, const char *rhs) {
+  scope_t scope;
+  scope.def("nothing", val_t());
+  expr_t expr(infix_t(op, parse_expr(lhs), parse_expr(rhs)));
+  try {
+    return apply(to_str_t(), apply(eval_t{&scope}, expr)).as<string>();
+  } catch (const undef_ref_error_t &) {
+    return "undefined ref";
+  } catch (const null_value_error_t &) {
+    return "null value";
+  } catch (const type_mismatch_error_t &) {
+    return "type mismatch";
   }
+}
 
-  /* TODO */
-  expr_ptr_t parse_cmp() {
-    assert(this);
-    expr_ptr_t result = parse_arith();
-    if (scanner->kind == token_t::lt) {
-      ++scanner;
-      result = make_shared<expr_t>(
-          infix_t(infix_t::lt, result, parse_arith()));
-    }
-    return result;
-  }
+FIXTURE(short_circuit) {
+  /* Where the left decides, the right, which would throw, isn't evaluated. */
+  EXPECT_EQ(eval_infix(infix_t::and_, "0", "boom"), "0");
+  EXPECT_EQ(eval_infix(infix_t::and_, "1 < 0", "nothing + 1"), "0");
+  EXPECT_EQ(eval_infix(infix_t::or_, "5", "boom"), "1");
+  EXPECT_EQ(eval_infix(infix_t::or_, "0 < 1", "\"a\" * \"b\""), "1");
+  /* Elsewhere, it is. */
+  EXPECT_EQ(eval_infix(infix_t::and_, "5", "boom"), "undefined ref");
+  EXPECT_EQ(eval_infix(infix_t::or_, "0", "nothing + 1"), "null value");
+  EXPECT_EQ(eval_infix(infix_t::and_, "2", "7"), "1");
+  EXPECT_EQ(eval_infix(infix_t::or_, "0", "0"), "0");
+  /* A left which isn't an int decides nothing, and errors as before. */
+  EXPECT_EQ(eval_infix(infix_t::and_, "\"a\"", "0"), "type mismatch");
+  EXPECT_EQ(eval_infix(infix_t::or_, "nothing", "1"), "null value");
+}
 
-  /* TODO */
-  expr_ptr_t parse_expr() {
-    assert(this);
-    expr_ptr_t result;
-    switch (scanner->kind) {
-      case token_t::fn_kwd: {
-        ++scanner;
-        lambda_t::params_t params;
-        for (;;) {
-          if (scanner->kind == token_t::eq) {
-            ++scanner;
-            break;
-          }
-          if (scanner->kind != token_t::name) {
-            throw;
-          }
-          params.emplace_back(scanner->val->as<string>());
-          ++scanner;
-          match(token_t::comma);
-        }
-        result = make_shared<expr_t>(
-            lit_t(make_shared<val_t>(
-                lambda_t(move(params), parse_expr()))));
-        break;
-      }
-      default: {
-        result = parse_or();
-      }
-    }
-    return result;
-  }
+FIXTURE(parse_expr) {
+  EXPECT_EQ(eval_as_str("1 + 2"), "3");
+}
 
-  /* TODO */
-  expr_ptr_t parse_factor() {
-    assert(this);
-    bool flag = false;
-    for (;;) {
-      if (scanner->kind == token_t::plus) {
-        ++scanner;
-        continue;
-      }
-      if (scanner->kind == token_t::minus) {
-        ++scanner;
-        flag = !flag;
-        continue;
-      }
-      break;
+/* The tree, written out in prefix form. */
+static string show(const expr_t &expr) {
+  static const char *affix_names[] = { "neg", "not", "int", "str" };
+  static const char *infix_names[] = { "add", "mul", "lt", "and", "or" };
+  if (const auto *that = expr.try_as<lit_t>()) {
+    if (const auto *lambda = that->val->try_as<lambda_t>()) {
+      string text = "(fn";
+      for (const auto &param : lambda->params) {
+        text += " " + param.get_name();
+      }
+      return text + " " + show(*lambda->def) + ")";
     }
-    expr_ptr_t result = parse_atom();
-    if (flag) {
-      result = make_shared<expr_t>(affix_t(affix_t::neg, result));
+    if (const auto *str = that->val->try_as<string>()) {
+      return "\"" + *str + "\"";
     }
-    return result;
+    return to_string(that->val->as<int>());
   }
-
-  /* TODO */
-  expr_ptr_t parse_not() {
-    assert(this);
-    bool flag = false;
-    while (scanner->kind == token_t::not_kwd) {
-      ++scanner;
-      flag = !flag;
-    }
-    expr_ptr_t result = parse_cmp();
-    if (flag) {
-      result = make_shared<expr_t>(affix_t(affix_t::not_, result));
-    }
-    return result;
+  if (const auto *that = expr.try_as<affix_t>()) {
+    return string("(") + affix_names[that->op] + " " + show(*that->arg) + ")";
   }
-
-  /* TODO */
-  expr_ptr_t parse_or() {
-    assert(this);
-    expr_ptr_t result = parse_and();
-    while (scanner->kind == token_t::or_kwd) {
-      ++scanner;
-      result = make_shared<expr_t>(
-          infix_t(infix_t::or_, result, parse_and()));
-    }
-    return result;
+  if (const auto *that = expr.try_as<infix_t>()) {
+    return string("(") + infix_names[that->op] + " " + show(*that->lhs) +
+           " " + show(*that->rhs) + ")";
   }
-
-  /* TODO */
-  expr_ptr_t parse_term() {
-    assert(this);
-    expr_ptr_t result = parse_factor();
-    while (scanner->kind == token_t::star) {
-      ++scanner;
-      result = make_shared<expr_t>(
-          infix_t(infix_t::mul, result, parse_factor()));
-    }
-    return result;
+  if (const auto *that = expr.try_as<ref_t>()) {
+    return that->name.get_name();
   }
+  return "?";
+}
 
-  private:
-
-  /* TODO */
-  void match(token_t::kind_t kind) {
-    assert(this);
-    if (scanner->kind != kind) {
-      throw;
-    }
-    ++scanner;
+FIXTURE(parse_expr_trees) {
+  const char *cases[][2] = {
+    { "1 + 2 * 3", "(add 1 (mul 2 3))" },
+    { "1 + 2 + 3", "(add (add 1 2) 3)" },
+    { "1 * 2 * 3 + 4", "(add (mul (mul 1 2) 3) 4)" },
+    { "-x * y", "(mul (neg x) y)" },
+    { "--x", "x" },
+    { "+-+x", "(neg x)" },
+    { "-(1 + 2) * \"s\"", "(mul (neg (add 1 2)) \"s\")" },
+    { "not not a < b", "(lt a b)" },
+    { "not a < b and c", "(and (not (lt a b)) c)" },
+    { "not -a", "(not (neg a))" },
+    { "a or b and c", "(or a (and b c))" },
+    { "a and b or c and not d", "(or (and a b) (and c (not d)))" },
+    { "a + b < c * d", "(lt (add a b) (mul c d))" },
+    { "(a < b) < c", "(lt (lt a b) c)" },
+    { "a < b < c", "(lt a b)" },
+    { "1 2", "1" },
+    { "a)", "a" },
+    { "fn a, b, = a + b", "(fn a b (add a b))" },
+    { "fn = 1", "(fn 1)" },
+    { "(fn a, = a) + 1", "(add (fn a a) 1)" },
+    { "fn a, = fn b, = a < b or not b", "(fn a (fn b (or (lt a b) (not b))))" },
+    { "((((x))))", "x" }
+  };
+  for (const auto &test : cases) {
+    EXPECT_EQ(show(*parse_expr(test[0])), test[1]);
   }
-
-  /* TODO */
-  scanner_t &scanner;
-
-};  // expr_parser_t
-
-/* TODO */
-inline expr_ptr_t parse_expr(const string &text) {
-  istringstream strm(text);
-  scanner_t scanner(strm);
-  return expr_parser_t::parse(scanner);
+  EXPECT_EQ(eval_as_str("1 and 0"), "0");
 }
 
-/* TODO */
-inline val_t eval(const string &text) {
+FIXTURE(interning) {
+  /* Names are interned, and repeated string literals share one value. */
+  expr_ptr_t expr = parse_expr("(\"abc\" + name) + (\"abc\" + name)");
+  const auto &lhs = expr->as<infix_t>().lhs->as<infix_t>();
+  const auto &rhs = expr->as<infix_t>().rhs->as<infix_t>();
+  EXPECT_TRUE(lhs.lhs->as<lit_t>().val == rhs.lhs->as<lit_t>().val);
+  EXPECT_TRUE(lhs.rhs->as<ref_t>().name == symbol_t("name"));
+  EXPECT_TRUE(rhs.rhs->as<ref_t>().name == symbol_t("name"));
+  EXPECT_TRUE(get_str_lit(symbol_t("abc")) == lhs.lhs->as<lit_t>().val);
+  EXPECT_EQ(lhs.lhs->as<lit_t>().val->as<string>(), "abc");
   scope_t scope;
-  return apply(eval_t{&scope}, *parse_expr(text));
+  scope.def("name", string("def"));
+  EXPECT_EQ(apply(eval_t{&scope}, *expr).as<string>(), "abcdefabcdef");
 }
 
-/* TODO */
-inline string eval_as_str(const string &text) {
-  return apply(to_str_t(), eval(text)).as<string>();
+FIXTURE(parse_expr_long) {
+  /* Deep nests of parentheses, and long runs of operators and prefixes,
+     use none of the stack. */
+  size_t depth = 100000;
+  string text = string(depth, '(') + "x" + string(depth, ')');
+  EXPECT_EQ(show(*parse_expr(text)), "x");
+  text.clear();
+  for (size_t i = 0; i < depth; ++i) {
+    text += "not ";
+  }
+  for (size_t i = 0; i < depth; ++i) {
+    text += "- ";
+  }
+  EXPECT_EQ(show(*parse_expr(text + "x")), "x");
+  text = "x";
+  size_t size = 5000;
+  for (size_t i = 1; i < size; ++i) {
+    text += (i % 2) ? " + (x)" : " * -x";
+  }
+  /* x + (x) * -x + ..., so a spine of adds, each with a mul to its right. */
+  expr_ptr_t expr = parse_expr(text);
+  size_t count = 0;
+  const infix_t *that = expr->try_as<infix_t>();
+  while (that) {
+    ++count;
+    that = that->lhs->try_as<infix_t>();
+  }
+  EXPECT_EQ(count, size / 2);
 }
-
-FIXTURE(parse_expr) {
-  EXPECT_EQ(eval_as_str("1 + 2"), "3");
-}
-
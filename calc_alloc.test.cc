@@ -0,0 +1,112 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests of the calculator's allocations: that the frames eval_t applies
+lambdas in come from its arena, and that int-only calls allocate nothing.
+These replace the global operator new, so they're kept apart from the rest
+of the calculator's tests in "calc.test.cc".
+--------------------------------------------------------------------------- */
+
+#include "calc.h"
+
+#include <memory>
+#include <string>
+
+#include "alloc_count.h"
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::calc;
+
+FIXTURE(frame_arena) {
+  frame_arena_t arena;
+  {
+    frame_arena_t::frame_t outer(arena, 2);
+    outer.push(1);
+    outer.push(string("two"));
+    {
+      /* Too big for what's left of the first chunk. */
+      frame_arena_t::frame_t inner(arena, 1000);
+      inner.push(3);
+      EXPECT_EQ(arena.get_size(), 1002u);
+    }
+    EXPECT_EQ(arena.get_size(), 2u);
+    EXPECT_EQ(outer.get_slots()[0].as<int>(), 1);
+    EXPECT_EQ(outer.get_slots()[1].as<string>(), "two");
+  }
+  EXPECT_EQ(arena.get_size(), 0u);
+}
+
+FIXTURE(int_calls_allocate_nothing) {
+  scope_t scope;
+  scope.def("sq", lambda_t({ "n" }, parse_expr("n * n")));
+  scope.def("poly", lambda_t({ "a", "b", "c" },
+                             parse_expr("a * b + b * c + c * a")));
+  /* poly (sq 3) 4 (sq (sq 2)) */
+  auto sq = make_shared<expr_t>(ref_t("sq"));
+  auto lit = [](int val) {
+    return make_shared<expr_t>(lit_t(make_shared<val_t>(val)));
+  };
+  auto expr = make_shared<expr_t>(apply_t(
+      make_shared<expr_t>(ref_t("poly")),
+      { make_shared<expr_t>(apply_t(sq, { lit(3) })), lit(4),
+        make_shared<expr_t>(apply_t(
+            sq, { make_shared<expr_t>(apply_t(sq, { lit(2) })) })) }));
+  eval_t eval{&scope};
+  /* The first call may grow the arena. */
+  EXPECT_EQ(apply(eval, *expr).as<int>(), 9 * 4 + 4 * 16 + 16 * 9);
+  size_t start = alloc_count;
+  int sum = 0;
+  for (int i = 0; i < 1000; ++i) {
+    sum += apply(eval, *expr).as<int>();
+  }
+  EXPECT_EQ(alloc_count - start, 0u);
+  EXPECT_EQ(sum, 1000 * (9 * 4 + 4 * 16 + 16 * 9));
+  EXPECT_EQ(eval_t::get_arena().get_size(), 0u);
+  /* Whereas strings do allocate, so we are counting. */
+  scope.def("s", string(100, 's'));
+  auto str_expr = make_shared<expr_t>(apply_t(
+      make_shared<expr_t>(ref_t("sq")), { make_shared<expr_t>(ref_t("s")) }));
+  start = alloc_count;
+  try {
+    apply(eval, *str_expr);
+  } catch (const type_mismatch_error_t &) {}
+  EXPECT_GT(alloc_count - start, 0u);
+}
+
+FIXTURE(frames_unwind) {
+  scope_t scope;
+  scope.def("add", lambda_t({ "a", "b" }, parse_expr("a + b")));
+  /* add 1 (add 2 undefined) */
+  auto add = make_shared<expr_t>(ref_t("add"));
+  auto one = make_shared<expr_t>(lit_t(make_shared<val_t>(1)));
+  auto expr = make_shared<expr_t>(apply_t(
+      add, { one, make_shared<expr_t>(apply_t(
+                      add, { one, make_shared<expr_t>(ref_t("nope")) })) }));
+  bool caught = false;
+  try {
+    apply(eval_t{&scope}, *expr);
+  } catch (const undef_ref_error_t &) {
+    caught = true;
+  }
+  EXPECT_TRUE(caught);
+  EXPECT_EQ(eval_t::get_arena().get_size(), 0u);
+  /* Later parameters hide earlier ones of the same name. */
+  auto dup = make_shared<expr_t>(apply_t(
+      make_shared<expr_t>(lit_t(make_shared<val_t>(
+          lambda_t({ "a", "a" }, parse_expr("a"))))),
+      { one, make_shared<expr_t>(lit_t(make_shared<val_t>(2))) }));
+  EXPECT_EQ(apply(eval_t{&scope}, *dup).as<int>(), 2);
+}
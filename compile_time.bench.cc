@@ -0,0 +1,87 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Measures the cost of compiling "compile_time.cc" with variants of 8, 32, 128
+and 256 alternatives, reporting wall time and the compiler's peak resident
+set size.  The compiler is taken from the CXX environment variable, or else
+defaults to clang++.
+
+Usage: compile_time.bench [alts...]
+--------------------------------------------------------------------------- */
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* Run the compiler on the subject, with the given number of alternatives.
+   Returns false if the compiler couldn't be run or failed. */
+static bool compile(const string &cxx, size_t alts, double &secs, long &kb) {
+  string def = "-DALTS=" + to_string(alts);
+  vector<const char *> args = {
+    cxx.c_str(), "-std=c++1y", "-O2", def.c_str(),
+    "-c", "-o", "/dev/null", "compile_time.cc", nullptr
+  };
+  auto start = chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    execvp(args[0], const_cast<char *const *>(args.data()));
+    _exit(127);
+  }
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    return false;
+  }
+  secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  kb = usage.ru_maxrss;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  const char *env = getenv("CXX");
+  string cxx = env ? env : "clang++";
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(strtoull(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = { 8, 32, 128, 256 };
+  }
+  cout << setw(6) << "alts" << setw(12) << "secs" << setw(14) << "peak KB"
+       << endl;
+  for (size_t alts : sizes) {
+    double secs;
+    long kb;
+    if (!compile(cxx, alts, secs, kb)) {
+      cerr << "compile failed at " << alts << " alternatives" << endl;
+      return EXIT_FAILURE;
+    }
+    cout << setw(6) << alts << setw(12) << fixed << setprecision(2) << secs
+         << setw(14) << kb << endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The subject of the compile-time benchmark, "compile_time.bench.cc".  Compile
+with -DALTS=n to get a variant of n alternatives, which we then copy, visit,
+match, and apply binary functors to, much as real code would.
+--------------------------------------------------------------------------- */
+
+#include <cstddef>
+#include <utility>
+
+#include "variant.h"
+
+#ifndef ALTS
+#define ALTS 8
+#endif
+
+using namespace cppcon14::variant;
+
+/* One of our alternatives.  Each i gives a distinct type. */
+template <size_t i>
+struct alt_t { size_t val; };
+
+/* A variant of alt_t<0> through alt_t<n - 1>. */
+template <typename idxs_t>
+struct make_variant;
+
+template <size_t... i>
+struct make_variant<std::index_sequence<i...>> {
+  using type = variant_t<alt_t<i>...>;
+};
+
+using big_t = make_variant<std::make_index_sequence<ALTS>>::type;
+using small_t = make_variant<std::make_index_sequence<8>>::type;
+
+/* A functor which handles every alternative, alone or in pairs. */
+struct sum_t final {
+  using ret_t = size_t;
+  template <size_t i>
+  size_t operator()(const alt_t<i> &that) const { return that.val + i; }
+  template <size_t i, size_t j>
+  size_t operator()(const alt_t<i> &lhs, const alt_t<j> &rhs) const {
+    return lhs.val * i + rhs.val * j;
+  }
+};
+
+size_t unary(const big_t &that) {
+  return apply(sum_t(), that);
+}
+
+size_t binary(const big_t &lhs, const small_t &rhs) {
+  return apply(sum_t(), lhs, rhs);
+}
+
+size_t matched(const big_t &that) {
+  return match<size_t>(that,
+                       [](const alt_t<0> &) { return 0; },
+                       [](const auto &) { return 1; });
+}
+
+big_t copied(const big_t &that) {
+  big_t result = that;
+  return result;
+}
+
+size_t tried(const big_t &that) {
+  const auto *ptr = that.try_as<alt_t<ALTS - 1>>();
+  return ptr ? ptr->val : 0;
+}
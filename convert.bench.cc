@@ -0,0 +1,92 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Throughput of converting a narrow variant into a wider one, first the old
+way (match() and re-construct) and then with the converting constructor.
+--------------------------------------------------------------------------- */
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "variant.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+struct car_t { int seats; double speed; };
+struct plane_t { int engines; double range; };
+struct horse_t { string name; };
+struct dog_t { string name; };
+struct cat_t { int lives; };
+
+using transport_t = variant_t<car_t, plane_t, horse_t>;
+using thing_t = variant_t<car_t, plane_t, horse_t, dog_t, cat_t, null_t>;
+
+/* Fill a vector with transports, cycling through the states. */
+static vector<transport_t> make_transports(size_t n) {
+  vector<transport_t> transports;
+  transports.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    switch (i % 3) {
+      case 0: {
+        transports.push_back(car_t{4, 120});
+        break;
+      }
+      case 1: {
+        transports.push_back(plane_t{2, 5000});
+        break;
+      }
+      case 2: {
+        transports.push_back(horse_t{"Mister Ed"});
+        break;
+      }
+    }  // switch
+  }  // for
+  return transports;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 10000000);
+  auto transports = make_transports(n);
+  vector<thing_t> things;
+  things.reserve(n);
+  measure(cout, "copy via match()", n, [&] {
+    for (const auto &transport : transports) {
+      things.push_back(match<thing_t>(
+          transport,
+          [](const car_t &that) { return thing_t(that); },
+          [](const plane_t &that) { return thing_t(that); },
+          [](const horse_t &that) { return thing_t(that); }));
+    }  // for
+  });
+  keep(things);
+  things.clear();
+  measure(cout, "copy via converting ctor", n, [&] {
+    for (const auto &transport : transports) {
+      things.push_back(transport);
+    }  // for
+  });
+  keep(things);
+  things.clear();
+  measure(cout, "move via converting ctor", n, [&] {
+    for (auto &transport : transports) {
+      things.push_back(move(transport));
+    }  // for
+  });
+  keep(things);
+  return 0;
+}
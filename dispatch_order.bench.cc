@@ -0,0 +1,435 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+How the dispatch engines of "speed.test.cc" hold up when the data isn't
+laid out in their favor.  speed.test fills its vector with all the circles,
+then all the squares, then all the triangles, which lets the branch
+predictor learn the target of every dispatch.  Here we vary:
+
+  the order     sorted (in blocks, as speed.test does), round-robin
+                (0, 1, 2, 0, 1, 2, ...), shuffled (equal numbers of each,
+                in random order) and zipf (random, with alternative k
+                drawn in proportion to 1 / (k + 1));
+  alternatives  3, 8 or 32 types in the variant;
+  payload       8 or 64 bytes per alternative, of which the work touches
+                the first and last words; and
+  vector size   enough variant_ts to fill half the L1 data cache, half of
+                L2, half of the last-level cache, or 8 times the last-level
+                cache (at least 64 MiB), which lives in DRAM.
+
+boost::variant can't hold more than BOOST_MPL_LIMIT_LIST_SIZE (20)
+alternatives, so it sits out the runs with 32.
+
+The cache sizes come from sysconf() where available.  Every engine sees the
+same alternatives in the same order, with the same seed for the random
+orders.
+
+Usage: dispatch_order.bench [flags]
+  --orders=all     Any of sorted, round-robin, shuffled and zipf.
+  --alts=all       Any of 3, 8 and 32.
+  --payloads=all   Any of 8 and 64.
+  --levels=all     Any of L1, L2, LLC and DRAM.
+  --engines=all    Any of virtual, boost, cppcon14, std, switch and fnptr.
+  --warmup, --trials, --min-elems, --counters and --json, as in speed.test.
+--------------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/mpl/limits/list.hpp>
+#include <boost/variant.hpp>
+
+#include <variant>
+
+#include "bench.h"
+#include "speed.h"
+#include "variant.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* ---------------------------------------------------------------------------
+Alternatives and orders.
+--------------------------------------------------------------------------- */
+
+/* The alternative at position idx, with a payload of the given size. */
+template <size_t idx, size_t payload>
+struct alt_t final {
+
+  static_assert(payload % sizeof(double) == 0 && payload > 0,
+                "The payload must be a whole number of doubles.");
+
+  explicit alt_t(double seed) {
+    for (double &val : vals) {
+      val = seed;
+    }  // for
+  }
+
+  /* Touches the first and last words, so that a bigger payload spans more
+     cache lines. */
+  double get_area() const {
+    return vals[0] * (idx + 1) + vals[payload / sizeof(double) - 1];
+  }
+
+  double vals[payload / sizeof(double)];
+
+};  // alt_t<idx, payload>
+
+/* A variant template (ours, boost's or std's) of the alternatives. */
+template <template <typename...> class variant_tmpl, size_t payload,
+          typename idxs_t>
+struct alts_of;
+
+template <template <typename...> class variant_tmpl, size_t payload,
+          size_t... idxs>
+struct alts_of<variant_tmpl, payload, index_sequence<idxs...>> {
+  using type = variant_tmpl<alt_t<idxs, payload>...>;
+};
+
+template <template <typename...> class variant_tmpl, size_t alts,
+          size_t payload>
+using alts_of_t =
+    typename alts_of<variant_tmpl, payload, make_index_sequence<alts>>::type;
+
+/* The orders in which the alternatives may come. */
+static const char *const orders[] = {
+  "sorted", "round-robin", "shuffled", "zipf"
+};
+
+/* The indices of n alternatives, out of alts, in the named order. */
+static vector<uint8_t> make_kinds(const string &order, size_t n, size_t alts) {
+  vector<uint8_t> kinds(n);
+  mt19937_64 gen(101);
+  if (order == "sorted") {
+    for (size_t i = 0; i < n; ++i) {
+      kinds[i] = static_cast<uint8_t>(i * alts / n);
+    }  // for
+  } else if (order == "round-robin" || order == "shuffled") {
+    for (size_t i = 0; i < n; ++i) {
+      kinds[i] = static_cast<uint8_t>(i % alts);
+    }  // for
+    if (order == "shuffled") {
+      shuffle(kinds.begin(), kinds.end(), gen);
+    }  // if
+  } else {
+    vector<double> weights(alts);
+    for (size_t k = 0; k < alts; ++k) {
+      weights[k] = 1.0 / (k + 1);
+    }  // for
+    discrete_distribution<int> dist(weights.begin(), weights.end());
+    for (size_t i = 0; i < n; ++i) {
+      kinds[i] = static_cast<uint8_t>(dist(gen));
+    }  // for
+  }  // if
+  return kinds;
+}
+
+/* ---------------------------------------------------------------------------
+The engines, as in "speed.h", but for any number of alternatives with any
+payload.  Each builds its shape from the index of an alternative by way of a
+table, so building doesn't depend on the number of alternatives.  The switch
+and fnptr engines are those of "speed.h" itself, over our alternatives.
+--------------------------------------------------------------------------- */
+
+/* Build a variant-like shape_t holding the alternative at a given index. */
+template <typename shape_t, typename idxs_t, size_t payload>
+struct maker_t;
+
+template <typename shape_t, size_t... idxs, size_t payload>
+struct maker_t<shape_t, index_sequence<idxs...>, payload> {
+
+  template <size_t idx>
+  static shape_t make_alt(double seed) {
+    return shape_t(alt_t<idx, payload>(seed));
+  }
+
+  static shape_t make(uint8_t kind, double seed) {
+    static constexpr shape_t (*const makers[])(double) = {
+      &make_alt<idxs>...
+    };
+    return makers[kind](seed);
+  }
+
+};  // maker_t<shape_t, idxs_t, payload>
+
+/* Build a vector of variant-like shapes of the given kinds. */
+template <typename shape_t, size_t alts, size_t payload>
+static vector<shape_t> make_shapes(const vector<uint8_t> &kinds) {
+  using maker = maker_t<shape_t, make_index_sequence<alts>, payload>;
+  vector<shape_t> shapes;
+  shapes.reserve(kinds.size());
+  for (size_t i = 0; i < kinds.size(); ++i) {
+    shapes.push_back(maker::make(kinds[i], static_cast<double>(i % 7)));
+  }  // for
+  return shapes;
+}
+
+/* Virtual functions. */
+template <size_t alts, size_t payload>
+struct virtual_engine_t final {
+
+  struct shape_t {
+    virtual ~shape_t() {}
+    virtual double get_area() const = 0;
+  };
+
+  template <typename elem_t>
+  struct shape_of_t final : shape_t {
+    explicit shape_of_t(double seed) : elem(seed) {}
+    double get_area() const override { return elem.get_area(); }
+    elem_t elem;
+  };
+
+  using ptr_t = unique_ptr<shape_t>;
+
+  static const char *get_name() { return "virtual"; }
+
+  template <size_t idx>
+  static ptr_t make_alt(double seed) {
+    return make_unique<shape_of_t<alt_t<idx, payload>>>(seed);
+  }
+
+  template <size_t... idxs>
+  static ptr_t make(uint8_t kind, double seed, index_sequence<idxs...>) {
+    static constexpr ptr_t (*const makers[])(double) = { &make_alt<idxs>... };
+    return makers[kind](seed);
+  }
+
+  static vector<ptr_t> build(const vector<uint8_t> &kinds) {
+    vector<ptr_t> shapes;
+    shapes.reserve(kinds.size());
+    for (size_t i = 0; i < kinds.size(); ++i) {
+      shapes.push_back(make(kinds[i], static_cast<double>(i % 7),
+                            make_index_sequence<alts>()));
+    }  // for
+    return shapes;
+  }
+
+  static double get_area(const ptr_t &shape) { return shape->get_area(); }
+
+};  // virtual_engine_t<alts, payload>
+
+/* boost::variant. */
+template <size_t alts, size_t payload>
+struct boost_engine_t final {
+
+  using shape_t = alts_of_t<boost::variant, alts, payload>;
+
+  struct get_t : boost::static_visitor<double> {
+    template <typename elem_t>
+    double operator()(const elem_t &elem) const { return elem.get_area(); }
+  };
+
+  static const char *get_name() { return "boost"; }
+
+  static vector<shape_t> build(const vector<uint8_t> &kinds) {
+    return make_shapes<shape_t, alts, payload>(kinds);
+  }
+
+  static double get_area(const shape_t &shape) {
+    return boost::apply_visitor(get_t(), shape);
+  }
+
+};  // boost_engine_t<alts, payload>
+
+/* Our variant_t. */
+template <size_t alts, size_t payload>
+struct cppcon14_engine_t final {
+
+  using shape_t = alts_of_t<variant_t, alts, payload>;
+
+  struct get_t final {
+    using ret_t = double;
+    template <typename elem_t>
+    double operator()(const elem_t &elem) const { return elem.get_area(); }
+  };
+
+  static const char *get_name() { return "cppcon14"; }
+
+  static vector<shape_t> build(const vector<uint8_t> &kinds) {
+    return make_shapes<shape_t, alts, payload>(kinds);
+  }
+
+  static double get_area(const shape_t &shape) {
+    return apply(get_t(), shape);
+  }
+
+};  // cppcon14_engine_t<alts, payload>
+
+/* std::variant. */
+template <size_t alts, size_t payload>
+struct std_engine_t final {
+
+  using shape_t = alts_of_t<std::variant, alts, payload>;
+
+  static const char *get_name() { return "std"; }
+
+  static vector<shape_t> build(const vector<uint8_t> &kinds) {
+    return make_shapes<shape_t, alts, payload>(kinds);
+  }
+
+  static double get_area(const shape_t &shape) {
+    return std::visit([](const auto &elem) { return elem.get_area(); },
+                      shape);
+  }
+
+};  // std_engine_t<alts, payload>
+
+/* An engine of "speed.h", over our alternatives.  It builds its shapes from
+   our variant_ts of them. */
+template <template <typename...> class speed_tmpl, size_t alts,
+          size_t payload>
+struct speed_engine_t final : alts_of_t<speed_tmpl, alts, payload> {
+
+  using base_t = alts_of_t<speed_tmpl, alts, payload>;
+
+  static vector<typename base_t::shape_t> build(const vector<uint8_t> &kinds) {
+    return base_t::build(
+        make_shapes<typename base_t::from_t, alts, payload>(kinds));
+  }
+
+};  // speed_engine_t<speed_tmpl, alts, payload>
+
+/* A tag and a buffer, dispatched by a switch on the tag. */
+template <size_t alts, size_t payload>
+using switch_engine_t =
+    speed_engine_t<cppcon14::speed::basic_switch_engine_t, alts, payload>;
+
+/* A function pointer and a buffer. */
+template <size_t alts, size_t payload>
+using fnptr_engine_t =
+    speed_engine_t<cppcon14::speed::basic_fnptr_engine_t, alts, payload>;
+
+/* ---------------------------------------------------------------------------
+The driver.
+--------------------------------------------------------------------------- */
+
+/* A cache size from sysconf(), or def if it doesn't know. */
+static size_t get_cache_size(int name, size_t def) {
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  long size = sysconf(name);
+  return (size > 0) ? static_cast<size_t>(size) : def;
+#else
+  (void)name;
+  return def;
+#endif
+}
+
+/* A level of the memory hierarchy, and how many bytes to fill it. */
+struct level_t final {
+  const char *name;
+  size_t bytes;
+};
+
+/* The levels we try, each with the bytes of variants to keep within it. */
+static vector<level_t> get_levels() {
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  size_t l1 = get_cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 << 10),
+         l2 = get_cache_size(_SC_LEVEL2_CACHE_SIZE, 1 << 20),
+         llc = get_cache_size(_SC_LEVEL3_CACHE_SIZE, l2 * 8);
+#else
+  size_t l1 = 32 << 10, l2 = 1 << 20, llc = 8 << 20;
+#endif
+  return { { "L1", l1 / 2 }, { "L2", l2 / 2 }, { "LLC", llc / 2 },
+           { "DRAM", max<size_t>(llc * 8, 64 << 20) } };
+}
+
+/* Everything about one measurement but the engine. */
+struct setup_t final {
+  const flags_t &flags;
+  counters_t &counters;
+  report_t &report;
+  const char *order;
+  const char *level;
+  const vector<uint8_t> &kinds;
+};
+
+/* Measure an engine with the given alternatives and order. */
+template <template <size_t, size_t> class engine_tmpl, size_t alts,
+          size_t payload>
+static void run(const setup_t &setup) {
+  using engine_t = engine_tmpl<alts, payload>;
+  if (!setup.flags.selects("engines", engine_t::get_name())) {
+    return;
+  }  // if
+  auto shapes = engine_t::build(setup.kinds);
+  vector<double> results(shapes.size());
+  stats_t stats = run_trials(
+      shapes.size(), trial_opts_t::from(setup.flags), [&] {
+        for (size_t i = 0; i < shapes.size(); ++i) {
+          results[i] = engine_t::get_area(shapes[i]);
+        }  // for
+        keep(results);
+      }, &setup.counters);
+  string name = string(engine_t::get_name()) + ' ' + setup.order + " a=" +
+                to_string(alts) + " p=" + to_string(payload) + ' ' +
+                setup.level;
+  setup.report.add(
+      { name, shapes.size(), stats, setup.counters.get_counts() });
+}
+
+/* Measure every engine with the given alternatives, in every order and at
+   every level. */
+template <size_t alts, size_t payload>
+static void run_all(const flags_t &flags, counters_t &counters,
+                    report_t &report) {
+  if (!flags.selects("alts", to_string(alts).c_str()) ||
+      !flags.selects("payloads", to_string(payload).c_str())) {
+    return;
+  }  // if
+  using variant_shape_t = typename cppcon14_engine_t<alts, payload>::shape_t;
+  for (const level_t &level : get_levels()) {
+    if (!flags.selects("levels", level.name)) {
+      continue;
+    }  // if
+    size_t n = max<size_t>(alts, level.bytes / sizeof(variant_shape_t));
+    for (const char *order : orders) {
+      if (!flags.selects("orders", order)) {
+        continue;
+      }  // if
+      auto kinds = make_kinds(order, n, alts);
+      setup_t setup{ flags, counters, report, order, level.name, kinds };
+      run<virtual_engine_t, alts, payload>(setup);
+      if constexpr (alts <= BOOST_MPL_LIMIT_LIST_SIZE) {
+        run<boost_engine_t, alts, payload>(setup);
+      }  // if
+      run<cppcon14_engine_t, alts, payload>(setup);
+      run<std_engine_t, alts, payload>(setup);
+      run<switch_engine_t, alts, payload>(setup);
+      run<fnptr_engine_t, alts, payload>(setup);
+    }  // for
+  }  // for
+}
+
+int main(int argc, char *argv[]) {
+  flags_t flags(argc, argv);
+  counters_t counters(flags, cerr);
+  report_t report(cout, flags);
+  run_all<3, 8>(flags, counters, report);
+  run_all<3, 64>(flags, counters, report);
+  run_all<8, 8>(flags, counters, report);
+  run_all<8, 64>(flags, counters, report);
+  run_all<32, 8>(flags, counters, report);
+  run_all<32, 64>(flags, counters, report);
+  return 0;
+}
@@ -0,0 +1,528 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The double-dispatch benchmark.  Run a binary test over all pairs drawn from
+two vectors, as a broad phase does with collisions, in two cases:
+
+  intersects   intersects() of "intersects.h", over random circles, squares
+               and triangles.
+  transport    can_transport_animal() of "transport_animal.h", over
+               transports and animals.
+
+Each case is run by several engines, which differ in how they find the
+right test for a pair:
+
+  applier   Our variant_ts, with the case's own function, which goes
+            through match(), and so through the nested tables of applier_t.
+  switch    Tagged unions, with a hand-written switch over both tags.
+  virtual   A pair of class hierarchies, with one virtual call to find the
+            left-hand type and another, visitor-style, to find the right.
+  std       std::variants, with std::visit on both.
+
+The alternatives are drawn in one of several mixes:
+
+  uniform   Each of the three equally often.
+  skewed    The first eight times as often as each of the others.
+  single    Only the first.
+
+Every engine sees the same pairs and must count the same hits; if one
+doesn't, we say so and fail.  We report the time per pair.
+
+Usage: double_dispatch.bench [flags]
+  --sizes=100,1000  The numbers of elements on each side.
+  --cases=all       Either or both of intersects and transport.
+  --engines=all     Any of applier, switch, virtual and std.
+  --mixes=all       Any of uniform, skewed and single.
+  --warmup, --trials, --min-elems, --counters and --json, as in speed.test.
+--------------------------------------------------------------------------- */
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "bench.h"
+#include "intersects.h"
+#include "transport_animal.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* ---------------------------------------------------------------------------
+The cases.
+--------------------------------------------------------------------------- */
+
+/* The three alternatives on one side of a case. */
+template <typename a_t, typename b_t, typename c_t>
+struct three_t final {
+  using first_t = a_t;
+  using second_t = b_t;
+  using third_t = c_t;
+};
+
+/* The tests of intersects.h, as overloads, for the engines which don't go
+   through match(). */
+struct intersects_t final {
+
+  bool operator()(const circle_t &a, const circle_t &b) const {
+    return overlaps(a, b);
+  }
+
+  bool operator()(const circle_t &a, const square_t &b) const {
+    return overlaps(a, get_box(b));
+  }
+
+  bool operator()(const circle_t &a, const triangle_t &b) const {
+    return overlaps(a, get_box(b));
+  }
+
+  template <typename lhs_t>
+  bool operator()(const lhs_t &a, const circle_t &b) const {
+    return (*this)(b, a);
+  }
+
+  template <typename lhs_t, typename rhs_t>
+  bool operator()(const lhs_t &a, const rhs_t &b) const {
+    return overlaps(get_box(a), get_box(b));
+  }
+
+};  // intersects_t
+
+/* Shapes scattered over a square 1000 on a side, at most 100 across. */
+static shape_t make_shape(size_t kind, mt19937_64 &gen) {
+  uniform_real_distribution<double> pos(0, 1000), size(5, 50);
+  pnt_t ctr = { pos(gen), pos(gen) };
+  switch (kind) {
+    case 0: {
+      return circle_t{ ctr, size(gen) };
+    }
+    case 1: {
+      return square_t{ ctr, size(gen) * 2 };
+    }
+    default: {
+      return triangle_t{ { ctr, { ctr.x + size(gen), ctr.y },
+                           { ctr.x, ctr.y + size(gen) } } };
+    }
+  }  // switch
+}
+
+/* Shapes which might intersect. */
+struct intersects_case_t final {
+
+  using lhs_t = three_t<circle_t, square_t, triangle_t>;
+  using rhs_t = lhs_t;
+
+  using lhs_variant_t = shape_t;
+  using rhs_variant_t = shape_t;
+
+  using rules_t = intersects_t;
+
+  static const char *get_name() { return "intersects"; }
+
+  static bool test(const shape_t &lhs, const shape_t &rhs) {
+    return intersects(lhs, rhs);
+  }
+
+  static shape_t make_lhs(size_t kind, mt19937_64 &gen) {
+    return make_shape(kind, gen);
+  }
+
+  static shape_t make_rhs(size_t kind, mt19937_64 &gen) {
+    return make_shape(kind, gen);
+  }
+
+};  // intersects_case_t
+
+/* The rules of transport_animal.h, as overloads. */
+struct can_transport_t final {
+
+  bool operator()(const car_t &, const horse_t &) const { return false; }
+
+  template <typename elem_t>
+  bool operator()(const plane_t &, const elem_t &) const { return false; }
+
+  bool operator()(const horse_t &, const horse_t &) const { return false; }
+
+  template <typename lhs_t, typename rhs_t>
+  bool operator()(const lhs_t &, const rhs_t &) const { return true; }
+
+};  // can_transport_t
+
+/* Transports which might carry animals. */
+struct transport_case_t final {
+
+  using lhs_t = three_t<car_t, plane_t, horse_t>;
+  using rhs_t = three_t<dog_t, cat_t, horse_t>;
+
+  using lhs_variant_t = transport_t;
+  using rhs_variant_t = animal_t;
+
+  using rules_t = can_transport_t;
+
+  static const char *get_name() { return "transport"; }
+
+  static bool test(const transport_t &lhs, const animal_t &rhs) {
+    return can_transport_animal(lhs, rhs);
+  }
+
+  static transport_t make_lhs(size_t kind, mt19937_64 &) {
+    switch (kind) {
+      case 0: {
+        return car_t();
+      }
+      case 1: {
+        return plane_t();
+      }
+      default: {
+        return horse_t();
+      }
+    }  // switch
+  }
+
+  static animal_t make_rhs(size_t kind, mt19937_64 &) {
+    switch (kind) {
+      case 0: {
+        return dog_t();
+      }
+      case 1: {
+        return cat_t();
+      }
+      default: {
+        return horse_t();
+      }
+    }  // switch
+  }
+
+};  // transport_case_t
+
+/* ---------------------------------------------------------------------------
+The engines.  Each has a name, a type for the elements on each side, a way
+to make them from the alternatives, and a way to test a pair.
+--------------------------------------------------------------------------- */
+
+/* Our variant_ts and the case's own test, by way of match(). */
+template <typename case_t>
+struct applier_engine_t final {
+
+  using lhs_elem_t = typename case_t::lhs_variant_t;
+  using rhs_elem_t = typename case_t::rhs_variant_t;
+
+  static const char *get_name() { return "applier"; }
+
+  template <typename elem_t>
+  static lhs_elem_t make_lhs(const elem_t &elem) { return elem; }
+
+  template <typename elem_t>
+  static rhs_elem_t make_rhs(const elem_t &elem) { return elem; }
+
+  static bool test(const lhs_elem_t &lhs, const rhs_elem_t &rhs) {
+    return case_t::test(lhs, rhs);
+  }
+
+};  // applier_engine_t<case_t>
+
+/* A tag and a union of three alternatives. */
+template <typename three_t>
+struct tagged_t final {
+
+  using a_t = typename three_t::first_t;
+  using b_t = typename three_t::second_t;
+  using c_t = typename three_t::third_t;
+
+  tagged_t(const a_t &that) : kind(0), a(that) {}
+  tagged_t(const b_t &that) : kind(1), b(that) {}
+  tagged_t(const c_t &that) : kind(2), c(that) {}
+
+  uint8_t kind;
+
+  union {
+    a_t a;
+    b_t b;
+    c_t c;
+  };
+
+};  // tagged_t<three_t>
+
+/* Tagged unions and a switch over the pair of tags. */
+template <typename case_t>
+struct switch_engine_t final {
+
+  using lhs_elem_t = tagged_t<typename case_t::lhs_t>;
+  using rhs_elem_t = tagged_t<typename case_t::rhs_t>;
+
+  static const char *get_name() { return "switch"; }
+
+  template <typename elem_t>
+  static lhs_elem_t make_lhs(const elem_t &elem) { return elem; }
+
+  template <typename elem_t>
+  static rhs_elem_t make_rhs(const elem_t &elem) { return elem; }
+
+  static bool test(const lhs_elem_t &lhs, const rhs_elem_t &rhs) {
+    typename case_t::rules_t rules;
+    switch (lhs.kind * 3 + rhs.kind) {
+      case 0: {
+        return rules(lhs.a, rhs.a);
+      }
+      case 1: {
+        return rules(lhs.a, rhs.b);
+      }
+      case 2: {
+        return rules(lhs.a, rhs.c);
+      }
+      case 3: {
+        return rules(lhs.b, rhs.a);
+      }
+      case 4: {
+        return rules(lhs.b, rhs.b);
+      }
+      case 5: {
+        return rules(lhs.b, rhs.c);
+      }
+      case 6: {
+        return rules(lhs.c, rhs.a);
+      }
+      case 7: {
+        return rules(lhs.c, rhs.b);
+      }
+      default: {
+        return rules(lhs.c, rhs.c);
+      }
+    }  // switch
+  }
+
+};  // switch_engine_t<case_t>
+
+/* Double virtual dispatch, in the style of "shapes2.h".  The left-hand
+   element finds its own type with one virtual call, then hands itself to
+   the right-hand element, which finds its type with another. */
+template <typename case_t>
+struct virtual_engine_t final {
+
+  using lhs_t = typename case_t::lhs_t;
+  using rules_t = typename case_t::rules_t;
+
+  /* The right-hand side, which visits the left. */
+  struct rhs_base_t {
+    virtual ~rhs_base_t() {}
+    virtual bool test_with(const typename lhs_t::first_t &) const = 0;
+    virtual bool test_with(const typename lhs_t::second_t &) const = 0;
+    virtual bool test_with(const typename lhs_t::third_t &) const = 0;
+  };
+
+  template <typename elem_t>
+  struct rhs_of_t final : rhs_base_t {
+    explicit rhs_of_t(const elem_t &elem) : elem(elem) {}
+    bool test_with(const typename lhs_t::first_t &that) const override {
+      return rules_t()(that, elem);
+    }
+    bool test_with(const typename lhs_t::second_t &that) const override {
+      return rules_t()(that, elem);
+    }
+    bool test_with(const typename lhs_t::third_t &that) const override {
+      return rules_t()(that, elem);
+    }
+    elem_t elem;
+  };
+
+  /* The left-hand side. */
+  struct lhs_base_t {
+    virtual ~lhs_base_t() {}
+    virtual bool test(const rhs_base_t &that) const = 0;
+  };
+
+  template <typename elem_t>
+  struct lhs_of_t final : lhs_base_t {
+    explicit lhs_of_t(const elem_t &elem) : elem(elem) {}
+    bool test(const rhs_base_t &that) const override {
+      return that.test_with(elem);
+    }
+    elem_t elem;
+  };
+
+  using lhs_elem_t = unique_ptr<lhs_base_t>;
+  using rhs_elem_t = unique_ptr<rhs_base_t>;
+
+  static const char *get_name() { return "virtual"; }
+
+  template <typename elem_t>
+  static lhs_elem_t make_lhs(const elem_t &elem) {
+    return make_unique<lhs_of_t<elem_t>>(elem);
+  }
+
+  template <typename elem_t>
+  static rhs_elem_t make_rhs(const elem_t &elem) {
+    return make_unique<rhs_of_t<elem_t>>(elem);
+  }
+
+  static bool test(const lhs_elem_t &lhs, const rhs_elem_t &rhs) {
+    return lhs->test(*rhs);
+  }
+
+};  // virtual_engine_t<case_t>
+
+/* A std::variant of three alternatives. */
+template <typename three_t>
+using std_variant_of_t =
+    std::variant<typename three_t::first_t, typename three_t::second_t,
+                 typename three_t::third_t>;
+
+/* std::variants and std::visit. */
+template <typename case_t>
+struct std_engine_t final {
+
+  using lhs_elem_t = std_variant_of_t<typename case_t::lhs_t>;
+  using rhs_elem_t = std_variant_of_t<typename case_t::rhs_t>;
+
+  static const char *get_name() { return "std"; }
+
+  template <typename elem_t>
+  static lhs_elem_t make_lhs(const elem_t &elem) { return elem; }
+
+  template <typename elem_t>
+  static rhs_elem_t make_rhs(const elem_t &elem) { return elem; }
+
+  static bool test(const lhs_elem_t &lhs, const rhs_elem_t &rhs) {
+    return std::visit(typename case_t::rules_t(), lhs, rhs);
+  }
+
+};  // std_engine_t<case_t>
+
+/* ---------------------------------------------------------------------------
+The driver.
+--------------------------------------------------------------------------- */
+
+/* The mixes of alternatives, and how often each alternative comes up. */
+struct mix_t final {
+  const char *name;
+  double weights[3];
+};
+
+static const mix_t mixes[] = {
+  { "uniform", { 1, 1, 1 } },
+  { "skewed", { 8, 1, 1 } },
+  { "single", { 1, 0, 0 } }
+};
+
+/* Convert the variant_ts of the sources to the engine's elements. */
+template <typename elem_t, typename src_t, typename make_t>
+static vector<elem_t> build(const vector<src_t> &srcs, const make_t &make) {
+  vector<elem_t> elems;
+  elems.reserve(srcs.size());
+  for (const src_t &src : srcs) {
+    match<void>(src, [&](const auto &that) { elems.push_back(make(that)); });
+  }  // for
+  return elems;
+}
+
+/* Everything about one measurement but the engine. */
+template <typename case_t>
+struct setup_t final {
+  const flags_t &flags;
+  counters_t &counters;
+  report_t &report;
+  const char *mix;
+  vector<typename case_t::lhs_variant_t> lhs_srcs;
+  vector<typename case_t::rhs_variant_t> rhs_srcs;
+  /* The hits the first engine counted, which the others must match. */
+  size_t expected_hits;
+  bool has_expected_hits;
+};
+
+/* Measure an engine over all the pairs of the setup. */
+template <template <typename> class engine_tmpl, typename case_t>
+static void run(setup_t<case_t> &setup) {
+  using engine_t = engine_tmpl<case_t>;
+  if (!setup.flags.selects("engines", engine_t::get_name())) {
+    return;
+  }  // if
+  auto lhs = build<typename engine_t::lhs_elem_t>(
+      setup.lhs_srcs, [](const auto &that) {
+        return engine_t::make_lhs(that);
+      });
+  auto rhs = build<typename engine_t::rhs_elem_t>(
+      setup.rhs_srcs, [](const auto &that) {
+        return engine_t::make_rhs(that);
+      });
+  size_t hits = 0;
+  auto test_all = [&] {
+    hits = 0;
+    for (const auto &a : lhs) {
+      for (const auto &b : rhs) {
+        hits += engine_t::test(a, b);
+      }  // for
+    }  // for
+    keep(hits);
+  };
+  test_all();
+  if (!setup.has_expected_hits) {
+    setup.expected_hits = hits;
+    setup.has_expected_hits = true;
+  } else if (hits != setup.expected_hits) {
+    cerr << case_t::get_name() << ' ' << engine_t::get_name() << ' '
+         << setup.mix << ": counted " << hits << " hits, expected "
+         << setup.expected_hits << endl;
+    exit(EXIT_FAILURE);
+  }  // if
+  size_t pairs = lhs.size() * rhs.size();
+  stats_t stats = run_trials(pairs, trial_opts_t::from(setup.flags),
+                             test_all, &setup.counters);
+  setup.report.add({ string(case_t::get_name()) + ' ' +
+                         engine_t::get_name() + ' ' + setup.mix,
+                     pairs, stats, setup.counters.get_counts() });
+}
+
+/* Measure every engine on the case, with n elements on each side, in every
+   mix. */
+template <typename case_t>
+static void run_case(const flags_t &flags, size_t n, counters_t &counters,
+                     report_t &report) {
+  if (!flags.selects("cases", case_t::get_name())) {
+    return;
+  }  // if
+  for (const mix_t &mix : mixes) {
+    if (!flags.selects("mixes", mix.name)) {
+      continue;
+    }  // if
+    setup_t<case_t> setup{ flags, counters, report, mix.name, {}, {}, 0,
+                           false };
+    mt19937_64 gen(101);
+    discrete_distribution<size_t> kinds(begin(mix.weights),
+                                        end(mix.weights));
+    for (size_t i = 0; i < n; ++i) {
+      setup.lhs_srcs.push_back(case_t::make_lhs(kinds(gen), gen));
+      setup.rhs_srcs.push_back(case_t::make_rhs(kinds(gen), gen));
+    }  // for
+    run<applier_engine_t>(setup);
+    run<switch_engine_t>(setup);
+    run<virtual_engine_t>(setup);
+    run<std_engine_t>(setup);
+  }  // for
+}
+
+int main(int argc, char *argv[]) {
+  flags_t flags(argc, argv);
+  counters_t counters(flags, cerr);
+  report_t report(cout, flags);
+  for (size_t n : flags.get_counts("sizes", "100,1000")) {
+    run_case<intersects_case_t>(flags, n, counters, report);
+    run_case<transport_case_t>(flags, n, counters, report);
+  }  // for
+  return 0;
+}
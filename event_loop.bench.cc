@@ -0,0 +1,208 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Push a stream of events of randomly chosen types through an event_loop_t
+and drain it, first grouped by type and then in order, reporting the time
+per event.  Then do it again with each event stamped with the time it was
+queued, and report a histogram, per type, of how long events waited in the
+queue before they were handled.
+
+Usage: event_loop.bench [n [batch]]
+--------------------------------------------------------------------------- */
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "event_loop.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* The time now, in nanoseconds since some arbitrary moment. */
+static int64_t now_ns() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct key_event_t { int code; int64_t stamp; };
+struct mouse_event_t { int x, y; int64_t stamp; };
+struct timer_event_t { int id; int64_t stamp; };
+struct resize_event_t { int width, height; int64_t stamp; };
+
+/* The names of the event types, in order. */
+static const char *const names[] = { "key", "mouse", "timer", "resize" };
+
+/* The number of event types. */
+static constexpr size_t kinds = 4;
+
+/* Does a little work for each type of event. */
+struct summer_t final {
+  void operator()(const key_event_t &e) { sum += e.code; }
+  void operator()(const mouse_event_t &e) { sum += e.x * e.y; }
+  void operator()(const timer_event_t &e) { sum ^= e.id; }
+  void operator()(const resize_event_t &e) { sum += e.width + e.height; }
+  int64_t sum = 0;
+};
+
+/* Counts latencies in buckets by powers of 2: bucket i counts latencies of
+   at least 2^i, but less than 2^(i + 1), nanoseconds. */
+struct histogram_t final {
+  void add(int64_t ns) {
+    size_t i = 0;
+    while (ns > 1 && i < 63) {
+      ns >>= 1;
+      ++i;
+    }  // while
+    ++buckets[i];
+    ++count;
+  }
+  /* The upper bound of the bucket in which the given fraction of the
+     latencies fall. */
+  int64_t get_percentile(double frac) const {
+    uint64_t seen = 0, want = static_cast<uint64_t>(frac * count);
+    for (size_t i = 0; i < 64; ++i) {
+      seen += buckets[i];
+      if (seen > want) {
+        return int64_t(1) << (i + 1);
+      }  // if
+    }  // for
+    return 0;
+  }
+  uint64_t buckets[64] = {};
+  uint64_t count = 0;
+};
+
+/* Records the latency of each type of event. */
+struct stopwatch_t final {
+  void operator()(const key_event_t &e) { add(0, e.stamp); }
+  void operator()(const mouse_event_t &e) { add(1, e.stamp); }
+  void operator()(const timer_event_t &e) { add(2, e.stamp); }
+  void operator()(const resize_event_t &e) { add(3, e.stamp); }
+  void add(size_t kind, int64_t stamp) { hists[kind].add(now_ns() - stamp); }
+  histogram_t hists[kinds];
+};
+
+/* Queue an event of the given kind, stamped with the given time. */
+template <typename loop_t>
+static void push(loop_t &loop, uint8_t kind, int i, int64_t stamp) {
+  switch (kind) {
+    case 0: {
+      loop.template emplace<key_event_t>(key_event_t{i, stamp});
+      break;
+    }
+    case 1: {
+      loop.template emplace<mouse_event_t>(mouse_event_t{i, i + 1, stamp});
+      break;
+    }
+    case 2: {
+      loop.template emplace<timer_event_t>(timer_event_t{i, stamp});
+      break;
+    }
+    default: {
+      loop.template emplace<resize_event_t>(
+          resize_event_t{i, i + 2, stamp});
+      break;
+    }
+  }  // switch
+}
+
+/* Push each of the given kinds of events and drain a batch whenever the loop
+   fills.  If stamp is true, each event is stamped with the time. */
+template <typename loop_t, typename drain_t>
+static void run(loop_t &loop, const vector<uint8_t> &kinds_in_order,
+                bool stamp, drain_t &&drain) {
+  int i = 0;
+  for (uint8_t kind : kinds_in_order) {
+    if (loop.is_full()) {
+      drain(loop);
+    }  // if
+    push(loop, kind, i++, stamp ? now_ns() : 0);
+  }  // for
+  while (!loop.is_empty()) {
+    drain(loop);
+  }  // while
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 20000000);
+  size_t batch = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 1024;
+  vector<uint8_t> kinds_in_order(n);
+  mt19937 gen(101);
+  uniform_int_distribution<int> pick(0, kinds - 1);
+  for (auto &kind : kinds_in_order) {
+    kind = static_cast<uint8_t>(pick(gen));
+  }  // for
+  using summer_loop_t = event_loop_t<summer_t, key_event_t, mouse_event_t,
+                                     timer_event_t, resize_event_t>;
+  summer_loop_t summer_loop(batch);
+  measure(cout, "push + drain by type", n, [&] {
+    run(summer_loop, kinds_in_order, false,
+        [](summer_loop_t &loop) { loop.drain(); });
+  });
+  measure(cout, "push + drain in order", n, [&] {
+    run(summer_loop, kinds_in_order, false,
+        [](summer_loop_t &loop) { loop.drain_in_order(); });
+  });
+  keep(summer_loop.get_handler().sum);
+  using timer_loop_t = event_loop_t<stopwatch_t, key_event_t, mouse_event_t,
+                                    timer_event_t, resize_event_t>;
+  for (bool by_type : { true, false }) {
+    timer_loop_t timer_loop(batch);
+    run(timer_loop, kinds_in_order, true, [by_type](timer_loop_t &loop) {
+      if (by_type) {
+        loop.drain();
+      } else {
+        loop.drain_in_order();
+      }  // if
+    });
+    cout << endl << "latency (ns), drained "
+         << (by_type ? "by type" : "in order") << endl
+         << setw(8) << "type" << setw(12) << "events" << setw(10) << "p50 <"
+         << setw(10) << "p99 <" << setw(12) << "p99.99 <" << endl;
+    for (size_t kind = 0; kind < kinds; ++kind) {
+      const auto &hist = timer_loop.get_handler().hists[kind];
+      cout << setw(8) << names[kind] << setw(12) << hist.count << setw(10)
+           << hist.get_percentile(0.5) << setw(10)
+           << hist.get_percentile(0.99) << setw(12)
+           << hist.get_percentile(0.9999) << endl;
+    }  // for
+    cout << setw(8) << "bucket";
+    for (size_t kind = 0; kind < kinds; ++kind) {
+      cout << setw(12) << names[kind];
+    }  // for
+    cout << endl;
+    for (size_t i = 0; i < 64; ++i) {
+      bool any = false;
+      for (size_t kind = 0; kind < kinds; ++kind) {
+        any = any || timer_loop.get_handler().hists[kind].buckets[i];
+      }  // for
+      if (!any) {
+        continue;
+      }  // if
+      cout << setw(8) << (int64_t(1) << i);
+      for (size_t kind = 0; kind < kinds; ++kind) {
+        cout << setw(12) << timer_loop.get_handler().hists[kind].buckets[i];
+      }  // for
+      cout << endl;
+    }  // for
+  }  // for
+  return 0;
+}
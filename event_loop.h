@@ -0,0 +1,293 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A queue of events, each a variant of the event types, and a handler for
+them.
+
+The events live in a ring of fixed capacity, allocated once, so queueing an
+event never allocates.  The handler is a type with an overload of
+operator() for each event type, so the handler for each type is found at
+compile time.
+
+Draining the queue takes a batch of events and sorts it by type (a counting
+sort of positions in the ring, so the events themselves don't move).  Then
+all the events of the first type go to the handler, then all the events of
+the second type, and so on.  Each run of calls goes to the same overload of
+the handler, with no dispatch per event, so the handler's code stays hot.
+Within a type, events are handled in the order they were queued.  Across
+types, they are not; if you need that, use drain_in_order().
+
+See "event_loop.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace variant {
+
+/* A queue of events of the given types, handled by a handler_t.  The
+   handler_t must be callable with a const reference to each events_t. */
+template <typename handler_t, typename... events_t>
+class event_loop_t final {
+  public:
+
+  /* The type of event we queue. */
+  using event_t = variant_t<events_t...>;
+
+  /* An event is always one thing or another. */
+  static_assert(!any_of<std::is_same<events_t, null_t>::value...>::value,
+                "An event can't be null.");
+
+  /* No copying or moving. */
+  event_loop_t(const event_loop_t &) = delete;
+  event_loop_t &operator=(const event_loop_t &) = delete;
+
+  /* An empty queue with room for at least the given number of events.  The
+     capacity is rounded up to a power of 2. */
+  explicit event_loop_t(size_t min_capacity, handler_t handler = handler_t())
+      : handler(std::move(handler)),
+        mask(round_up(min_capacity) - 1),
+        slots(new slot_t[mask + 1]),
+        order(new uint32_t[mask + 1]) {
+    assert(mask <= UINT32_MAX);
+  }
+
+  /* Destroy whatever events are still queued, unhandled. */
+  ~event_loop_t() {
+    for (; head != tail; ++head) {
+      get_slot(head).~event_t();
+    }  // for
+  }
+
+  /* The handler to which we hand our events. */
+  handler_t &get_handler() noexcept {
+    assert(this);
+    return handler;
+  }
+
+  /* The number of events we can hold at once. */
+  size_t get_capacity() const noexcept {
+    assert(this);
+    return mask + 1;
+  }
+
+  /* The number of events queued. */
+  size_t size() const noexcept {
+    assert(this);
+    return tail - head;
+  }
+
+  /* True iff. we have no events queued. */
+  bool is_empty() const noexcept {
+    assert(this);
+    return head == tail;
+  }
+
+  /* True iff. we have no room to queue another event. */
+  bool is_full() const noexcept {
+    assert(this);
+    return tail - head > mask;
+  }
+
+  /* Construct an event of type elem_t at the back of the queue.  Returns
+     false, and does nothing, if the queue is full. */
+  template <typename elem_t, typename... args_t>
+  bool emplace(args_t &&... args) {
+    assert(this);
+    static_assert(index_of<elem_t, events_t...>() < sizeof...(events_t),
+                  "Not an event type of this loop.");
+    if (is_full()) {
+      return false;
+    }  // if
+    new (&slots[tail & mask]) event_t(elem_t(std::forward<args_t>(args)...));
+    ++tail;
+    return true;
+  }
+
+  /* Copy an event to the back of the queue.  Returns false, and does
+     nothing, if the queue is full. */
+  bool push(const event_t &event) {
+    assert(this);
+    if (is_full()) {
+      return false;
+    }  // if
+    new (&slots[tail & mask]) event_t(event);
+    ++tail;
+    return true;
+  }
+
+  /* Move an event to the back of the queue.  Returns false, and does
+     nothing, if the queue is full. */
+  bool push(event_t &&event) {
+    assert(this);
+    if (is_full()) {
+      return false;
+    }  // if
+    new (&slots[tail & mask]) event_t(std::move(event));
+    ++tail;
+    return true;
+  }
+
+  /* Hand up to max_batch of the queued events to the handler, grouped by
+     type, as described above, and return the number handled.  Events which
+     the handler queues are not handled until the next drain.  The handler
+     must not drain the loop itself. */
+  size_t drain(size_t max_batch = SIZE_MAX) {
+    assert(this);
+    assert(!draining);
+    size_t n = std::min(tail - head, max_batch);
+    if (!n) {
+      return 0;
+    }  // if
+    /* Count the events of each type, then turn the counts into the
+       position in the order at which each type's run begins. */
+    size_t begins[sizeof...(events_t) + 1] = {};
+    for (size_t i = 0; i < n; ++i) {
+      ++begins[get_slot(head + i).get_index() + 1];
+    }  // for
+    for (size_t i = 1; i <= sizeof...(events_t); ++i) {
+      begins[i] += begins[i - 1];
+    }  // for
+    size_t ends[sizeof...(events_t)];
+    std::copy(begins, begins + sizeof...(events_t), ends);
+    for (size_t i = 0; i < n; ++i) {
+      size_t pos = head + i;
+      order[ends[get_slot(pos).get_index()]++] = pos & mask;
+    }  // for
+    draining = true;
+    handle_runs(begins, std::index_sequence_for<events_t...>());
+    draining = false;
+    release(n);
+    return n;
+  }
+
+  /* Hand up to max_batch of the queued events to the handler, one at a
+     time, in the order they were queued, and return the number handled.
+     This dispatches on each event, so it's slower than drain(). */
+  size_t drain_in_order(size_t max_batch = SIZE_MAX) {
+    assert(this);
+    assert(!draining);
+    size_t n = std::min(tail - head, max_batch);
+    draining = true;
+    for (size_t i = 0; i < n; ++i) {
+      apply(forwarder_t{handler}, get_slot(head + i));
+    }  // for
+    draining = false;
+    release(n);
+    return n;
+  }
+
+  private:
+
+  /* Raw storage for one event. */
+  using slot_t = std::aligned_storage_t<sizeof(event_t), alignof(event_t)>;
+
+  /* Used by drain_in_order() to pass an event to the handler. */
+  struct forwarder_t final {
+
+    using ret_t = void;
+
+    template <typename elem_t>
+    void operator()(const elem_t &elem) const {
+      handler(elem);
+    }
+
+    handler_t &handler;
+
+  };  // forwarder_t
+
+  /* The smallest power of 2 not less than n, nor less than 1. */
+  static size_t round_up(size_t n) noexcept {
+    size_t result = 1;
+    while (result < n) {
+      result <<= 1;
+    }  // while
+    return result;
+  }
+
+  /* The event at the given position in the ring. */
+  event_t &get_slot(size_t pos) noexcept {
+    return *reinterpret_cast<event_t *>(&slots[pos & mask]);
+  }
+
+  /* Hand each run of the order to the handler, one type at a time. */
+  template <size_t... idxs>
+  void handle_runs(const size_t *begins, std::index_sequence<idxs...>) {
+    (void)std::initializer_list<int>{
+        (handle_run<idxs>(begins[idxs], begins[idxs + 1]), 0)... };
+  }
+
+  /* Hand the events in [begin, end) of the order, all of which are of the
+     type at position idx, to the handler. */
+  template <size_t idx>
+  void handle_run(size_t begin, size_t end) {
+    using elem_t = nth_t<idx, events_t...>;
+    for (; begin < end; ++begin) {
+      const elem_t *elem =
+          reinterpret_cast<const event_t *>(&slots[order[begin]])
+              ->template try_as<elem_t>();
+      assert(elem);
+      handler(*elem);
+    }  // for
+  }
+
+  /* Destroy the first n events in the queue and take them off it.  If no
+     event type needs destroying, neither does the variant holding it, so
+     we skip the loop. */
+  void release(size_t n) noexcept {
+    if (!all_of<std::is_trivially_destructible<events_t>::value...>::value) {
+      for (size_t i = 0; i < n; ++i) {
+        get_slot(head + i).~event_t();
+      }  // for
+    }  // if
+    head += n;
+  }
+
+  /* See accessor. */
+  handler_t handler;
+
+  /* One less than our capacity, which is a power of 2. */
+  const size_t mask;
+
+  /* The ring of events.  The live ones are at the positions in
+     [head, tail), taken modulo our capacity. */
+  std::unique_ptr<slot_t[]> slots;
+
+  /* Scratch space for drain(), in which we sort the positions of a batch. */
+  std::unique_ptr<uint32_t[]> order;
+
+  /* The positions of the first event queued and of the next to queue.
+     These only ever grow. */
+  size_t head = 0, tail = 0;
+
+  /* True while we're handing events to the handler. */
+  bool draining = false;
+
+};  // event_loop_t<handler_t, events_t...>
+
+}  // variant
+}  // cppcon14
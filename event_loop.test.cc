@@ -0,0 +1,100 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the event loop in "event_loop.h".
+--------------------------------------------------------------------------- */
+
+#include "event_loop.h"
+
+#include <memory>
+#include <string>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+
+struct keypress_t { char key; };
+struct click_t { int x, y; };
+
+/* Writes down what it's handed. */
+struct logger_t final {
+  void operator()(const keypress_t &key) { log += key.key; }
+  void operator()(const click_t &click) { log += to_string(click.x); }
+  void operator()(const string &str) { log += "[" + str + "]"; }
+  string log;
+};
+
+/* A loop of keys, clicks and strings. */
+using loop_t = event_loop_t<logger_t, keypress_t, click_t, string>;
+
+FIXTURE(loop_capacity) {
+  loop_t loop(3);
+  EXPECT_EQ(loop.get_capacity(), 4u);
+  EXPECT_TRUE(loop.is_empty());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(loop.emplace<click_t>(click_t{i, 0}));
+  }
+  EXPECT_TRUE(loop.is_full());
+  EXPECT_FALSE(loop.emplace<click_t>(click_t{4, 0}));
+  EXPECT_EQ(loop.size(), 4u);
+}
+
+FIXTURE(loop_drain_groups_by_type) {
+  loop_t loop(16);
+  loop.emplace<keypress_t>(keypress_t{'a'});
+  loop.emplace<click_t>(click_t{1, 0});
+  loop.push(loop_t::event_t(string("hello")));
+  loop.emplace<keypress_t>(keypress_t{'b'});
+  loop.emplace<click_t>(click_t{2, 0});
+  EXPECT_EQ(loop.drain(), 5u);
+  EXPECT_EQ(loop.get_handler().log, "ab12[hello]");
+  EXPECT_TRUE(loop.is_empty());
+}
+
+FIXTURE(loop_drain_in_order) {
+  loop_t loop(16);
+  loop.emplace<keypress_t>(keypress_t{'a'});
+  loop.emplace<click_t>(click_t{1, 0});
+  loop.push(loop_t::event_t(string("hello")));
+  loop.emplace<keypress_t>(keypress_t{'b'});
+  EXPECT_EQ(loop.drain_in_order(), 4u);
+  EXPECT_EQ(loop.get_handler().log, "a1[hello]b");
+}
+
+FIXTURE(loop_drain_batch) {
+  loop_t loop(4);
+  for (char c = 'a'; c < 'e'; ++c) {
+    loop.emplace<keypress_t>(keypress_t{c});
+  }
+  EXPECT_EQ(loop.drain(3), 3u);
+  EXPECT_EQ(loop.get_handler().log, "abc");
+  /* The ring wraps around. */
+  EXPECT_TRUE(loop.emplace<keypress_t>(keypress_t{'e'}));
+  EXPECT_TRUE(loop.emplace<keypress_t>(keypress_t{'f'}));
+  EXPECT_EQ(loop.drain(), 3u);
+  EXPECT_EQ(loop.get_handler().log, "abcdef");
+}
+
+FIXTURE(loop_destroys_unhandled) {
+  auto ptr = make_shared<int>(101);
+  {
+    event_loop_t<logger_t, keypress_t, shared_ptr<int>> loop(4);
+    loop.push(ptr);
+    loop.push(ptr);
+    EXPECT_EQ(ptr.use_count(), 3);
+  }
+  EXPECT_EQ(ptr.use_count(), 1);
+}
@@ -0,0 +1,128 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Sum a number from each of a vector of things, each of which is a shape or a
+transport, first kept nested (a variant of variants, dispatched twice) and
+then kept flattened (dispatched once).  Also report the size of each form,
+and the cost of converting between them.
+
+Usage: flatten.bench [n]
+--------------------------------------------------------------------------- */
+
+#include <vector>
+
+#include "bench.h"
+#include "flatten.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+struct circle_t { double radius; };
+struct square_t { double side; };
+struct triangle_t { double base, height; };
+struct car_t { int seats; };
+struct boat_t { int length; };
+struct plane_t { int engines; };
+
+using shape_t = variant_t<circle_t, square_t, triangle_t>;
+using transport_t = variant_t<car_t, boat_t, plane_t>;
+using thing_t = variant_t<shape_t, transport_t>;
+using flat_thing_t = flatten_t<thing_t>;
+
+/* Written for the leaves. */
+struct get_number_t final {
+  using ret_t = double;
+  double operator()(const circle_t &that) const { return that.radius; }
+  double operator()(const square_t &that) const { return that.side; }
+  double operator()(const triangle_t &that) const { return that.base; }
+  double operator()(const car_t &that) const { return that.seats; }
+  double operator()(const boat_t &that) const { return that.length; }
+  double operator()(const plane_t &that) const { return that.engines; }
+};
+
+/* The same, for the nested form, which must dispatch again on the inner
+   variant. */
+struct get_nested_number_t final {
+  using ret_t = double;
+  template <typename inner_t>
+  double operator()(const inner_t &that) const {
+    return apply(get_number_t(), that);
+  }
+};
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 20000000);
+  cout << "sizeof(thing_t) = " << sizeof(thing_t)
+       << ", sizeof(flat_thing_t) = " << sizeof(flat_thing_t) << endl;
+  vector<thing_t> nested;
+  nested.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    switch (i % 6) {
+      case 0: {
+        nested.push_back(shape_t(circle_t{1.0}));
+        break;
+      }
+      case 1: {
+        nested.push_back(transport_t(car_t{4}));
+        break;
+      }
+      case 2: {
+        nested.push_back(shape_t(square_t{2.0}));
+        break;
+      }
+      case 3: {
+        nested.push_back(transport_t(boat_t{12}));
+        break;
+      }
+      case 4: {
+        nested.push_back(shape_t(triangle_t{3.0, 1.0}));
+        break;
+      }
+      default: {
+        nested.push_back(transport_t(plane_t{2}));
+        break;
+      }
+    }  // switch
+  }  // for
+  vector<flat_thing_t> flat;
+  flat.reserve(n);
+  for (const auto &thing : nested) {
+    flat.push_back(flatten(thing));
+  }  // for
+  measure(cout, "flatten", n, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      flat[i] = flatten(nested[i]);
+    }  // for
+  });
+  double total = 0;
+  measure(cout, "apply, nested", n, [&] {
+    for (const auto &thing : nested) {
+      total += apply(get_nested_number_t(), thing);
+    }  // for
+  });
+  measure(cout, "apply, flat", n, [&] {
+    for (const auto &thing : flat) {
+      total += apply(get_number_t(), thing);
+    }  // for
+  });
+  measure(cout, "unflatten", n, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      nested[i] = unflatten<thing_t>(flat[i]);
+    }  // for
+  });
+  keep(total);
+  return 0;
+}
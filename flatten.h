@@ -0,0 +1,382 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Flattening variants of variants into a single variant of their leaves.
+
+  flatten_t<variant_t<shape_t, transport_t>>
+      A variant_t of every type which a shape_t or a transport_t can hold,
+      each once, in order of first appearance.  Variants nested deeper are
+      flattened too.  Only alternatives which are exactly variant_t types
+      are flattened; classes derived from them (such as calc::val_t) are
+      leaves like any other.
+  flatten(nested)
+      The flattened form of a nested variant, copying or moving its leaf.
+      Like a variant's move constructor, moving leaves behind null, at each
+      level which can be null.
+  unflatten<nested_t>(flat)
+      The nested form of a flattened variant.  A leaf which appears in more
+      than one place in nested_t goes to the first of them.
+
+A nested variant is bigger than it needs to be, as each inner variant brings
+its own tag and vtable pointer, and matching on it dispatches once per level.
+Keep values flat, and a functor written for the leaf types dispatches just
+once:
+
+  using thing_t = flatten_t<variant_t<shape_t, transport_t>>;
+  thing_t thing = flatten(nested);
+  apply(get_name_t(), thing);
+
+Converting costs one table lookup per level of nesting, plus a copy or move
+of the leaf.
+
+See "flatten.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace variant {
+
+/* ---------------------------------------------------------------------------
+Lists of types.  We concatenate lists and remove duplicates from them by
+working out, with constexpr functions, where each type of the result comes
+from, and picking it out with nth_t.  That way the depth of instantiation
+doesn't grow with the number of types.
+--------------------------------------------------------------------------- */
+
+/* A list of types. */
+template <typename... elems_t>
+struct type_list_t final {};
+
+/* The number of types in a list. */
+template <typename list_t>
+struct list_size;
+
+template <typename... elems_t>
+struct list_size<type_list_t<elems_t...>>
+    : std::integral_constant<size_t, sizeof...(elems_t)> {};
+
+/* The type at position idx in a list. */
+template <size_t idx, typename list_t>
+struct list_nth;
+
+template <size_t idx, typename... elems_t>
+struct list_nth<idx, type_list_t<elems_t...>> {
+  using type = nth_t<idx, elems_t...>;
+};
+
+/* The sum of some sizes. */
+template <size_t... sizes>
+constexpr size_t sum_of() {
+  constexpr size_t all[] = { sizes..., 0 };
+  size_t total = 0;
+  for (size_t size : all) {
+    total += size;
+  }  // for
+  return total;
+}
+
+/* Given the sizes of some lists, the list in which position pos of their
+   concatenation falls. */
+template <size_t... sizes>
+constexpr size_t list_at(size_t pos) {
+  constexpr size_t all[] = { sizes..., 0 };
+  size_t idx = 0;
+  while (pos >= all[idx]) {
+    pos -= all[idx];
+    ++idx;
+  }  // while
+  return idx;
+}
+
+/* As above, but the position within that list. */
+template <size_t... sizes>
+constexpr size_t offset_at(size_t pos) {
+  constexpr size_t all[] = { sizes..., 0 };
+  size_t idx = 0;
+  while (pos >= all[idx]) {
+    pos -= all[idx];
+    ++idx;
+  }  // while
+  return pos;
+}
+
+/* The lists, one after another. */
+template <typename idxs_t, typename... lists_t>
+struct concat;
+
+template <size_t... idxs, typename... lists_t>
+struct concat<std::index_sequence<idxs...>, lists_t...> {
+  using type = type_list_t<typename list_nth<
+      offset_at<list_size<lists_t>::value...>(idxs),
+      nth_t<list_at<list_size<lists_t>::value...>(idxs),
+            lists_t...>>::type...>;
+};
+
+template <typename... lists_t>
+using concat_t = typename concat<
+    std::make_index_sequence<sum_of<list_size<lists_t>::value...>()>,
+    lists_t...>::type;
+
+/* The position in elems_t of the kth type which isn't a repeat of an
+   earlier one, or sizeof...(elems_t) if there aren't that many. */
+template <typename... elems_t>
+constexpr size_t unique_at(size_t k) {
+  constexpr size_t firsts[] = { index_of<elems_t, elems_t...>()..., 0 };
+  size_t idx = 0;
+  for (; idx < sizeof...(elems_t); ++idx) {
+    if (firsts[idx] == idx) {
+      if (!k) {
+        break;
+      }  // if
+      --k;
+    }  // if
+  }  // for
+  return idx;
+}
+
+/* The number of distinct types in elems_t. */
+template <typename... elems_t>
+constexpr size_t unique_count() {
+  constexpr size_t firsts[] = { index_of<elems_t, elems_t...>()..., 0 };
+  size_t count = 0;
+  for (size_t idx = 0; idx < sizeof...(elems_t); ++idx) {
+    count += (firsts[idx] == idx);
+  }  // for
+  return count;
+}
+
+/* The list, with each type kept only where it first appears. */
+template <typename list_t, typename idxs_t = void>
+struct unique;
+
+template <typename... elems_t>
+struct unique<type_list_t<elems_t...>, void>
+    : unique<type_list_t<elems_t...>,
+             std::make_index_sequence<unique_count<elems_t...>()>> {};
+
+template <typename... elems_t, size_t... ks>
+struct unique<type_list_t<elems_t...>, std::index_sequence<ks...>> {
+  using type = type_list_t<nth_t<unique_at<elems_t...>(ks), elems_t...>...>;
+};
+
+template <typename list_t>
+using unique_t = typename unique<list_t>::type;
+
+/* ---------------------------------------------------------------------------
+flatten_t<variant_t>
+--------------------------------------------------------------------------- */
+
+/* The leaves under a type, with repeats: the type itself, unless it's a
+   variant, in which case the leaves under each of its types. */
+template <typename elem_t>
+struct leaves {
+  using type = type_list_t<elem_t>;
+};
+
+template <typename... elems_t>
+struct leaves<variant_t<elems_t...>> {
+  using type = concat_t<typename leaves<elems_t>::type...>;
+};
+
+/* A variant of the types in a list. */
+template <typename list_t>
+struct variant_of;
+
+template <typename... elems_t>
+struct variant_of<type_list_t<elems_t...>> {
+  using type = variant_t<elems_t...>;
+};
+
+/* The flattened form of a variant. */
+template <typename nested_t>
+using flatten_t = typename variant_of<
+    unique_t<typename leaves<std::decay_t<nested_t>>::type>>::type;
+
+/* True iff. leaf_t is among the leaves under elem_t. */
+template <typename elem_t, typename leaf_t>
+struct has_leaf : std::is_same<elem_t, leaf_t> {};
+
+template <typename... elems_t, typename leaf_t>
+struct has_leaf<variant_t<elems_t...>, leaf_t>
+    : any_of<has_leaf<elems_t, leaf_t>::value...> {};
+
+/* ---------------------------------------------------------------------------
+Converting between nested and flattened forms.
+--------------------------------------------------------------------------- */
+
+/* The forwarding reference to an elem_t held by a variant, given a
+   forwarding reference to the variant. */
+template <typename elem_t, typename that_t>
+using elem_ref_t = std::conditional_t<std::is_lvalue_reference<that_t>::value,
+                                      const elem_t &, elem_t &&>;
+
+/* Null a variant we've just moved from, if it can be null, just as its own
+   move constructor would. */
+template <typename that_t>
+void leave_null(that_t &that, std::true_type) {
+  that.reset();
+}
+
+/* We copied from the variant, or it can't be null, so leave it be. */
+template <typename that_t>
+void leave_null(that_t &, std::false_type) {}
+
+/* True iff. the variant referred to by that_t is being moved from and has
+   a null state. */
+template <typename that_t, typename... elems_t>
+using is_nullable_donor = std::integral_constant<
+    bool,
+    !std::is_lvalue_reference<that_t>::value &&
+    any_of<std::is_same<elems_t, null_t>::value...>::value>;
+
+/* Defined below, as it's mutually recursive with flatten_leaf(). */
+template <typename flat_t, typename that_t, typename... elems_t>
+flat_t flatten_into(that_t &&that, identity<variant_t<elems_t...>>);
+
+/* A leaf, which becomes the flat variant. */
+template <typename flat_t, typename that_t, typename elem_t>
+flat_t flatten_leaf(that_t &&that, identity<elem_t>) {
+  return flat_t(std::forward<that_t>(that));
+}
+
+/* A null leaf, which becomes a null flat variant. */
+template <typename flat_t, typename that_t>
+flat_t flatten_leaf(that_t &&, identity<null_t>) {
+  return flat_t();
+}
+
+/* A nested variant, which we flatten in turn. */
+template <typename flat_t, typename that_t, typename... elems_t>
+flat_t flatten_leaf(that_t &&that, identity<variant_t<elems_t...>>) {
+  return flatten_into<flat_t>(std::forward<that_t>(that),
+                              identity<variant_t<elems_t...>>());
+}
+
+/* An entry in the table used by flatten_into(), below. */
+template <typename flat_t, typename elem_t, typename that_t,
+          typename nullable_t>
+flat_t flatten_elem(that_t &&that) {
+  flat_t result = flatten_leaf<flat_t>(
+      static_cast<elem_ref_t<elem_t, that_t>>(
+          *that.template try_as<elem_t>()),
+      identity<elem_t>());
+  leave_null(that, nullable_t());
+  return result;
+}
+
+/* Look up the variant's state in a table and carry it over. */
+template <typename flat_t, typename that_t, typename... elems_t>
+flat_t flatten_into(that_t &&that, identity<variant_t<elems_t...>>) {
+  static constexpr flat_t (*const flatteners[])(that_t &&) = {
+    &flatten_elem<flat_t, elems_t, that_t,
+                  is_nullable_donor<that_t, elems_t...>>...
+  };
+  return flatteners[that.get_index()](std::forward<that_t>(that));
+}
+
+/* The flattened form of a nested variant, copying or moving its leaf. */
+template <typename that_t,
+          typename = std::enable_if_t<is_variant<std::decay_t<that_t>>::value>>
+flatten_t<that_t> flatten(that_t &&that) {
+  return flatten_into<flatten_t<that_t>>(
+      std::forward<that_t>(that), identity<std::decay_t<that_t>>());
+}
+
+/* The position among elems_t of the first which is, or has among its
+   leaves, leaf_t. */
+template <typename leaf_t, typename... elems_t>
+constexpr size_t route_of() {
+  constexpr bool matches[] = { has_leaf<elems_t, leaf_t>::value..., true };
+  size_t idx = 0;
+  while (!matches[idx]) {
+    ++idx;
+  }  // while
+  return idx;
+}
+
+/* Defined below, as it's mutually recursive with wrap_via(). */
+template <typename target_t, typename leaf_t, typename... elems_t>
+target_t wrap_leaf(leaf_t &&leaf, identity<variant_t<elems_t...>>);
+
+/* The route leads to the leaf itself. */
+template <typename target_t, typename leaf_t, typename next_t>
+target_t wrap_via(leaf_t &&leaf, identity<next_t>) {
+  return target_t(std::forward<leaf_t>(leaf));
+}
+
+/* The route leads to null. */
+template <typename target_t, typename leaf_t>
+target_t wrap_via(leaf_t &&, identity<null_t>) {
+  return target_t();
+}
+
+/* The route leads into a nested variant, which we build first. */
+template <typename target_t, typename leaf_t, typename... elems_t>
+target_t wrap_via(leaf_t &&leaf, identity<variant_t<elems_t...>>) {
+  return target_t(wrap_leaf<variant_t<elems_t...>>(
+      std::forward<leaf_t>(leaf), identity<variant_t<elems_t...>>()));
+}
+
+/* Build a variant of type target_t around a leaf, following the first
+   route which leads to it. */
+template <typename target_t, typename leaf_t, typename... elems_t>
+target_t wrap_leaf(leaf_t &&leaf, identity<variant_t<elems_t...>>) {
+  using next_t =
+      nth_t<route_of<std::decay_t<leaf_t>, elems_t...>(), elems_t...>;
+  return wrap_via<target_t>(std::forward<leaf_t>(leaf), identity<next_t>());
+}
+
+/* An entry in the table used by unflatten(), below. */
+template <typename nested_t, typename elem_t, typename that_t,
+          typename nullable_t>
+nested_t unflatten_elem(that_t &&that) {
+  nested_t result = wrap_leaf<nested_t>(
+      static_cast<elem_ref_t<elem_t, that_t>>(
+          *that.template try_as<elem_t>()),
+      identity<nested_t>());
+  leave_null(that, nullable_t());
+  return result;
+}
+
+/* Look up the flat variant's state in a table and carry it over. */
+template <typename nested_t, typename that_t, typename... elems_t>
+nested_t unflatten(that_t &&that, identity<variant_t<elems_t...>>) {
+  static_assert(all_of<has_leaf<nested_t, elems_t>::value...>::value,
+                "Every type of the flat variant must be a leaf of the "
+                "nested one.");
+  static constexpr nested_t (*const unflatteners[])(that_t &&) = {
+    &unflatten_elem<nested_t, elems_t, that_t,
+                    is_nullable_donor<that_t, elems_t...>>...
+  };
+  return unflatteners[that.get_index()](std::forward<that_t>(that));
+}
+
+/* The nested form of a flattened variant, copying or moving its leaf. */
+template <typename nested_t, typename that_t,
+          typename = std::enable_if_t<is_variant<std::decay_t<that_t>>::value>>
+nested_t unflatten(that_t &&that) {
+  return unflatten<nested_t>(std::forward<that_t>(that),
+                             identity<std::decay_t<that_t>>());
+}
+
+}  // variant
+}  // cppcon14
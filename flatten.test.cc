@@ -0,0 +1,138 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of flatten_t, flatten() and unflatten().
+--------------------------------------------------------------------------- */
+
+#include "flatten.h"
+
+#include <string>
+#include <type_traits>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+
+struct circle_t { int radius; };
+struct square_t { int side; };
+struct car_t { string make; };
+struct boat_t { int length; };
+
+using shape_t = variant_t<circle_t, square_t>;
+using transport_t = variant_t<car_t, boat_t, null_t>;
+
+/* Boats float in both. */
+using floater_t = variant_t<boat_t, circle_t>;
+
+using thing_t = variant_t<shape_t, transport_t, int>;
+using flat_thing_t = flatten_t<thing_t>;
+
+/* Written for the leaves alone. */
+struct get_name_t final {
+  using ret_t = string;
+  string operator()(const circle_t &) const { return "circle"; }
+  string operator()(const square_t &) const { return "square"; }
+  string operator()(const car_t &car) const { return car.make; }
+  string operator()(const boat_t &) const { return "boat"; }
+  string operator()(int) const { return "int"; }
+  string operator()(null_t) const { return "null"; }
+};
+
+FIXTURE(flatten_type) {
+  EXPECT_TRUE((is_same<
+      flat_thing_t,
+      variant_t<circle_t, square_t, car_t, boat_t, null_t, int>>::value));
+  /* Deeper nesting, with repeats, which keep their first place. */
+  EXPECT_TRUE((is_same<
+      flatten_t<variant_t<floater_t, variant_t<transport_t, shape_t>>>,
+      variant_t<boat_t, circle_t, car_t, null_t, square_t>>::value));
+  /* Already flat. */
+  EXPECT_TRUE((is_same<flatten_t<shape_t>, shape_t>::value));
+  /* The flat form needs one tag and one vtable pointer, not two. */
+  EXPECT_LT(sizeof(flat_thing_t), sizeof(thing_t));
+}
+
+FIXTURE(flatten_value) {
+  thing_t a = shape_t(square_t{3});
+  flat_thing_t b = flatten(a);
+  if (EXPECT_TRUE(b.try_as<square_t>())) {
+    EXPECT_EQ(b.try_as<square_t>()->side, 3);
+  }
+  EXPECT_EQ(apply(get_name_t(), b), "square");
+  thing_t c = 101;
+  EXPECT_EQ(flatten(c).as<int>(), 101);
+}
+
+FIXTURE(flatten_null) {
+  thing_t a = transport_t();
+  flat_thing_t b = flatten(a);
+  EXPECT_FALSE(b);
+  EXPECT_EQ(apply(get_name_t(), b), "null");
+}
+
+FIXTURE(flatten_moves) {
+  thing_t a = transport_t(car_t{"a car with a name too long to keep inline"});
+  const char *make = a.as<transport_t>().as<car_t>().make.data();
+  flat_thing_t b = flatten(move(a));
+  /* The string's buffer moved rather than being copied, and the donor's
+     inner variant was left null. */
+  EXPECT_EQ(b.as<car_t>().make.data(), make);
+  EXPECT_FALSE(a.as<transport_t>());
+}
+
+FIXTURE(unflatten_value) {
+  flat_thing_t a = boat_t{12};
+  thing_t b = unflatten<thing_t>(a);
+  if (EXPECT_TRUE(b.try_as<transport_t>())) {
+    EXPECT_EQ(b.as<transport_t>().as<boat_t>().length, 12);
+  }
+  thing_t c = unflatten<thing_t>(flat_thing_t(7));
+  EXPECT_EQ(c.as<int>(), 7);
+  thing_t d = unflatten<thing_t>(flat_thing_t());
+  if (EXPECT_TRUE(d.try_as<transport_t>())) {
+    EXPECT_FALSE(d.as<transport_t>());
+  }
+}
+
+FIXTURE(unflatten_first_route) {
+  using nested_t = variant_t<floater_t, shape_t>;
+  /* A circle could go into either; it goes into the first. */
+  nested_t a = unflatten<nested_t>(flatten_t<nested_t>(circle_t{1}));
+  EXPECT_TRUE(a.try_as<floater_t>());
+  nested_t b = unflatten<nested_t>(flatten_t<nested_t>(square_t{1}));
+  EXPECT_TRUE(b.try_as<shape_t>());
+}
+
+FIXTURE(round_trip) {
+  thing_t things[] = {
+    shape_t(circle_t{1}), shape_t(square_t{2}), transport_t(car_t{"vw"}),
+    transport_t(boat_t{4}), transport_t(), 5
+  };
+  for (const auto &thing : things) {
+    thing_t copy = unflatten<thing_t>(flatten(thing));
+    EXPECT_EQ(copy.get_index(), thing.get_index());
+    EXPECT_EQ(apply(get_name_t(), flatten(copy)),
+              apply(get_name_t(), flatten(thing)));
+  }  // for
+}
+
+FIXTURE(unflatten_moves) {
+  flat_thing_t a = car_t{"another car with a name too long to keep inline"};
+  const char *make = a.as<car_t>().make.data();
+  thing_t b = unflatten<thing_t>(move(a));
+  EXPECT_EQ(b.as<transport_t>().as<car_t>().make.data(), make);
+  EXPECT_FALSE(a);
+}
@@ -0,0 +1,374 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Constant folding and algebraic simplification of the calculator's
+expressions.
+
+fold() returns an expression which evaluates, in any scope, to the same
+value as the one it's given, or throws the same error, but which does less
+work doing it:
+
+  * An operator whose operands are all literals becomes the literal it
+    evaluates to, computed by eval_t and so by the same functors.  If that
+    throws, the operator is left alone, to throw when it's evaluated.
+  * x * 1, 1 * x, x + 0 and 0 + x become x, and not not x becomes x, where
+    what we know of x's type makes that exact (see get_kind()).
+  * 1 and x, x and 1, 0 or x and x or 0 become x where x is known to be 0
+    or 1.
+  * 0 and x becomes 0, and 1 or x (or any other int but 0) becomes 1, as
+    and and or short-circuit, never evaluating x.
+  * (x * a) * b becomes x * (a * b) for int literals a and b (if x might
+    be a string, only when a, b and their product are neither negative nor
+    too big), and (x + a) + b becomes x + (a + b) for two int or two string
+    literals, which folds the literals together.
+  * The bodies of lambda literals are folded too.
+
+Subexpressions which don't change are shared with the original, not copied.
+
+See "fold.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "calc.h"
+#include "val.h"
+#include "variant.h"
+
+namespace cppcon14 {
+namespace calc {
+
+/* ---------------------------------------------------------------------------
+What we know of a value without computing it.
+--------------------------------------------------------------------------- */
+
+/* The type of an expression's value, should evaluating it not throw. */
+enum class val_kind_t {
+
+  /* Could be anything. */
+  any,
+
+  /* An int. */
+  int_,
+
+  /* An int, either 0 or 1. */
+  bool_,
+
+  /* A string. */
+  str
+
+};  // val_kind_t
+
+/* True iff. the kind is an int of some sort. */
+inline bool is_int(val_kind_t kind) {
+  return kind == val_kind_t::int_ || kind == val_kind_t::bool_;
+}
+
+/* Works out the kind of an expression's value from what its operators
+   accept.  Each succeeds only for the operands listed in "val.h", so, for
+   example, an add with an int on either side can only produce an int.  We
+   look at most depth operators down, so that folding, which asks at every
+   node, stays linear. */
+struct get_kind_t final {
+
+  using ret_t = val_kind_t;
+
+  /* How far down we look by default. */
+  static constexpr size_t max_depth = 8;
+
+  val_kind_t operator()(const lit_t &that) const {
+    if (const auto *val = that.val->try_as<int>()) {
+      return (*val == 0 || *val == 1) ? val_kind_t::bool_ : val_kind_t::int_;
+    }  // if
+    if (that.val->try_as<std::string>()) {
+      return val_kind_t::str;
+    }  // if
+    return val_kind_t::any;
+  }
+
+  val_kind_t operator()(const affix_t &that) const {
+    switch (that.op) {
+      case affix_t::neg: {
+        return val_kind_t::int_;
+      }
+      case affix_t::not_: {
+        return val_kind_t::bool_;
+      }
+      case affix_t::to_int: {
+        return val_kind_t::int_;
+      }
+      case affix_t::to_str: {
+        return val_kind_t::str;
+      }
+    }  // switch
+    return val_kind_t::any;
+  }
+
+  val_kind_t operator()(const infix_t &that) const {
+    switch (that.op) {
+      case infix_t::add: {
+        if (!depth) {
+          return val_kind_t::any;
+        }  // if
+        val_kind_t lhs = apply(get_kind_t{ depth - 1 }, *that.lhs),
+                   rhs = apply(get_kind_t{ depth - 1 }, *that.rhs);
+        if (is_int(lhs) || is_int(rhs)) {
+          return val_kind_t::int_;
+        }  // if
+        if (lhs == val_kind_t::str || rhs == val_kind_t::str) {
+          return val_kind_t::str;
+        }  // if
+        return val_kind_t::any;
+      }
+      case infix_t::mul: {
+        if (!depth) {
+          return val_kind_t::any;
+        }  // if
+        val_kind_t lhs = apply(get_kind_t{ depth - 1 }, *that.lhs);
+        if (is_int(lhs)) {
+          return val_kind_t::int_;
+        }  // if
+        return (lhs == val_kind_t::str) ? val_kind_t::str : val_kind_t::any;
+      }
+      case infix_t::lt:
+      case infix_t::and_:
+      case infix_t::or_: {
+        return val_kind_t::bool_;
+      }
+    }  // switch
+    return val_kind_t::any;
+  }
+
+  val_kind_t operator()(const ref_t &) const {
+    return val_kind_t::any;
+  }
+
+  val_kind_t operator()(const apply_t &) const {
+    return val_kind_t::any;
+  }
+
+  /* How much further down we may look. */
+  size_t depth;
+
+};  // get_kind_t
+
+/* The kind of the expression's value. */
+inline val_kind_t get_kind(const expr_t &expr) {
+  return apply(get_kind_t{ get_kind_t::max_depth }, expr);
+}
+
+/* ---------------------------------------------------------------------------
+Folding.
+--------------------------------------------------------------------------- */
+
+/* Folds the expression which self points to, of which the functor is
+   given the contents. */
+struct fold_t final {
+
+  using ret_t = expr_ptr_t;
+
+  expr_ptr_t operator()(const lit_t &that) const {
+    const auto *lambda = that.val->try_as<lambda_t>();
+    if (!lambda) {
+      return self;
+    }  // if
+    expr_ptr_t def = fold(lambda->def);
+    if (def == lambda->def) {
+      return self;
+    }  // if
+    lambda_t::params_t params = lambda->params;
+    return make_lit(lambda_t(std::move(params), def));
+  }
+
+  expr_ptr_t operator()(const affix_t &that) const {
+    expr_ptr_t arg = fold(that.arg);
+    if (arg->try_as<lit_t>()) {
+      return eval_or_keep(affix_t(that.op, arg));
+    }  // if
+    const auto *inner = arg->try_as<affix_t>();
+    if (that.op == affix_t::not_ && inner && inner->op == affix_t::not_ &&
+        get_kind(*inner->arg) == val_kind_t::bool_) {
+      return inner->arg;
+    }  // if
+    if (that.op == affix_t::to_int && is_int(get_kind(*arg))) {
+      return arg;
+    }  // if
+    if (that.op == affix_t::to_str && get_kind(*arg) == val_kind_t::str) {
+      return arg;
+    }  // if
+    return (arg == that.arg) ? self : make(affix_t(that.op, arg));
+  }
+
+  expr_ptr_t operator()(const infix_t &that) const {
+    expr_ptr_t lhs = fold(that.lhs), rhs = fold(that.rhs);
+    if (lhs->try_as<lit_t>() && rhs->try_as<lit_t>()) {
+      return eval_or_keep(infix_t(that.op, lhs, rhs));
+    }  // if
+    switch (that.op) {
+      case infix_t::add: {
+        if (is_int_lit(*rhs, 0) && is_int(get_kind(*lhs))) {
+          return lhs;
+        }  // if
+        if (is_int_lit(*lhs, 0) && is_int(get_kind(*rhs))) {
+          return rhs;
+        }  // if
+        if (auto result = reassociate(infix_t::add, lhs, rhs)) {
+          return result;
+        }  // if
+        break;
+      }
+      case infix_t::mul: {
+        /* A string times 1 is itself, too. */
+        if (is_int_lit(*rhs, 1) && get_kind(*lhs) != val_kind_t::any) {
+          return lhs;
+        }  // if
+        if (is_int_lit(*lhs, 1) && is_int(get_kind(*rhs))) {
+          return rhs;
+        }  // if
+        if (auto result = reassociate(infix_t::mul, lhs, rhs)) {
+          return result;
+        }  // if
+        break;
+      }
+      case infix_t::lt: {
+        break;
+      }
+      case infix_t::and_:
+      case infix_t::or_: {
+        /* 1 is and's identity and 0 is or's, for values already 0 or 1. */
+        int identity = (that.op == infix_t::and_) ? 1 : 0;
+        const auto *lit = lhs->try_as<lit_t>();
+        const int *val = lit ? lit->val->try_as<int>() : nullptr;
+        if (val && (*val != 0) == !identity) {
+          return make_lit(static_cast<int>(!identity));
+        }  // if
+        if (is_int_lit(*lhs, identity) &&
+            get_kind(*rhs) == val_kind_t::bool_) {
+          return rhs;
+        }  // if
+        if (is_int_lit(*rhs, identity) &&
+            get_kind(*lhs) == val_kind_t::bool_) {
+          return lhs;
+        }  // if
+        break;
+      }
+    }  // switch
+    return (lhs == that.lhs && rhs == that.rhs)
+        ? self : make(infix_t(that.op, lhs, rhs));
+  }
+
+  expr_ptr_t operator()(const ref_t &) const {
+    return self;
+  }
+
+  expr_ptr_t operator()(const apply_t &that) const {
+    expr_ptr_t fn = fold(that.fn);
+    bool changed = (fn != that.fn);
+    apply_t::args_t args;
+    args.reserve(that.args.size());
+    for (const auto &arg : that.args) {
+      args.push_back(fold(arg));
+      changed = changed || (args.back() != arg);
+    }  // for
+    return changed ? make(apply_t(fn, std::move(args))) : self;
+  }
+
+  /* Fold an expression. */
+  static expr_ptr_t fold(const expr_ptr_t &expr) {
+    assert(expr);
+    return apply(fold_t{ expr }, *expr);
+  }
+
+  /* A new expression. */
+  template <typename node_t>
+  static expr_ptr_t make(node_t &&node) {
+    return std::make_shared<expr_t>(std::forward<node_t>(node));
+  }
+
+  /* A new literal. */
+  static expr_ptr_t make_lit(val_t &&val) {
+    return make(lit_t(std::make_shared<val_t>(std::move(val))));
+  }
+
+  /* True iff. the expression is the given int literal. */
+  static bool is_int_lit(const expr_t &expr, int val) {
+    const auto *lit = expr.try_as<lit_t>();
+    const int *that = lit ? lit->val->try_as<int>() : nullptr;
+    return that && *that == val;
+  }
+
+  /* The literal the node evaluates to, its operands all being literals,
+     or, if evaluating it throws, the node. */
+  template <typename node_t>
+  static expr_ptr_t eval_or_keep(node_t &&node) {
+    static const scope_t empty;
+    expr_ptr_t expr = make(std::forward<node_t>(node));
+    try {
+      return make_lit(apply(eval_t{&empty}, *expr));
+    } catch (...) {
+      return expr;
+    }
+  }
+
+  /* If lhs is (x op a) and rhs is a literal b, where a and b are literals
+     both ints or, for add, both strings, then x op (a op b); otherwise
+     null.  Both add and mul, so restricted, are associative. */
+  static expr_ptr_t reassociate(
+      infix_t::op_t op, const expr_ptr_t &lhs, const expr_ptr_t &rhs) {
+    const auto *inner = lhs->try_as<infix_t>();
+    if (!inner || inner->op != op) {
+      return nullptr;
+    }  // if
+    const auto *a = inner->rhs->try_as<lit_t>();
+    const auto *b = rhs->try_as<lit_t>();
+    if (!a || !b) {
+      return nullptr;
+    }  // if
+    const int *a_int = a->val->try_as<int>(), *b_int = b->val->try_as<int>();
+    bool strs = a->val->try_as<std::string>() &&
+                b->val->try_as<std::string>();
+    if (op == infix_t::add ? !((a_int && b_int) || strs) : !(a_int && b_int)) {
+      return nullptr;
+    }  // if
+    /* Repeating a string a times and then b times is repeating it a * b
+       times only if neither is negative and the product fits. */
+    if (op == infix_t::mul && !is_int(get_kind(*inner->lhs)) &&
+        (*a_int < 0 || *b_int < 0 ||
+         static_cast<long long>(*a_int) * *b_int >
+             std::numeric_limits<int>::max())) {
+      return nullptr;
+    }  // if
+    return make(infix_t(op, inner->lhs,
+                        eval_or_keep(infix_t(op, inner->rhs, rhs))));
+  }
+
+  /* The expression we're folding. */
+  const expr_ptr_t &self;
+
+};  // fold_t
+
+/* Fold the expression. */
+inline expr_ptr_t fold(const expr_ptr_t &expr) {
+  return fold_t::fold(expr);
+}
+
+}  // calc
+}  // cppcon14
@@ -0,0 +1,168 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the folding in "fold.h".
+--------------------------------------------------------------------------- */
+
+#include "fold.h"
+
+#include <memory>
+#include <string>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::calc;
+
+/* What evaluating gets us: the type and value of the result, or the error
+   thrown. */
+static string get_outcome(const expr_ptr_t &expr, const scope_t &scope) {
+  try {
+    val_t val = apply(eval_t{&scope}, *expr);
+    if (const auto *that = val.try_as<int>()) {
+      return "int " + to_string(*that);
+    }
+    if (const auto *that = val.try_as<string>()) {
+      return "str " + *that;
+    }
+    if (val.try_as<lambda_t>()) {
+      return "lambda";
+    }
+    return "null";
+  } catch (const type_mismatch_error_t &) {
+    return "type mismatch";
+  } catch (const null_value_error_t &) {
+    return "null value";
+  } catch (const undef_ref_error_t &) {
+    return "undefined ref";
+  } catch (const exception &) {
+    return "other error";
+  }
+}
+
+/* The literal the expression folds to, as a string, or "" if it doesn't
+   fold to a literal. */
+static string fold_to_lit(const string &text) {
+  expr_ptr_t folded = fold(parse_expr(text));
+  const auto *lit = folded->try_as<lit_t>();
+  if (!lit) {
+    return "";
+  }
+  return apply(to_str_t(), *lit->val).as<string>();
+}
+
+static expr_ptr_t make_affix(affix_t::op_t op, const expr_ptr_t &arg) {
+  return make_shared<expr_t>(affix_t(op, arg));
+}
+
+FIXTURE(constants) {
+  EXPECT_EQ(fold_to_lit("\"a\" + \"b\" + \"c\""), "abc");
+  EXPECT_EQ(fold_to_lit("2 * 3 + 4"), "10");
+  EXPECT_EQ(fold_to_lit("1 < 2 and not 0"), "1");
+  EXPECT_EQ(fold_to_lit("\"ab\" * 3 < \"b\""), "1");
+  /* 2 * 3 * x is (2 * 3) * x, and x * 2 * 3 is reassociated. */
+  for (const char *text : { "2 * 3 * x", "x * 2 * 3" }) {
+    expr_ptr_t folded = fold(parse_expr(text));
+    const auto *mul = folded->try_as<infix_t>();
+    if (EXPECT_TRUE(mul && mul->op == infix_t::mul)) {
+      const auto &lit = mul->lhs->try_as<lit_t>() ? mul->lhs : mul->rhs;
+      if (EXPECT_TRUE(lit->try_as<lit_t>())) {
+        EXPECT_EQ(lit->as<lit_t>().val->as<int>(), 6);
+      }
+    }
+  }
+  /* Lambdas' bodies are folded too. */
+  expr_ptr_t lambda = fold(parse_expr("fn a, = 2 * 3 + a"));
+  if (EXPECT_TRUE(lambda->try_as<lit_t>())) {
+    const auto &def = lambda->as<lit_t>().val->as<lambda_t>().def;
+    if (EXPECT_TRUE(def->try_as<infix_t>())) {
+      EXPECT_TRUE(def->as<infix_t>().lhs->try_as<lit_t>());
+    }
+  }
+  /* Errors are left to happen when evaluated. */
+  EXPECT_EQ(fold_to_lit("1 + \"a\""), "");
+  EXPECT_EQ(fold_to_lit("(1 + \"a\") * 0"), "");
+}
+
+FIXTURE(identities) {
+  expr_ptr_t x = parse_expr("x + 1");
+  EXPECT_TRUE(fold(make_shared<expr_t>(infix_t(
+      infix_t::mul, x, parse_expr("1")))) == x);
+  EXPECT_TRUE(fold(make_shared<expr_t>(infix_t(
+      infix_t::add, parse_expr("0"), x))) == x);
+  expr_ptr_t b = parse_expr("x < y");
+  EXPECT_TRUE(fold(make_shared<expr_t>(infix_t(
+      infix_t::and_, parse_expr("1"), b))) == b);
+  EXPECT_TRUE(fold(make_shared<expr_t>(infix_t(
+      infix_t::or_, b, parse_expr("0")))) == b);
+  EXPECT_TRUE(fold(make_affix(affix_t::not_, make_affix(affix_t::not_, b)))
+              == b);
+  EXPECT_TRUE(fold(make_affix(affix_t::to_int, x)) == x);
+  /* And and or short-circuit, so x needn't be anything in particular. */
+  expr_ptr_t and_0 = fold(make_shared<expr_t>(infix_t(
+      infix_t::and_, parse_expr("0"), parse_expr("x"))));
+  EXPECT_TRUE(and_0->try_as<lit_t>() && and_0->as<lit_t>().val->as<int>() == 0);
+  expr_ptr_t or_5 = fold(make_shared<expr_t>(infix_t(
+      infix_t::or_, parse_expr("5"), parse_expr("x"))));
+  EXPECT_TRUE(or_5->try_as<lit_t>() && or_5->as<lit_t>().val->as<int>() == 1);
+  /* Not knowing what x is, x * 1 must stay, as x might be a lambda. */
+  expr_ptr_t unknown = parse_expr("x * 1");
+  EXPECT_TRUE(fold(unknown) == unknown);
+  /* Nor does not not x become x, which might be 5. */
+  expr_ptr_t not_not = make_affix(
+      affix_t::not_, make_affix(affix_t::not_, parse_expr("x")));
+  EXPECT_TRUE(fold(not_not) == not_not);
+  /* Unchanged expressions are shared. */
+  expr_ptr_t same = parse_expr("x < y and s + t");
+  EXPECT_TRUE(fold(same) == same);
+}
+
+FIXTURE(same_outcomes) {
+  /* Each expression, folded or not, in scopes where x is of each type. */
+  const char *texts[] = {
+    "x * 1", "(x + 0) * 1", "x + 0", "0 + x", "1 * x", "x * 2 * 3",
+    "x * -1 * -1", "x + \"a\" + \"b\"", "x + 1 + 2", "(x < 3) and 1",
+    "0 or (x < 3)", "not not x", "1 + \"a\" + x", "x * 0 * 5",
+    "(x * 1) + (1 * x)", "\"abc\" * 2 * 3", "(fn a, = a * 1 + 0) + x",
+    "5 or x + 1", "2 * 0 or x", "1 or x"
+  };
+  scope_t scope;
+  for (const char *text : texts) {
+    expr_ptr_t expr = parse_expr(text);
+    expr_ptr_t folded = fold(expr);
+    for (int i = 0; i < 4; ++i) {
+      scope_t inner(&scope);
+      switch (i) {
+        case 0: {
+          inner.def("x", 5);
+          break;
+        }
+        case 1: {
+          inner.def("x", string("ab"));
+          break;
+        }
+        case 2: {
+          inner.def("x", val_t());
+          break;
+        }
+        case 3: {
+          inner.def("x", lambda_t({}, parse_expr("1")));
+          break;
+        }
+      }
+      EXPECT_EQ(get_outcome(folded, inner), get_outcome(expr, inner));
+    }
+  }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// ---------------------------------------------------------------------------
+// "horse.h"
+//
+// Both an animal and a means of transport, so it lives on its own, and both
+// animal.h and transport.h include it.
+
+struct horse_t {
+  // stuff about neighing, running fast, and carrying people and cargo
+};
+// ---------------------------------------------------------------------------
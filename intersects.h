@@ -1,17 +1,86 @@
 #pragma once
 
+#include <algorithm>
+
 #include "shapes4.h"
 
+// ---------------------------------------------------------------------------
+// The pairwise tests, as a broad phase would do them: exact for circles and
+// (axis-aligned) squares, and by bounding box for triangles.
+
+struct box_t final {
+  pnt_t lo, hi;
+};
+
+inline box_t get_box(const circle_t &that) {
+  return { { that.ctr.x - that.radius, that.ctr.y - that.radius },
+           { that.ctr.x + that.radius, that.ctr.y + that.radius } };
+}
+
+inline box_t get_box(const square_t &that) {
+  double half = that.size / 2;
+  return { { that.ctr.x - half, that.ctr.y - half },
+           { that.ctr.x + half, that.ctr.y + half } };
+}
+
+inline box_t get_box(const triangle_t &that) {
+  box_t box = { that.pnts[0], that.pnts[0] };
+  for (const pnt_t &pnt : that.pnts) {
+    box.lo.x = std::min(box.lo.x, pnt.x);
+    box.lo.y = std::min(box.lo.y, pnt.y);
+    box.hi.x = std::max(box.hi.x, pnt.x);
+    box.hi.y = std::max(box.hi.y, pnt.y);
+  }  // for
+  return box;
+}
+
+inline bool overlaps(const box_t &lhs, const box_t &rhs) {
+  return lhs.lo.x <= rhs.hi.x && rhs.lo.x <= lhs.hi.x &&
+         lhs.lo.y <= rhs.hi.y && rhs.lo.y <= lhs.hi.y;
+}
+
+inline bool overlaps(const circle_t &lhs, const circle_t &rhs) {
+  double dx = lhs.ctr.x - rhs.ctr.x, dy = lhs.ctr.y - rhs.ctr.y,
+         reach = lhs.radius + rhs.radius;
+  return dx * dx + dy * dy <= reach * reach;
+}
+
+/* The point in the box nearest the circle's center is within the radius. */
+inline bool overlaps(const circle_t &lhs, const box_t &rhs) {
+  double dx = lhs.ctr.x - std::min(std::max(lhs.ctr.x, rhs.lo.x), rhs.hi.x),
+         dy = lhs.ctr.y - std::min(std::max(lhs.ctr.y, rhs.lo.y), rhs.hi.y);
+  return dx * dx + dy * dy <= lhs.radius * lhs.radius;
+}
+// ---------------------------------------------------------------------------
+
 bool intersects(const shape_t &lhs, const shape_t &rhs) {
   return cppcon14::variant::match<bool>(
              lhs, rhs,
-             [](const circle_t   &, const circle_t   &) { /* ... */ },
-             [](const circle_t   &, const square_t   &) { /* ... */ },
-             [](const circle_t   &, const triangle_t &) { /* ... */ },
-             [](const square_t   &, const circle_t   &) { /* ... */ },
-             [](const square_t   &, const square_t   &) { /* ... */ },
-             [](const square_t   &, const triangle_t &) { /* ... */ },
-             [](const triangle_t &, const circle_t   &) { /* ... */ },
-             [](const triangle_t &, const square_t   &) { /* ... */ },
-             [](const triangle_t &, const triangle_t &) { /* ... */ });
+             [](const circle_t   &a, const circle_t   &b) {
+               return overlaps(a, b);
+             },
+             [](const circle_t   &a, const square_t   &b) {
+               return overlaps(a, get_box(b));
+             },
+             [](const circle_t   &a, const triangle_t &b) {
+               return overlaps(a, get_box(b));
+             },
+             [](const square_t   &a, const circle_t   &b) {
+               return overlaps(b, get_box(a));
+             },
+             [](const square_t   &a, const square_t   &b) {
+               return overlaps(get_box(a), get_box(b));
+             },
+             [](const square_t   &a, const triangle_t &b) {
+               return overlaps(get_box(a), get_box(b));
+             },
+             [](const triangle_t &a, const circle_t   &b) {
+               return overlaps(b, get_box(a));
+             },
+             [](const triangle_t &a, const square_t   &b) {
+               return overlaps(get_box(a), get_box(b));
+             },
+             [](const triangle_t &a, const triangle_t &b) {
+               return overlaps(get_box(a), get_box(b));
+             });
 }
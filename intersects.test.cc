@@ -7,5 +7,13 @@ FIXTURE(intersects) {
   shape_t lhs = circle_t{{0, 0}, 101};
   shape_t rhs = square_t{{0, 0}, 202};
   EXPECT_TRUE(intersects(lhs, rhs));
+  /* Their bounding boxes overlap, but the circle misses the corner. */
+  rhs = square_t{{140, 140}, 100};
+  EXPECT_FALSE(intersects(lhs, rhs));
+  EXPECT_FALSE(intersects(rhs, lhs));
+  rhs = triangle_t{{{300, 0}, {400, 0}, {350, 50}}};
+  EXPECT_FALSE(intersects(lhs, rhs));
+  lhs = triangle_t{{{250, 0}, {350, 100}, {250, 100}}};
+  EXPECT_TRUE(intersects(lhs, rhs));
 }
 
@@ -0,0 +1,318 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The lifecycle benchmark.  speed.test times dispatch, but our workloads spend
+at least as much time making, copying and killing variants: vectors grow,
+values are copied into scopes, and AST nodes are built and torn down.  Here
+we time each of those operations on our variant_t, std::variant and
+boost::variant, each holding one of two alternatives or null:
+
+  construct     Converting construction, copying an alternative.
+  copy          Copy construction.
+  move          Move construction.
+  assign-same   Copy assignment of a variant holding the same alternative.
+  assign-cross  Copy assignment of a variant holding the other alternative.
+  reset         Becoming null.  For std::variant, this is assigning
+                std::monostate; for boost::variant, boost::blank.
+  destroy       Destruction.
+  grow          Pushing copies onto a vector which starts empty, so the
+                vector reallocates and relocates as it grows.
+  erase         Erasing the front half of a vector, so the back half moves
+                down.
+
+The alternatives are either trivial (an int and a double) or not (a string
+too long to keep inline and a vector of ints).  With the times, we report
+the calls to the global operator new per element, from one untimed run of
+each operation.
+
+Usage: lifecycle.bench [flags]
+  --sizes=1000,100000  The numbers of variants to try.
+  --libs=all           Any of cppcon14, std and boost.
+  --payloads=all       Either or both of trivial and nontrivial.
+  --ops=all            Any of the operations above.
+  --warmup, --trials, --min-elems, --counters and --json, as in speed.test.
+--------------------------------------------------------------------------- */
+
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/variant.hpp>
+
+#if __cplusplus >= 201703L
+#include <variant>
+#endif
+
+#include "alloc_count.h"
+#include "bench.h"
+#include "variant.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* ---------------------------------------------------------------------------
+The libraries and the alternatives.
+--------------------------------------------------------------------------- */
+
+/* Our variant_t. */
+struct cppcon14_lib_t final {
+
+  template <typename a_t, typename b_t>
+  using var_t = variant_t<a_t, b_t, null_t>;
+
+  static const char *get_name() { return "cppcon14"; }
+
+  template <typename var_t>
+  static void reset(var_t &var) { var.reset(); }
+
+};  // cppcon14_lib_t
+
+#if __cplusplus >= 201703L
+/* std::variant, with std::monostate for null. */
+struct std_lib_t final {
+
+  template <typename a_t, typename b_t>
+  using var_t = std::variant<std::monostate, a_t, b_t>;
+
+  static const char *get_name() { return "std"; }
+
+  template <typename var_t>
+  static void reset(var_t &var) { var = std::monostate(); }
+
+};  // std_lib_t
+#endif
+
+/* boost::variant, with boost::blank for null. */
+struct boost_lib_t final {
+
+  template <typename a_t, typename b_t>
+  using var_t = boost::variant<boost::blank, a_t, b_t>;
+
+  static const char *get_name() { return "boost"; }
+
+  template <typename var_t>
+  static void reset(var_t &var) { var = boost::blank(); }
+
+};  // boost_lib_t
+
+/* Alternatives which are trivial to copy and destroy. */
+struct trivial_t final {
+
+  using a_t = int;
+
+  using b_t = double;
+
+  static const char *get_name() { return "trivial"; }
+
+  static a_t make_a(size_t i) { return static_cast<int>(i); }
+
+  static b_t make_b(size_t i) { return static_cast<double>(i) / 2; }
+
+};  // trivial_t
+
+/* Alternatives which own memory on the heap. */
+struct nontrivial_t final {
+
+  using a_t = string;
+
+  using b_t = vector<int>;
+
+  static const char *get_name() { return "nontrivial"; }
+
+  static a_t make_a(size_t) {
+    return "the quick brown fox jumps over the lazy dog";
+  }
+
+  static b_t make_b(size_t i) { return b_t(4, static_cast<int>(i)); }
+
+};  // nontrivial_t
+
+/* ---------------------------------------------------------------------------
+The driver.
+--------------------------------------------------------------------------- */
+
+/* Room for n variants, constructed and destroyed all together. */
+template <typename var_t>
+class slots_t final {
+  public:
+
+  /* No copying or moving. */
+  slots_t(const slots_t &) = delete;
+  slots_t &operator=(const slots_t &) = delete;
+
+  /* Room for n, all empty. */
+  explicit slots_t(size_t n) : n(n), storage(new storage_t[n]) {}
+
+  /* Destroy any we hold. */
+  ~slots_t() { clear(); }
+
+  /* Construct each variant from fn(i).  We must be empty. */
+  template <typename fn_t>
+  void construct_all(fn_t &&fn) {
+    assert(this);
+    assert(!full);
+    for (size_t i = 0; i < n; ++i) {
+      new (&storage[i]) var_t(fn(i));
+    }  // for
+    full = true;
+  }
+
+  /* Destroy the variants, if we hold any. */
+  void clear() {
+    assert(this);
+    if (full) {
+      for (size_t i = 0; i < n; ++i) {
+        (*this)[i].~var_t();
+      }  // for
+      full = false;
+    }  // if
+  }
+
+  /* The variant in the ith slot, which must be constructed. */
+  var_t &operator[](size_t i) {
+    assert(this);
+    assert(full);
+    return reinterpret_cast<var_t &>(storage[i]);
+  }
+
+  private:
+
+  /* Room for one variant. */
+  using storage_t = aligned_storage_t<sizeof(var_t), alignof(var_t)>;
+
+  /* The number of slots. */
+  size_t n;
+
+  /* The slots. */
+  unique_ptr<storage_t[]> storage;
+
+  /* True if all the slots are constructed, false if none are. */
+  bool full = false;
+
+};  // slots_t<var_t>
+
+/* Time every operation on n variants of the given library, holding the
+   given alternatives. */
+template <typename lib_t, typename payload_t>
+static void run_all(const flags_t &flags, size_t n, counters_t &counters,
+                    report_t &report) {
+  if (!flags.selects("libs", lib_t::get_name()) ||
+      !flags.selects("payloads", payload_t::get_name())) {
+    return;
+  }  // if
+  using a_t = typename payload_t::a_t;
+  using b_t = typename payload_t::b_t;
+  using var_t = typename lib_t::template var_t<a_t, b_t>;
+  /* The alternatives to convert from, variants holding only one or the
+     other, and variants holding both, alternately. */
+  vector<a_t> as;
+  vector<var_t> var_as, var_bs, mixed;
+  for (size_t i = 0; i < n; ++i) {
+    as.push_back(payload_t::make_a(i));
+    var_as.push_back(var_t(payload_t::make_a(i)));
+    var_bs.push_back(var_t(payload_t::make_b(i)));
+    mixed.push_back((i % 2) ? var_bs.back() : var_as.back());
+  }  // for
+  /* Donors for moves, refilled from mixed before every run. */
+  vector<var_t> donors = mixed;
+  slots_t<var_t> slots(n);
+  vector<var_t> vec;
+  /* Count the allocations of one run, then time it. */
+  trial_opts_t opts = trial_opts_t::from(flags);
+  auto run = [&](const char *op, auto &&prep, auto &&fn) {
+    if (!flags.selects("ops", op)) {
+      return;
+    }  // if
+    prep();
+    size_t start = alloc_count;
+    fn();
+    double allocs = static_cast<double>(alloc_count - start) / n;
+    stats_t stats = run_prepped_trials(n, opts, prep, fn, &counters);
+    vector<count_t> counts = counters.get_counts();
+    counts.push_back({ "allocs", allocs });
+    report.add({ string(lib_t::get_name()) + ' ' + payload_t::get_name() +
+                     ' ' + op, n, stats, move(counts) });
+  };
+  auto clear = [&] { slots.clear(); };
+  auto fill_as = [&] {
+    slots.clear();
+    slots.construct_all([&](size_t i) -> const var_t & { return var_as[i]; });
+  };
+  auto fill_mixed = [&] {
+    slots.clear();
+    slots.construct_all([&](size_t i) -> const var_t & { return mixed[i]; });
+  };
+  run("construct", clear, [&] {
+    slots.construct_all([&](size_t i) -> const a_t & { return as[i]; });
+  });
+  run("copy", clear, [&] {
+    slots.construct_all([&](size_t i) -> const var_t & { return mixed[i]; });
+  });
+  run("move", [&] { clear(); donors = mixed; }, [&] {
+    slots.construct_all([&](size_t i) -> var_t && {
+      return std::move(donors[i]);
+    });
+  });
+  run("assign-same", fill_as, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      slots[i] = var_as[i];
+    }  // for
+  });
+  run("assign-cross", fill_as, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      slots[i] = var_bs[i];
+    }  // for
+  });
+  run("reset", fill_mixed, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      lib_t::reset(slots[i]);
+    }  // for
+  });
+  run("destroy", fill_mixed, clear);
+  run("grow", [&] { vector<var_t>().swap(vec); }, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      vec.push_back(mixed[i]);
+    }  // for
+  });
+  run("erase", [&] { vec.assign(mixed.begin(), mixed.end()); }, [&] {
+    vec.erase(vec.begin(), vec.begin() + n / 2);
+  });
+}
+
+/* Time every library with the given alternatives. */
+template <typename payload_t>
+static void run_libs(const flags_t &flags, size_t n, counters_t &counters,
+                     report_t &report) {
+  run_all<cppcon14_lib_t, payload_t>(flags, n, counters, report);
+#if __cplusplus >= 201703L
+  run_all<std_lib_t, payload_t>(flags, n, counters, report);
+#endif
+  run_all<boost_lib_t, payload_t>(flags, n, counters, report);
+}
+
+int main(int argc, char *argv[]) {
+  flags_t flags(argc, argv);
+  counters_t counters(flags, cerr);
+  report_t report(cout, flags);
+  for (size_t n : flags.get_counts("sizes", "1000,100000")) {
+    run_libs<trivial_t>(flags, n, counters, report);
+    run_libs<nontrivial_t>(flags, n, counters, report);
+  }  // for
+  return 0;
+}
@@ -0,0 +1,147 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Serve a stream of requests, each of which builds and evaluates a few
+thousand values like those of the calculator (ints, strings, and lambdas with
+vectors of parameter names), all of which die when the request is done.  We
+compare drawing their memory from the global heap, with std::allocator and
+with a polymorphic allocator, against drawing it from a monotonic resource
+which is released at the end of each request.
+
+Usage: memory_resource.bench [n [values per request]]
+--------------------------------------------------------------------------- */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "memory_resource.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* The types of value for a given allocator. */
+template <typename alloc_t>
+struct types_t final {
+
+  template <typename T>
+  using rebind_t = typename allocator_traits<alloc_t>::template rebind_alloc<T>;
+
+  using string_t = basic_string<char, char_traits<char>, rebind_t<char>>;
+
+  using params_t = vector<string_t, rebind_t<string_t>>;
+
+  using val_t = variant_t<int, string_t, params_t, null_t>;
+
+  using vals_t = vector<val_t, rebind_t<val_t>>;
+
+};  // types_t<alloc_t>
+
+/* Long enough that a string can't keep it inline. */
+static const char *const long_str = "the quick brown fox jumps over the dog";
+
+/* Serve one request, building the given number of values, then evaluating
+   each into a new value, and return a checksum. */
+template <typename alloc_t>
+static size_t serve(const alloc_t &alloc, size_t size) {
+  using types = types_t<alloc_t>;
+  using string_t = typename types::string_t;
+  using params_t = typename types::params_t;
+  using val_t = typename types::val_t;
+  typename types::vals_t vals(alloc), results(alloc);
+  vals.reserve(size);
+  results.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    switch (i % 4) {
+      case 0: {
+        vals.emplace_back(static_cast<int>(i));
+        break;
+      }
+      case 1: {
+        vals.emplace_back(string_t(long_str, alloc));
+        break;
+      }
+      case 2: {
+        params_t params(alloc);
+        params.emplace_back(long_str);
+        params.emplace_back(long_str);
+        vals.emplace_back(move(params));
+        break;
+      }
+      default: {
+        vals.emplace_back();
+        break;
+      }
+    }  // switch
+  }  // for
+  size_t total = 0;
+  for (const auto &val : vals) {
+    /* Evaluating builds a new value, starting with a copy of the old one.
+       A container of polymorphic allocators hands its own to the copy, and
+       so to the copy's contents. */
+    results.emplace_back(val);
+    val_t &result = results.back();
+    if (string_t *str = result.template try_as<string_t>()) {
+      str->append(long_str);
+      total += str->size();
+    } else if (params_t *params = result.template try_as<params_t>()) {
+      params->emplace_back(long_str);
+      total += params->size();
+    } else if (const int *num = result.template try_as<int>()) {
+      result.template emplace<string_t>(
+          allocator_arg, alloc, to_string(*num).c_str());
+      total += 1;
+    }  // if
+  }  // for
+  return total;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 10000000);
+  size_t size = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 4000;
+  size_t requests = (n + size - 1) / size;
+  n = requests * size;
+  size_t total = 0;
+  measure(cout, "std::allocator", n, [&] {
+    for (size_t i = 0; i < requests; ++i) {
+      total += serve(allocator<char>(), size);
+    }  // for
+  });
+  measure(cout, "polymorphic, heap", n, [&] {
+    for (size_t i = 0; i < requests; ++i) {
+      total += serve(lib::pmr::polymorphic_allocator<char>(), size);
+    }  // for
+  });
+  measure(cout, "polymorphic, monotonic", n, [&] {
+    for (size_t i = 0; i < requests; ++i) {
+      lib::pmr::monotonic_buffer_resource resource;
+      total += serve(lib::pmr::polymorphic_allocator<char>(&resource), size);
+    }  // for
+  });
+  /* The same, but reusing one buffer for the first chunk of every request,
+     so a typical request never goes to the heap at all. */
+  vector<char> buffer(size * 512);
+  measure(cout, "polymorphic, monotonic+buffer", n, [&] {
+    for (size_t i = 0; i < requests; ++i) {
+      lib::pmr::monotonic_buffer_resource resource(buffer.data(),
+                                                   buffer.size());
+      total += serve(lib::pmr::polymorphic_allocator<char>(&resource), size);
+    }  // for
+  });
+  keep(total);
+  return 0;
+}
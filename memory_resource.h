@@ -0,0 +1,348 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The parts of C++17 <memory_resource> we need, for as long as we build as
+C++14.  The names and behavior follow the standard, so moving to std::pmr
+later is a matter of changing the namespace.
+
+  memory_resource
+      The abstract source of memory.
+  new_delete_resource()
+      A memory_resource which uses the global heap.
+  monotonic_buffer_resource
+      A memory_resource which hands out memory by bumping a pointer, never
+      frees anything on its own, and releases everything at once when it is
+      destroyed.  Ideal for values which all die together, such as those
+      built while serving one request.
+  polymorphic_allocator<T>
+      An allocator which draws from a memory_resource, and which passes
+      itself along to the objects it constructs if they use allocators.
+
+A variant_t takes part in this too: see the allocator-extended constructors
+and emplace() in "variant.h".
+
+See "memory_resource.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "variant.h"
+
+namespace lib {
+namespace pmr {
+
+/* C++17 std::pmr::memory_resource. */
+class memory_resource {
+  public:
+
+  virtual ~memory_resource() {}
+
+  void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+    assert(this);
+    return do_allocate(bytes, alignment);
+  }
+
+  void deallocate(void *ptr, size_t bytes,
+                  size_t alignment = alignof(std::max_align_t)) {
+    assert(this);
+    do_deallocate(ptr, bytes, alignment);
+  }
+
+  bool is_equal(const memory_resource &that) const noexcept {
+    assert(this);
+    return do_is_equal(that);
+  }
+
+  private:
+
+  virtual void *do_allocate(size_t bytes, size_t alignment) = 0;
+
+  virtual void do_deallocate(void *ptr, size_t bytes, size_t alignment) = 0;
+
+  virtual bool do_is_equal(const memory_resource &that) const noexcept = 0;
+
+};  // memory_resource
+
+inline bool operator==(const memory_resource &lhs,
+                       const memory_resource &rhs) noexcept {
+  return &lhs == &rhs || lhs.is_equal(rhs);
+}
+
+inline bool operator!=(const memory_resource &lhs,
+                       const memory_resource &rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+/* C++17 std::pmr::new_delete_resource().  We don't support alignments
+   beyond that of max_align_t here, as C++14 has no aligned operator new. */
+inline memory_resource *new_delete_resource() noexcept {
+  class new_delete_resource_t final : public memory_resource {
+    void *do_allocate(size_t bytes, size_t alignment) override {
+      assert(alignment <= alignof(std::max_align_t));
+      (void)alignment;
+      return ::operator new(bytes);
+    }
+    void do_deallocate(void *ptr, size_t, size_t) override {
+      ::operator delete(ptr);
+    }
+    bool do_is_equal(const memory_resource &that) const noexcept override {
+      return this == &that;
+    }
+  };
+  static new_delete_resource_t resource;
+  return &resource;
+}
+
+/* C++17 std::pmr::monotonic_buffer_resource. */
+class monotonic_buffer_resource final : public memory_resource {
+  public:
+
+  /* No copying or moving. */
+  monotonic_buffer_resource(const monotonic_buffer_resource &) = delete;
+  monotonic_buffer_resource &operator=(
+      const monotonic_buffer_resource &) = delete;
+
+  /* Draw chunks from upstream as we need them. */
+  explicit monotonic_buffer_resource(
+      memory_resource *upstream = new_delete_resource()) noexcept
+      : upstream(upstream) {}
+
+  /* As above, but the first chunk will be of at least the given size. */
+  explicit monotonic_buffer_resource(
+      size_t initial_size,
+      memory_resource *upstream = new_delete_resource()) noexcept
+      : upstream(upstream),
+        initial_next_size(initial_size > min_chunk_size ? initial_size
+                                                        : min_chunk_size),
+        next_size(initial_next_size) {}
+
+  /* Use the given buffer first, and only draw from upstream once it's
+     used up.  The buffer must outlive us. */
+  monotonic_buffer_resource(
+      void *buffer, size_t buffer_size,
+      memory_resource *upstream = new_delete_resource()) noexcept
+      : upstream(upstream),
+        initial_buffer(static_cast<char *>(buffer)),
+        initial_limit(static_cast<char *>(buffer) + buffer_size),
+        cursor(initial_buffer),
+        limit(initial_limit),
+        initial_next_size(buffer_size > min_chunk_size ? buffer_size * 2
+                                                       : min_chunk_size),
+        next_size(initial_next_size) {}
+
+  /* Release all our chunks. */
+  ~monotonic_buffer_resource() override {
+    release();
+  }
+
+  /* Return all our chunks upstream, at once, even if the memory we handed
+     out from them is still in use, and start over as if newly constructed:
+     from the initial buffer, if we were given one, and with chunks of the
+     initial size. */
+  void release() noexcept {
+    assert(this);
+    while (chunks) {
+      chunk_t *chunk = chunks;
+      chunks = chunk->next;
+      upstream->deallocate(chunk, chunk->size, alignof(chunk_t));
+    }  // while
+    cursor = initial_buffer;
+    limit = initial_limit;
+    next_size = initial_next_size;
+  }
+
+  /* Where we get our chunks. */
+  memory_resource *upstream_resource() const noexcept {
+    assert(this);
+    return upstream;
+  }
+
+  private:
+
+  /* The header at the start of each chunk, linking them together so we can
+     release them. */
+  struct alignas(std::max_align_t) chunk_t final {
+    chunk_t *next;
+    size_t size;
+  };
+
+  /* The smallest chunk we will ask for. */
+  static constexpr size_t min_chunk_size = 1024;
+
+  /* Bump our cursor, getting a new chunk if the current one is too full. */
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    void *ptr = align(bytes, alignment);
+    if (!ptr) {
+      grow(bytes + alignment);
+      ptr = align(bytes, alignment);
+      assert(ptr);
+    }  // if
+    cursor = static_cast<char *>(ptr) + bytes;
+    return ptr;
+  }
+
+  /* A no-op; we release memory only all at once. */
+  void do_deallocate(void *, size_t, size_t) override {}
+
+  bool do_is_equal(const memory_resource &that) const noexcept override {
+    return this == &that;
+  }
+
+  /* The next aligned address in the current chunk, if it has room for the
+     given number of bytes, or else a null pointer. */
+  void *align(size_t bytes, size_t alignment) noexcept {
+    if (!cursor) {
+      return nullptr;
+    }  // if
+    void *ptr = cursor;
+    size_t space = static_cast<size_t>(limit - cursor);
+    return std::align(alignment, bytes, ptr, space);
+  }
+
+  /* Get a new chunk, with room for at least the given number of bytes.
+     Chunks grow geometrically, so we go upstream O(log n) times. */
+  void grow(size_t bytes) {
+    size_t size = next_size;
+    while (size - sizeof(chunk_t) < bytes) {
+      size *= 2;
+    }  // while
+    chunk_t *chunk = static_cast<chunk_t *>(
+        upstream->allocate(size, alignof(chunk_t)));
+    chunk->next = chunks;
+    chunk->size = size;
+    chunks = chunk;
+    cursor = reinterpret_cast<char *>(chunk + 1);
+    limit = reinterpret_cast<char *>(chunk) + size;
+    next_size = size * 2;
+  }
+
+  /* Where we get our chunks. */
+  memory_resource *upstream;
+
+  /* The chunks we've gotten from upstream, most recent first. */
+  chunk_t *chunks = nullptr;
+
+  /* The buffer we were constructed with, if any, to which release()
+     returns. */
+  char *const initial_buffer = nullptr, *const initial_limit = nullptr;
+
+  /* The free space in the current chunk (or initial buffer). */
+  char *cursor = nullptr, *limit = nullptr;
+
+  /* The size of the first chunk we'll ask for, after construction or
+     release(). */
+  const size_t initial_next_size = min_chunk_size;
+
+  /* The size of the chunk we'll ask for next. */
+  size_t next_size = min_chunk_size;
+
+};  // monotonic_buffer_resource
+
+/* C++17 std::pmr::polymorphic_allocator. */
+template <typename T>
+class polymorphic_allocator {
+  public:
+
+  using value_type = T;
+
+  /* Draw from the global heap. */
+  polymorphic_allocator() noexcept : source(new_delete_resource()) {}
+
+  /* Draw from the given resource. */
+  polymorphic_allocator(memory_resource *source) noexcept : source(source) {
+    assert(source);
+  }
+
+  /* Draw from the same resource as another allocator. */
+  template <typename U>
+  polymorphic_allocator(const polymorphic_allocator<U> &that) noexcept
+      : source(that.resource()) {}
+
+  polymorphic_allocator &operator=(const polymorphic_allocator &) = delete;
+
+  T *allocate(size_t n) {
+    assert(this);
+    return static_cast<T *>(source->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    assert(this);
+    source->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  /* Construct a U at ptr from args, handing it ourselves too if it uses
+     allocators.  This is what carries a resource from a container into its
+     elements, and from there into their elements, and so on. */
+  template <typename U, typename... args_t>
+  void construct(U *ptr, args_t &&... args) {
+    assert(this);
+    uninitialized_construct_using_allocator(
+        ptr, *this, std::forward<args_t>(args)...);
+  }
+
+  template <typename U>
+  void destroy(U *ptr) {
+    ptr->~U();
+  }
+
+  /* A copied container uses the heap, not our resource, unless it's given
+     an allocator explicitly. */
+  polymorphic_allocator select_on_container_copy_construction() const {
+    return polymorphic_allocator();
+  }
+
+  memory_resource *resource() const noexcept {
+    assert(this);
+    return source;
+  }
+
+  private:
+
+  /* Where we draw memory from.  Never null. */
+  memory_resource *const source;
+
+};  // polymorphic_allocator<T>
+
+template <typename T, typename U>
+bool operator==(const polymorphic_allocator<T> &lhs,
+                const polymorphic_allocator<U> &rhs) noexcept {
+  return *lhs.resource() == *rhs.resource();
+}
+
+template <typename T, typename U>
+bool operator!=(const polymorphic_allocator<T> &lhs,
+                const polymorphic_allocator<U> &rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+/* C++17 std::pmr::string. */
+using string = std::basic_string<char, std::char_traits<char>,
+                                 polymorphic_allocator<char>>;
+
+/* C++17 std::pmr::vector. */
+template <typename T>
+using vector = std::vector<T, polymorphic_allocator<T>>;
+
+}  // pmr
+}  // lib
@@ -0,0 +1,198 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the memory resources, and of variants which
+hand allocators to their contents.
+--------------------------------------------------------------------------- */
+
+#include "memory_resource.h"
+
+#include <cstdint>
+#include <type_traits>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+using namespace lib::pmr;
+
+/* Draws from the heap, counting what it hands out. */
+class counting_resource_t final : public memory_resource {
+  public:
+
+  size_t allocs = 0, deallocs = 0, live_bytes = 0;
+
+  private:
+
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    ++allocs;
+    live_bytes += bytes;
+    return new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *ptr, size_t bytes, size_t alignment) override {
+    ++deallocs;
+    live_bytes -= bytes;
+    new_delete_resource()->deallocate(ptr, bytes, alignment);
+  }
+
+  bool do_is_equal(const memory_resource &that) const noexcept override {
+    return this == &that;
+  }
+
+};  // counting_resource_t
+
+/* Long enough that a string can't keep it inline. */
+static const char *const long_str = "a string too long for the small buffer";
+
+/* A value like those of the calculator. */
+using val_t = variant_t<int, lib::pmr::string, null_t>;
+
+/* True iff. the pointer lies within the buffer. */
+static bool is_within(const void *ptr, const char *buffer, size_t size) {
+  auto addr = reinterpret_cast<uintptr_t>(ptr),
+       begin = reinterpret_cast<uintptr_t>(buffer);
+  return begin <= addr && addr < begin + size;
+}
+
+FIXTURE(monotonic_aligned) {
+  monotonic_buffer_resource resource;
+  void *a = resource.allocate(1, 1);
+  void *b = resource.allocate(8, 8);
+  void *c = resource.allocate(3, 16);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 8, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(c) % 16, 0u);
+}
+
+FIXTURE(monotonic_buffer_first) {
+  counting_resource_t upstream;
+  alignas(16) char buffer[256];
+  {
+    monotonic_buffer_resource resource(buffer, sizeof(buffer), &upstream);
+    EXPECT_TRUE(is_within(resource.allocate(100), buffer, sizeof(buffer)));
+    EXPECT_EQ(upstream.allocs, 0u);
+    EXPECT_FALSE(is_within(resource.allocate(200), buffer, sizeof(buffer)));
+    EXPECT_EQ(upstream.allocs, 1u);
+  }
+  EXPECT_EQ(upstream.deallocs, 1u);
+}
+
+FIXTURE(monotonic_release) {
+  counting_resource_t upstream;
+  monotonic_buffer_resource resource(&upstream);
+  for (int i = 0; i < 1000; ++i) {
+    resource.allocate(100);
+  }  // for
+  /* Chunks grow geometrically, so 100,000 bytes take only a few. */
+  EXPECT_GT(upstream.allocs, 1u);
+  EXPECT_LT(upstream.allocs, 10u);
+  resource.release();
+  EXPECT_EQ(upstream.deallocs, upstream.allocs);
+  EXPECT_EQ(upstream.live_bytes, 0u);
+}
+
+FIXTURE(monotonic_release_reuses_buffer) {
+  counting_resource_t upstream;
+  alignas(16) char buffer[256];
+  monotonic_buffer_resource resource(buffer, sizeof(buffer), &upstream);
+  /* The buffer comes first, then a chunk of the initial size, then bigger
+     ones; and, after release(), the same all over again. */
+  size_t first_chunk_sizes[2];
+  for (size_t &first_chunk_size : first_chunk_sizes) {
+    upstream.allocs = 0;
+    EXPECT_TRUE(is_within(resource.allocate(200), buffer, sizeof(buffer)));
+    EXPECT_EQ(upstream.allocs, 0u);
+    EXPECT_FALSE(is_within(resource.allocate(200), buffer, sizeof(buffer)));
+    EXPECT_EQ(upstream.allocs, 1u);
+    first_chunk_size = upstream.live_bytes;
+    for (int i = 0; i < 100; ++i) {
+      resource.allocate(200);
+    }  // for
+    EXPECT_GT(upstream.live_bytes, first_chunk_size * 2);
+    resource.release();
+    EXPECT_EQ(upstream.live_bytes, 0u);
+  }  // for
+  EXPECT_EQ(first_chunk_sizes[1], first_chunk_sizes[0]);
+}
+
+FIXTURE(variant_uses_allocator) {
+  EXPECT_TRUE((uses_allocator<val_t, polymorphic_allocator<char>>::value));
+  EXPECT_FALSE((uses_allocator<variant_t<int, null_t>,
+                               polymorphic_allocator<char>>::value));
+}
+
+FIXTURE(variant_construct_with_allocator) {
+  counting_resource_t resource;
+  polymorphic_allocator<char> alloc(&resource);
+  val_t a(allocator_arg, alloc, lib::pmr::string(long_str));
+  EXPECT_EQ(a.as<lib::pmr::string>(), long_str);
+  EXPECT_TRUE(a.as<lib::pmr::string>().get_allocator() == alloc);
+  val_t b(allocator_arg, alloc, 101);
+  EXPECT_EQ(b.as<int>(), 101);
+  val_t c(allocator_arg, alloc);
+  EXPECT_FALSE(c);
+}
+
+FIXTURE(variant_copy_with_allocator) {
+  counting_resource_t resource;
+  polymorphic_allocator<char> alloc(&resource);
+  val_t a = lib::pmr::string(long_str);
+  /* A plain copy goes to the heap... */
+  val_t b = a;
+  EXPECT_EQ(resource.allocs, 0u);
+  /* ...but an allocator-extended one goes where it's told. */
+  val_t c(allocator_arg, alloc, a);
+  EXPECT_EQ(resource.allocs, 1u);
+  EXPECT_EQ(c.as<lib::pmr::string>(), long_str);
+  EXPECT_TRUE(c.as<lib::pmr::string>().get_allocator() == alloc);
+  /* Moving into a different resource must copy, and leaves the donor
+     null. */
+  val_t d(allocator_arg, alloc, move(b));
+  EXPECT_EQ(resource.allocs, 2u);
+  EXPECT_EQ(d.as<lib::pmr::string>(), long_str);
+  EXPECT_FALSE(b);
+}
+
+FIXTURE(variant_emplace_with_allocator) {
+  counting_resource_t resource;
+  polymorphic_allocator<char> alloc(&resource);
+  val_t a = 101;
+  auto &str = a.emplace<lib::pmr::string>(allocator_arg, alloc, long_str);
+  EXPECT_EQ(resource.allocs, 1u);
+  EXPECT_EQ(a.as<lib::pmr::string>(), long_str);
+  EXPECT_TRUE(str.get_allocator() == alloc);
+  a.emplace<int>(allocator_arg, alloc, 202);
+  EXPECT_EQ(a.as<int>(), 202);
+  EXPECT_EQ(resource.live_bytes, 0u);
+}
+
+FIXTURE(variant_in_container) {
+  counting_resource_t upstream;
+  {
+    monotonic_buffer_resource resource(&upstream);
+    lib::pmr::vector<val_t> vals(&resource);
+    vals.emplace_back(lib::pmr::string(long_str));
+    vals.emplace_back(101);
+    vals.emplace_back();
+    /* The vector hands its allocator to each variant, which hands it on to
+       its string. */
+    EXPECT_TRUE(vals[0].as<lib::pmr::string>().get_allocator().resource() ==
+                &resource);
+    EXPECT_EQ(vals[1].as<int>(), 101);
+    EXPECT_FALSE(vals[2]);
+  }
+  EXPECT_EQ(upstream.live_bytes, 0u);
+}
@@ -0,0 +1,111 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Sum the areas of shapes, both of the circles alone and of every shape, in
+separate passes which build intermediate vectors, and then with fused
+pipelines.
+
+Usage: pipeline.bench [n]
+--------------------------------------------------------------------------- */
+
+#include <vector>
+
+#include "bench.h"
+#include "pipeline.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+struct circle_t { double radius; };
+struct square_t { double side; };
+struct triangle_t { double base, height; };
+
+using shape_t = variant_t<circle_t, square_t, triangle_t>;
+
+static double get_area(const circle_t &circle) {
+  return 3.14159 * circle.radius * circle.radius;
+}
+
+static double get_area(const square_t &square) {
+  return square.side * square.side;
+}
+
+static double get_area(const triangle_t &triangle) {
+  return 0.5 * triangle.base * triangle.height;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 50000000);
+  vector<shape_t> shapes;
+  shapes.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    switch (i % 3) {
+      case 0: {
+        shapes.push_back(circle_t{1.0 + i % 7});
+        break;
+      }
+      case 1: {
+        shapes.push_back(square_t{1.0 + i % 5});
+        break;
+      }
+      default: {
+        shapes.push_back(triangle_t{1.0 + i % 3, 2.0});
+        break;
+      }
+    }  // switch
+  }  // for
+  measure(cout, "circles, multi-pass", n, [&] {
+    vector<circle_t> circles;
+    for (const auto &shape : shapes) {
+      if (const circle_t *circle = shape.try_as<circle_t>()) {
+        circles.push_back(*circle);
+      }  // if
+    }  // for
+    vector<double> areas;
+    areas.reserve(circles.size());
+    for (const auto &circle : circles) {
+      areas.push_back(get_area(circle));
+    }  // for
+    double total = 0;
+    for (double area : areas) {
+      total += area;
+    }  // for
+    keep(total);
+  });
+  measure(cout, "circles, fused", n, [&] {
+    keep(sum(transform_match<double>(
+        only<circle_t>(shapes),
+        [](const circle_t &circle) { return get_area(circle); })));
+  });
+  measure(cout, "all shapes, multi-pass", n, [&] {
+    vector<double> areas;
+    areas.reserve(shapes.size());
+    for (const auto &shape : shapes) {
+      areas.push_back(match<double>(
+          shape, [](const auto &elem) { return get_area(elem); }));
+    }  // for
+    double total = 0;
+    for (double area : areas) {
+      total += area;
+    }  // for
+    keep(total);
+  });
+  measure(cout, "all shapes, fused", n, [&] {
+    keep(sum(transform_match<double>(
+        shapes, [](const auto &elem) { return get_area(elem); })));
+  });
+  return 0;
+}
@@ -0,0 +1,237 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Lazy views over sequences of variants, which fuse into a single pass.
+
+  only<circle_t>(shapes)
+      The circles among the shapes, as circle_t.
+  transform_match<double>(range, lambdas...)
+      The results of matching each element against the lambdas.
+  sum(range), reduce(range, init, fn)
+      Sinks, which walk a range once and return a result.
+
+A view does no work of its own.  It only knows how to hand its elements, one
+at a time, to a function, which it does by asking the range beneath it to do
+the same.  So a sink at the end of a pipeline drives a single loop over the
+underlying sequence, with nothing materialized in between:
+
+  double total = sum(transform_match<double>(
+      only<circle_t>(shapes),
+      [](const circle_t &circle) { return circle.radius; }));
+
+Each element costs at most one dispatch.  only<> needs none: it just checks
+the index of the element's type.  transform_match<> dispatches if handed a
+variant, but if handed an element of a known type, as it is by only<>, it
+calls the right lambda directly.
+
+A view keeps a reference to a sequence (such as a std::vector), which must
+outlive it, but keeps views beneath it by value, so pipelines can be built
+out of temporaries.
+
+See "pipeline.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace variant {
+
+/* The base of all views, which tells them apart from other ranges. */
+struct view_t {};
+
+/* True iff. range_t is one of our views. */
+template <typename range_t>
+using is_view = std::is_base_of<view_t, range_t>;
+
+/* The type of element in a range.  Views say what theirs is; for anything
+   else, it's what its iterators refer to. */
+template <typename range_t, typename = void>
+struct range_elem {
+  using type =
+      std::decay_t<decltype(*std::begin(std::declval<const range_t &>()))>;
+};
+
+template <typename range_t>
+struct range_elem<range_t, std::enable_if_t<is_view<range_t>::value>> {
+  using type = typename range_t::elem_t;
+};
+
+template <typename range_t>
+using range_elem_t = typename range_elem<range_t>::type;
+
+/* How a view holds the range beneath it: by value if it's a view, otherwise
+   by reference. */
+template <typename range_t>
+using view_holder_t =
+    std::conditional_t<is_view<range_t>::value, range_t, const range_t &>;
+
+/* Hand each element of a view to fn. */
+template <typename range_t, typename fn_t>
+void for_each_elem(const range_t &range, fn_t &&fn, std::true_type) {
+  range.for_each(fn);
+}
+
+/* Hand each element of any other range to fn. */
+template <typename range_t, typename fn_t>
+void for_each_elem(const range_t &range, fn_t &&fn, std::false_type) {
+  for (const auto &elem : range) {
+    fn(elem);
+  }  // for
+}
+
+/* Hand each element of a range to fn, in order. */
+template <typename range_t, typename fn_t>
+void for_each_elem(const range_t &range, fn_t &&fn) {
+  for_each_elem(range, std::forward<fn_t>(fn), is_view<range_t>());
+}
+
+/* ---------------------------------------------------------------------------
+only<elem_t>(range)
+--------------------------------------------------------------------------- */
+
+/* The elements of a range which are of type elem_t. */
+template <typename elem_t_, typename range_t>
+class only_view_t final : public view_t {
+  public:
+
+  using elem_t = elem_t_;
+
+  explicit only_view_t(const range_t &range) : range(range) {}
+
+  /* Hand each elem_t to fn. */
+  template <typename fn_t>
+  void for_each(fn_t &&fn) const {
+    for_each_elem(range, [&fn](const auto &elem) { pick(elem, fn); });
+  }
+
+  private:
+
+  /* A variant which might hold an elem_t.  Checking costs a comparison,
+     not a dispatch. */
+  template <typename... elems_t, typename fn_t>
+  static void pick(const variant_t<elems_t...> &that, fn_t &fn) {
+    const elem_t *elem = that.template try_as<elem_t>();
+    if (elem) {
+      fn(*elem);
+    }  // if
+  }
+
+  /* An elem_t, which we pass along. */
+  template <typename fn_t>
+  static void pick(const elem_t &that, fn_t &fn) {
+    fn(that);
+  }
+
+  /* Some other type, which we skip. */
+  template <typename other_t, typename fn_t>
+  static std::enable_if_t<!std::is_same<other_t, elem_t>::value &&
+                          !is_variant<other_t>::value>
+      pick(const other_t &, fn_t &) {}
+
+  /* The range beneath us. */
+  view_holder_t<range_t> range;
+
+};  // only_view_t<elem_t, range_t>
+
+/* A view of the elements of the range which are of type elem_t. */
+template <typename elem_t, typename range_t>
+only_view_t<elem_t, range_t> only(const range_t &range) {
+  return only_view_t<elem_t, range_t>(range);
+}
+
+/* ---------------------------------------------------------------------------
+transform_match<ret_t>(range, lambdas...)
+--------------------------------------------------------------------------- */
+
+/* The results of applying a functor to the elements of a range. */
+template <typename range_t, typename functor_t>
+class transform_view_t final : public view_t {
+  public:
+
+  using elem_t = typename functor_t::ret_t;
+
+  transform_view_t(const range_t &range, functor_t functor)
+      : range(range), functor(std::move(functor)) {}
+
+  /* Hand the result for each element to fn. */
+  template <typename fn_t>
+  void for_each(fn_t &&fn) const {
+    const functor_t &functor = this->functor;
+    for_each_elem(range, [&fn, &functor](const auto &elem) {
+      fn(call(functor, elem));
+    });
+  }
+
+  private:
+
+  /* A variant, so we must dispatch. */
+  template <typename... elems_t>
+  static elem_t call(const functor_t &functor,
+                     const variant_t<elems_t...> &that) {
+    return apply(functor, that);
+  }
+
+  /* An element of a known type, so we don't. */
+  template <typename that_t>
+  static std::enable_if_t<!is_variant<that_t>::value, elem_t> call(
+      const functor_t &functor, const that_t &that) {
+    return functor(that);
+  }
+
+  /* The range beneath us. */
+  view_holder_t<range_t> range;
+
+  /* What we apply to each element. */
+  functor_t functor;
+
+};  // transform_view_t<range_t, functor_t>
+
+/* A view of the results of matching each element of the range against the
+   lambdas, which must return ret_t. */
+template <typename ret_t, typename range_t, typename... lambdas_t>
+auto transform_match(const range_t &range, lambdas_t &&... lambdas) {
+  auto functor = make_overload<ret_t>(std::forward<lambdas_t>(lambdas)...);
+  return transform_view_t<range_t, decltype(functor)>(range,
+                                                      std::move(functor));
+}
+
+/* ---------------------------------------------------------------------------
+Sinks.
+--------------------------------------------------------------------------- */
+
+/* Fold the elements of a range into init, in order, with fn. */
+template <typename range_t, typename val_t, typename fn_t>
+val_t reduce(const range_t &range, val_t init, fn_t &&fn) {
+  for_each_elem(range, [&init, &fn](const auto &elem) {
+    init = fn(std::move(init), elem);
+  });
+  return init;
+}
+
+/* The sum of the elements of a range. */
+template <typename range_t>
+range_elem_t<range_t> sum(const range_t &range) {
+  range_elem_t<range_t> total = range_elem_t<range_t>();
+  for_each_elem(range, [&total](const auto &elem) { total += elem; });
+  return total;
+}
+
+}  // variant
+}  // cppcon14
@@ -0,0 +1,65 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the lazy views in "pipeline.h".
+--------------------------------------------------------------------------- */
+
+#include "pipeline.h"
+
+#include <string>
+#include <vector>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+
+/* A sequence of ints and strings. */
+using int_or_str_t = variant_t<int, string>;
+
+static const vector<int_or_str_t> mixed = {
+  1, string("hello"), 2, string("doctor"), 3
+};
+
+FIXTURE(pipeline_only) {
+  EXPECT_EQ(sum(only<int>(mixed)), 6);
+  EXPECT_EQ(sum(only<string>(mixed)), "hellodoctor");
+}
+
+FIXTURE(pipeline_transform_match) {
+  auto sizes = transform_match<size_t>(
+      mixed, [](int) { return size_t(1); },
+      [](const string &str) { return str.size(); });
+  EXPECT_EQ(sum(sizes), 14u);
+}
+
+FIXTURE(pipeline_fused) {
+  /* Only the lambda for strings is ever called. */
+  auto sizes = transform_match<size_t>(
+      only<string>(mixed), [](const string &str) { return str.size(); });
+  EXPECT_EQ(sum(sizes), 11u);
+  EXPECT_EQ(sum(only<size_t>(sizes)), 11u);
+}
+
+FIXTURE(pipeline_reduce) {
+  auto joined = reduce(only<string>(mixed), string(),
+                       [](string total, const string &str) {
+                         return total.empty() ? str : total + "," + str;
+                       });
+  EXPECT_EQ(joined, "hello,doctor");
+  EXPECT_EQ(reduce(vector<int>{1, 2, 3}, 1,
+                   [](int total, int val) { return total * val; }),
+            6);
+}
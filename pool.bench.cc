@@ -0,0 +1,93 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Churn through a variant_pool_t of shapes: insert, look up, erase and
+re-insert, and iterate each slab.
+--------------------------------------------------------------------------- */
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "variant_pool.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+struct circle_t { double radius; };
+struct square_t { double side; };
+struct triangle_t { double base, height; };
+
+using pool_t = variant_pool_t<circle_t, square_t, triangle_t>;
+
+/* Add a shape of the type selected by i. */
+static pool_t::handle_t add_shape(pool_t &pool, size_t i) {
+  switch (i % 3) {
+    case 0: {
+      return pool.emplace<circle_t>(circle_t{101});
+    }
+    case 1: {
+      return pool.emplace<square_t>(square_t{101});
+    }
+    default: {
+      return pool.emplace<triangle_t>(triangle_t{101, 202});
+    }
+  }  // switch
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 10000000);
+  pool_t pool;
+  vector<pool_t::handle_t> handles(n);
+  measure(cout, "insert", n, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      handles[i] = add_shape(pool, i);
+    }  // for
+  });
+  vector<size_t> order(n);
+  mt19937_64 gen(0);
+  for (size_t i = 0; i < n; ++i) {
+    order[i] = gen() % n;
+  }  // for
+  double sum = 0;
+  measure(cout, "lookup (random)", n, [&] {
+    for (size_t i : order) {
+      const auto *circle = pool.try_get<circle_t>(handles[i]);
+      sum += circle ? circle->radius : 0;
+    }  // for
+  });
+  keep(sum);
+  measure(cout, "erase+insert (random)", n, [&] {
+    for (size_t i : order) {
+      pool.erase(handles[i]);
+      handles[i] = add_shape(pool, i);
+    }  // for
+  });
+  sum = 0;
+  measure(cout, "for_each per slab", n, [&] {
+    pool.for_each<circle_t>([&](const circle_t &that) {
+      sum += 3.14 * that.radius * that.radius;
+    });
+    pool.for_each<square_t>([&](const square_t &that) {
+      sum += that.side * that.side;
+    });
+    pool.for_each<triangle_t>([&](const triangle_t &that) {
+      sum += that.base * that.height / 2;
+    });
+  });
+  keep(sum);
+  return 0;
+}
@@ -0,0 +1,437 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The scaling benchmark.  Run a workload on 1, 2, 4, ... threads at once, each
+thread taking its own part of the input, and see how the throughput grows.
+There are two workloads:
+
+  speed  The areas of the shapes of "speed.test.cc", with each of its
+         engines.  The shapes are built once and only read.
+  calc   The calculator's eval_t, applied to a few expressions over a few
+         definitions in scope.  With --asts=shared, every thread evaluates
+         the same trees in the same scope, so copying a lambda or a
+         literal out of them bumps reference counts which every thread
+         shares; with --asts=private, each thread parses its own.
+
+Each writes its results in one of three ways:
+
+  private      Into a buffer of the thread's own.
+  shared       Into one buffer, each thread filling a contiguous block.
+  interleaved  Into one buffer, each thread taking every nth element, so
+               neighboring results, on the same cache line, are written by
+               different threads.  This is false sharing, on purpose.
+
+We time each trial from the release of the threads, which have been started
+and are waiting, until the last has finished, and each thread also times its
+own part.  For each configuration we report:
+
+  the wall time per element (min/median/p99 over the trials);
+  Melem/s      elements per microsecond, from the median trial;
+  eff          the parallel efficiency: the speedup over the smallest
+               number of threads tried, divided by the increase in threads,
+               so 1 is perfect scaling;
+  cv           the coefficient of variation of the threads' own times, in
+               the median trial, so 0 means they all took as long; and
+  max/min      the slowest thread's time over the fastest's.
+
+A scaling cliff which shows up in the calc workload with shared trees but not
+with private ones points at shared reference counts; one which shows up in
+every engine's speed workload but not in the hand-rolled ones (switch and
+fnptr) points at our variant, such as the guards on its static tags.
+
+Usage: scaling.bench [flags]
+  --threads=1,2,4,...,N       The numbers of threads to try.  By default,
+                              powers of two up to the hardware's threads,
+                              and then that number.
+  --workloads=all             Either or both of speed and calc.
+  --engines=all               The speed engines to run, as in speed.test.
+  --asts=all                  Either or both of shared and private.
+  --outputs=all               Any of private, shared and interleaved.
+  --size=4000000              The number of shapes.
+  --evals=400000              The number of expressions to evaluate.
+  --warmup=2, --trials=11     As in speed.test.
+  --json                      Write JSON instead of a table.
+--------------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "calc.h"
+#include "speed.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::calc;
+using namespace cppcon14::speed;
+
+/* ---------------------------------------------------------------------------
+Running threads.
+--------------------------------------------------------------------------- */
+
+/* The times of one trial. */
+struct trial_t final {
+
+  /* From releasing the threads to the last one finishing. */
+  double wall_ns;
+
+  /* The time each thread spent on its own part. */
+  vector<double> thread_ns;
+
+};  // trial_t
+
+/* Start the given number of threads, release them all at once to call
+   work(t, threads), where t is each thread's index, and time them. */
+template <typename work_t>
+static trial_t run_threads(size_t threads, work_t &work) {
+  trial_t trial;
+  trial.thread_ns.resize(threads);
+  atomic<size_t> ready(0);
+  atomic<bool> go(false);
+  vector<thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      ++ready;
+      while (!go.load(memory_order_acquire)) {
+        this_thread::yield();
+      }  // while
+      trial.thread_ns[t] = time_per_elem(1, [&] { work(t, threads); });
+    });
+  }  // for
+  while (ready.load() < threads) {
+    this_thread::yield();
+  }  // while
+  auto start = chrono::steady_clock::now();
+  go.store(true, memory_order_release);
+  for (thread &worker : workers) {
+    worker.join();
+  }  // for
+  trial.wall_ns = chrono::duration<double, nano>(
+      chrono::steady_clock::now() - start).count();
+  return trial;
+}
+
+/* The part [begin, end) of n elements which thread t of threads takes. */
+static pair<size_t, size_t> get_part(size_t n, size_t t, size_t threads) {
+  return { n * t / threads, n * (t + 1) / threads };
+}
+
+/* The ways to write results. */
+static const char *const outputs[] = { "private", "shared", "interleaved" };
+
+/* Where each thread writes its results, of type elem_t, per the output. */
+template <typename elem_t>
+class results_t final {
+  public:
+
+  /* For n results, in the named way. */
+  results_t(size_t n, const string &output) : n(n), output(output) {}
+
+  /* Make room for the given number of threads.  Private buffers are left
+     for each thread to allocate as it goes, as a real worker would. */
+  void prepare(size_t threads) {
+    assert(this);
+    if (output == "private") {
+      privates.clear();
+      privates.resize(threads);
+      shared.clear();
+    } else {
+      privates.clear();
+      shared.resize(n);
+    }  // if
+  }
+
+  /* Call fn(i, result) for each element i which thread t takes, where
+     result is where to write its result. */
+  template <typename fn_t>
+  void for_each(size_t t, size_t threads, const fn_t &fn) {
+    assert(this);
+    if (output == "interleaved") {
+      for (size_t i = t; i < n; i += threads) {
+        fn(i, shared[i]);
+      }  // for
+      return;
+    }  // if
+    auto part = get_part(n, t, threads);
+    if (output == "private") {
+      vector<elem_t> &buffer = privates[t];
+      buffer.resize(part.second - part.first);
+      for (size_t i = part.first; i < part.second; ++i) {
+        fn(i, buffer[i - part.first]);
+      }  // for
+    } else {
+      for (size_t i = part.first; i < part.second; ++i) {
+        fn(i, shared[i]);
+      }  // for
+    }  // if
+  }
+
+  private:
+
+  /* The number of results. */
+  size_t n;
+
+  /* Which of the outputs we are. */
+  string output;
+
+  /* Each thread's own buffer, if private. */
+  vector<vector<elem_t>> privates;
+
+  /* The one buffer, if not. */
+  vector<elem_t> shared;
+
+};  // results_t<elem_t>
+
+/* ---------------------------------------------------------------------------
+The workloads.  Each has a prepare(threads), called untimed before each
+trial, and a call operator which does thread t's part.
+--------------------------------------------------------------------------- */
+
+/* The areas of the shapes, with one of the speed engines. */
+template <typename engine_t>
+class speed_work_t final {
+  public:
+
+  speed_work_t(const vector<kind_t> &kinds, const string &output)
+      : shapes(engine_t::build(kinds)), results(kinds.size(), output) {}
+
+  void prepare(size_t threads) {
+    assert(this);
+    results.prepare(threads);
+  }
+
+  void operator()(size_t t, size_t threads) {
+    assert(this);
+    results.for_each(t, threads, [this](size_t i, double &result) {
+      result = engine_t::get_area(shapes[i]);
+    });
+  }
+
+  private:
+
+  /* The shapes, shared by all the threads. */
+  decltype(engine_t::build(vector<kind_t>())) shapes;
+
+  /* Where their areas go. */
+  results_t<double> results;
+
+};  // speed_work_t<engine_t>
+
+/* The expressions we evaluate, round-robin.  They do arithmetic on an int
+   in scope, concatenate a string in scope too long to keep inline, and copy
+   a lambda, with its parameters and a reference to its definition. */
+static const char *const exprs[] = {
+  "x * x + 3 < 100 and not 0",
+  "s + \"-suffix\"",
+  "sq",
+  "-(x + 1) * 2"
+};
+
+/* The definitions, and the parsed expressions, which the threads either
+   share or each have their own of. */
+class program_t final {
+  public:
+
+  program_t() {
+    scope.def("x", 7);
+    scope.def("s", string("a string too long to keep inline"));
+    scope.def("sq", lambda_t({ "x" }, parse_expr("x * x")));
+    for (const char *expr : exprs) {
+      trees.push_back(parse_expr(expr));
+    }  // for
+  }
+
+  /* Evaluate the ith expression. */
+  val_t eval(size_t i) const {
+    assert(this);
+    return cppcon14::variant::apply(eval_t{ &scope },
+                                    *trees[i % trees.size()]);
+  }
+
+  private:
+
+  /* The definitions. */
+  scope_t scope;
+
+  /* The parsed expressions. */
+  vector<expr_ptr_t> trees;
+
+};  // program_t
+
+/* Evaluating expressions. */
+class calc_work_t final {
+  public:
+
+  calc_work_t(size_t n, const string &asts, const string &output)
+      : private_asts(asts == "private"), results(n, output) {}
+
+  void prepare(size_t threads) {
+    assert(this);
+    programs.resize(private_asts ? threads : 1);
+    for (auto &program : programs) {
+      if (!program) {
+        program = make_unique<program_t>();
+      }  // if
+    }  // for
+    results.prepare(threads);
+  }
+
+  void operator()(size_t t, size_t threads) {
+    assert(this);
+    const program_t &program = *programs[private_asts ? t : 0];
+    results.for_each(t, threads, [&](size_t i, val_t &result) {
+      result = program.eval(i);
+    });
+  }
+
+  private:
+
+  /* True if each thread has its own program. */
+  bool private_asts;
+
+  /* One program for each thread, or one for all. */
+  vector<unique_ptr<program_t>> programs;
+
+  /* Where the values go. */
+  results_t<val_t> results;
+
+};  // calc_work_t
+
+/* ---------------------------------------------------------------------------
+The driver.
+--------------------------------------------------------------------------- */
+
+/* The numbers of threads to try. */
+static vector<size_t> get_threads(const flags_t &flags) {
+  size_t most = max<size_t>(1, thread::hardware_concurrency());
+  string def;
+  for (size_t threads = 1; threads < most; threads *= 2) {
+    def += to_string(threads) + ',';
+  }  // for
+  def += to_string(most);
+  return flags.get_counts("threads", def.c_str());
+}
+
+/* The mean and the coefficient of variation of the samples. */
+static double get_cv(const vector<double> &samples) {
+  double sum = 0, sum_sq = 0;
+  for (double sample : samples) {
+    sum += sample;
+    sum_sq += sample * sample;
+  }  // for
+  double mean = sum / samples.size(),
+         var = max(0.0, sum_sq / samples.size() - mean * mean);
+  return mean ? sqrt(var) / mean : 0;
+}
+
+/* Run the work, of n elements, on each number of threads, and report it
+   under the given name. */
+template <typename work_t>
+static void run(const flags_t &flags, report_t &report, const string &name,
+                size_t n, work_t &work) {
+  trial_opts_t opts = trial_opts_t::from(flags);
+  double base_rate = 0;
+  size_t base_threads = 0;
+  for (size_t threads : get_threads(flags)) {
+    for (size_t i = 0; i < opts.warmup; ++i) {
+      work.prepare(threads);
+      run_threads(threads, work);
+    }  // for
+    vector<trial_t> trials;
+    for (size_t i = 0; i < max<size_t>(1, opts.trials); ++i) {
+      work.prepare(threads);
+      trials.push_back(run_threads(threads, work));
+    }  // for
+    vector<double> samples;
+    for (const trial_t &trial : trials) {
+      samples.push_back(trial.wall_ns / n);
+    }  // for
+    sort(trials.begin(), trials.end(),
+         [](const trial_t &lhs, const trial_t &rhs) {
+           return lhs.wall_ns < rhs.wall_ns;
+         });
+    const trial_t &median = trials[(trials.size() - 1) / 2];
+    double rate = n / median.wall_ns * 1000;
+    if (!base_threads) {
+      base_rate = rate;
+      base_threads = threads;
+    }  // if
+    auto extremes = minmax_element(median.thread_ns.begin(),
+                                   median.thread_ns.end());
+    report.add({ name + " T=" + to_string(threads), n,
+                 summarize(move(samples)),
+                 { { "Melem/s", rate },
+                   { "eff", rate / base_rate * base_threads / threads },
+                   { "cv", get_cv(median.thread_ns) },
+                   { "max/min", *extremes.second / *extremes.first } } });
+  }  // for
+}
+
+/* Run the speed workload with an engine, writing in every way. */
+template <typename engine_t>
+static void run_speed(const flags_t &flags, report_t &report,
+                      const vector<kind_t> &kinds) {
+  if (!flags.selects("engines", engine_t::get_name())) {
+    return;
+  }  // if
+  for (const char *output : outputs) {
+    if (!flags.selects("outputs", output)) {
+      continue;
+    }  // if
+    speed_work_t<engine_t> work(kinds, output);
+    run(flags, report,
+        string("speed ") + engine_t::get_name() + ' ' + output,
+        kinds.size(), work);
+  }  // for
+}
+
+int main(int argc, char *argv[]) {
+  flags_t flags(argc, argv);
+  report_t report(cout, flags);
+  if (flags.selects("workloads", "speed")) {
+    auto kinds = make_kinds(flags.get_count("size", 4000000));
+    run_speed<virtual_engine_t>(flags, report, kinds);
+    run_speed<boost_engine_t>(flags, report, kinds);
+    run_speed<cppcon14_engine_t>(flags, report, kinds);
+#if __cplusplus >= 201703L
+    run_speed<std_engine_t>(flags, report, kinds);
+#endif
+    run_speed<switch_engine_t>(flags, report, kinds);
+    run_speed<fnptr_engine_t>(flags, report, kinds);
+  }  // if
+  if (flags.selects("workloads", "calc")) {
+    size_t n = flags.get_count("evals", 400000);
+    for (const char *asts : { "shared", "private" }) {
+      if (!flags.selects("asts", asts)) {
+        continue;
+      }  // if
+      for (const char *output : outputs) {
+        if (!flags.selects("outputs", output)) {
+          continue;
+        }  // if
+        calc_work_t work(n, asts, output);
+        run(flags, report,
+            string("calc ") + asts + "-asts " + output, n, work);
+      }  // for
+    }  // for
+  }  // if
+  return 0;
+}
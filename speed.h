@@ -0,0 +1,373 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+The shapes and dispatch engines of the dispatch benchmark, "speed.test.cc",
+shared with the other benchmarks which run its workload, such as
+"scaling.bench.cc".  Each engine differs in how it keeps the shapes and picks
+the right area function for each:
+
+  virtual   A vector of unique_ptrs to a base class with a virtual function.
+  boost     A vector of boost::variants, visited with boost::apply_visitor.
+  cppcon14  A vector of our variant_ts, applied with apply().
+  std       A vector of std::variants, visited with std::visit.  Only built
+            as C++17 or later.
+  switch    A vector of tagged unions, dispatched by a switch on the tag.
+  fnptr     A vector of structs each holding a pointer to its area function.
+
+The switch and fnptr engines are built on templates over the types of the
+shapes, which "dispatch_order.bench.cc" uses with its own alternatives.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/variant.hpp>
+
+#if __cplusplus >= 201703L
+#include <variant>
+#endif
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace speed {
+
+/* ---------------------------------------------------------------------------
+The shapes.
+--------------------------------------------------------------------------- */
+
+/* The kinds of shape, in the order in which we build them. */
+enum class kind_t : uint8_t { circle, square, triangle };
+
+/* A third of each kind, in three blocks. */
+inline std::vector<kind_t> make_kinds(size_t n) {
+  std::vector<kind_t> kinds(n);
+  for (size_t i = 0; i < n; ++i) {
+    kinds[i] = static_cast<kind_t>(i * 3 / n);
+  }  // for
+  return kinds;
+}
+
+struct circle_t {
+  circle_t(double radius) : radius(radius) {}
+  double get_area() const { return 3.14 * radius * radius; }
+  double radius;
+};
+
+struct square_t {
+  square_t(double side) : side(side) {}
+  double get_area() const { return side * side; }
+  double side;
+};
+
+struct triangle_t {
+  triangle_t(double base, double height) : base(base), height(height) {}
+  double get_area() const { return base * height / 2; }
+  double base;
+  double height;
+};
+
+/* Build the shape of the given kind, for any engine which can be built from
+   our shape types. */
+template <typename shape_t>
+shape_t make_shape(kind_t kind) {
+  switch (kind) {
+    case kind_t::circle: {
+      return circle_t(101);
+    }
+    case kind_t::square: {
+      return square_t(101);
+    }
+    default: {
+      return triangle_t(101, 202);
+    }
+  }  // switch
+}
+
+/* Build the shapes of the given kinds, with make_shape(). */
+template <typename shape_t>
+std::vector<shape_t> make_shapes(const std::vector<kind_t> &kinds) {
+  std::vector<shape_t> shapes;
+  shapes.reserve(kinds.size());
+  for (kind_t kind : kinds) {
+    shapes.push_back(make_shape<shape_t>(kind));
+  }  // for
+  return shapes;
+}
+
+/* ---------------------------------------------------------------------------
+The engines.  Each has a name, a way to build its shapes, and a way to get
+the area of one of them.
+--------------------------------------------------------------------------- */
+
+/* Virtual functions. */
+struct virtual_engine_t final {
+
+  struct shape_t {
+    virtual ~shape_t() {}
+    virtual double get_area() const = 0;
+  };
+
+  template <typename elem_t>
+  struct shape_of_t final : shape_t {
+    template <typename... args_t>
+    shape_of_t(args_t... args) : elem(args...) {}
+    double get_area() const override { return elem.get_area(); }
+    elem_t elem;
+  };
+
+  using ptr_t = std::unique_ptr<shape_t>;
+
+  static const char *get_name() { return "virtual"; }
+
+  static std::vector<ptr_t> build(const std::vector<kind_t> &kinds) {
+    std::vector<ptr_t> shapes;
+    shapes.reserve(kinds.size());
+    for (kind_t kind : kinds) {
+      switch (kind) {
+        case kind_t::circle: {
+          shapes.push_back(std::make_unique<shape_of_t<circle_t>>(101));
+          break;
+        }
+        case kind_t::square: {
+          shapes.push_back(std::make_unique<shape_of_t<square_t>>(101));
+          break;
+        }
+        default: {
+          shapes.push_back(std::make_unique<shape_of_t<triangle_t>>(101, 202));
+          break;
+        }
+      }  // switch
+    }  // for
+    return shapes;
+  }
+
+  static double get_area(const ptr_t &shape) {
+    return shape->get_area();
+  }
+
+};  // virtual_engine_t
+
+/* boost::variant. */
+struct boost_engine_t final {
+
+  using shape_t = boost::variant<circle_t, square_t, triangle_t>;
+
+  struct get_area_t : boost::static_visitor<double> {
+    template <typename elem_t>
+    double operator()(const elem_t &elem) const { return elem.get_area(); }
+  };
+
+  static const char *get_name() { return "boost"; }
+
+  static std::vector<shape_t> build(const std::vector<kind_t> &kinds) {
+    return make_shapes<shape_t>(kinds);
+  }
+
+  static double get_area(const shape_t &shape) {
+    return boost::apply_visitor(get_area_t(), shape);
+  }
+
+};  // boost_engine_t
+
+/* Our variant_t. */
+struct cppcon14_engine_t final {
+
+  using shape_t = variant::variant_t<circle_t, square_t, triangle_t>;
+
+  struct get_area_t final {
+    using ret_t = double;
+    template <typename elem_t>
+    double operator()(const elem_t &elem) const { return elem.get_area(); }
+  };
+
+  static const char *get_name() { return "cppcon14"; }
+
+  static std::vector<shape_t> build(const std::vector<kind_t> &kinds) {
+    return make_shapes<shape_t>(kinds);
+  }
+
+  static double get_area(const shape_t &shape) {
+    return variant::apply(get_area_t(), shape);
+  }
+
+};  // cppcon14_engine_t
+
+#if __cplusplus >= 201703L
+/* std::variant. */
+struct std_engine_t final {
+
+  using shape_t = std::variant<circle_t, square_t, triangle_t>;
+
+  static const char *get_name() { return "std"; }
+
+  static std::vector<shape_t> build(const std::vector<kind_t> &kinds) {
+    return make_shapes<shape_t>(kinds);
+  }
+
+  static double get_area(const shape_t &shape) {
+    return std::visit([](const auto &elem) { return elem.get_area(); },
+                      shape);
+  }
+
+};  // std_engine_t
+#endif
+
+/* The most alternatives basic_switch_engine_t can switch among. */
+constexpr size_t max_switch_alts = 32;
+
+/* A tag and a buffer big enough for any of elems_t, dispatched by a switch
+   on the tag.  It builds its shapes from our variant_ts of the same types,
+   so that it serves any alternatives with a get_area() function, up to
+   max_switch_alts of them. */
+template <typename... elems_t>
+struct basic_switch_engine_t {
+
+  static_assert(sizeof...(elems_t) <= max_switch_alts,
+                "Too many alternatives to switch.");
+
+  static constexpr size_t alts = sizeof...(elems_t);
+
+  using from_t = variant::variant_t<elems_t...>;
+
+  struct shape_t final {
+    uint8_t kind;
+    alignas(elems_t...) char data[std::max({ sizeof(elems_t)... })];
+  };
+
+  /* Copies an element into a shape, tagged with its position. */
+  struct put_t final {
+    using ret_t = void;
+    template <size_t idx, typename elem_t>
+    void operator()(std::integral_constant<size_t, idx>,
+                    const elem_t &elem) const {
+      shape.kind = idx;
+      new (shape.data) elem_t(elem);
+    }
+    shape_t &shape;
+  };
+
+  static const char *get_name() { return "switch"; }
+
+  static std::vector<shape_t> build(const std::vector<from_t> &from) {
+    std::vector<shape_t> shapes(from.size());
+    for (size_t i = 0; i < from.size(); ++i) {
+      variant::apply_indexed(put_t{shapes[i]}, from[i]);
+    }  // for
+    return shapes;
+  }
+
+  /* The alternative at idx, or at the last index if there are fewer. */
+  template <size_t idx>
+  static double get_as(const shape_t &shape) {
+    using elem_t = variant::nth_t<(idx < alts ? idx : alts - 1), elems_t...>;
+    return reinterpret_cast<const elem_t &>(shape.data).get_area();
+  }
+
+  static double get_area(const shape_t &shape) {
+    switch (shape.kind) {
+#define CPPCON14_CASE(idx)  \
+      case idx: {  \
+        return get_as<idx>(shape);  \
+      }
+      CPPCON14_CASE(0) CPPCON14_CASE(1) CPPCON14_CASE(2) CPPCON14_CASE(3)
+      CPPCON14_CASE(4) CPPCON14_CASE(5) CPPCON14_CASE(6) CPPCON14_CASE(7)
+      CPPCON14_CASE(8) CPPCON14_CASE(9) CPPCON14_CASE(10) CPPCON14_CASE(11)
+      CPPCON14_CASE(12) CPPCON14_CASE(13) CPPCON14_CASE(14)
+      CPPCON14_CASE(15) CPPCON14_CASE(16) CPPCON14_CASE(17)
+      CPPCON14_CASE(18) CPPCON14_CASE(19) CPPCON14_CASE(20)
+      CPPCON14_CASE(21) CPPCON14_CASE(22) CPPCON14_CASE(23)
+      CPPCON14_CASE(24) CPPCON14_CASE(25) CPPCON14_CASE(26)
+      CPPCON14_CASE(27) CPPCON14_CASE(28) CPPCON14_CASE(29)
+      CPPCON14_CASE(30) CPPCON14_CASE(31)
+#undef CPPCON14_CASE
+      default: {
+        return get_as<alts - 1>(shape);
+      }
+    }  // switch
+  }
+
+};  // basic_switch_engine_t<elems_t...>
+
+/* A function pointer and a buffer big enough for any of elems_t, built, as
+   basic_switch_engine_t is, from our variant_ts of the same types. */
+template <typename... elems_t>
+struct basic_fnptr_engine_t {
+
+  using from_t = variant::variant_t<elems_t...>;
+
+  struct shape_t final {
+    double (*get_area)(const shape_t &);
+    alignas(elems_t...) char data[std::max({ sizeof(elems_t)... })];
+  };
+
+  template <typename elem_t>
+  static double get_as(const shape_t &shape) {
+    return reinterpret_cast<const elem_t &>(shape.data).get_area();
+  }
+
+  /* Copies an element into a shape, along with the function to get at it. */
+  struct put_t final {
+    using ret_t = void;
+    template <typename elem_t>
+    void operator()(const elem_t &elem) const {
+      shape.get_area = &get_as<elem_t>;
+      new (shape.data) elem_t(elem);
+    }
+    shape_t &shape;
+  };
+
+  static const char *get_name() { return "fnptr"; }
+
+  static std::vector<shape_t> build(const std::vector<from_t> &from) {
+    std::vector<shape_t> shapes(from.size());
+    for (size_t i = 0; i < from.size(); ++i) {
+      variant::apply(put_t{shapes[i]}, from[i]);
+    }  // for
+    return shapes;
+  }
+
+  static double get_area(const shape_t &shape) {
+    return shape.get_area(shape);
+  }
+
+};  // basic_fnptr_engine_t<elems_t...>
+
+/* A tagged union and a switch. */
+struct switch_engine_t final
+    : basic_switch_engine_t<circle_t, square_t, triangle_t> {
+
+  static std::vector<shape_t> build(const std::vector<kind_t> &kinds) {
+    return basic_switch_engine_t::build(make_shapes<from_t>(kinds));
+  }
+
+};  // switch_engine_t
+
+/* A function pointer in each shape. */
+struct fnptr_engine_t final
+    : basic_fnptr_engine_t<circle_t, square_t, triangle_t> {
+
+  static std::vector<shape_t> build(const std::vector<kind_t> &kinds) {
+    return basic_fnptr_engine_t::build(make_shapes<from_t>(kinds));
+  }
+
+};  // fnptr_engine_t
+
+}  // speed
+}  // cppcon14
@@ -13,140 +13,66 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 
-TODO
---------------------------------------------------------------------------- */
+The dispatch benchmark: times each engine of "speed.h" over the same shapes.
 
-#include <chrono>
-#include <iostream>
+Usage: speed.test [flags]
+  --sizes=1000,100000,10000000  The numbers of shapes to try.
+  --engines=all                 A comma-separated list of engines to run.
+  --warmup=2                    The number of untimed runs per measurement.
+  --trials=11                   The number of timed runs per measurement.
+  --min-elems=4000000           Repeat small runs up to this many shapes.
+  --counters                    Also read the hardware counters (Linux).
+  --json                        Write JSON instead of a table.
+--------------------------------------------------------------------------- */
 
-#include "variant.h"
+#include <vector>
 
-#include <boost/variant.hpp>
+#include "bench.h"
+#include "speed.h"
 
 using namespace std;
-using namespace cppcon14::variant;
+using namespace cppcon14::bench;
+using namespace cppcon14::speed;
 
-size_t n = 90000000;
+/* ---------------------------------------------------------------------------
+The driver.
+--------------------------------------------------------------------------- */
 
-auto virtual_dispatch() {
-  struct shape_t {
-    virtual double get_area() const = 0;
-  };
-  struct circle_t : shape_t {
-    circle_t(double radius) : radius(radius) {}
-    virtual double get_area() const { return 3.14 * radius * radius; }
-    double radius;
-  };
-  struct square_t : shape_t {
-    square_t(double side) : side(side) {}
-    virtual double get_area() const { return side * side; }
-    double side;
-  };
-  struct triangle_t : shape_t {
-    triangle_t(double base, double height) : base(base), height(height) {}
-    virtual double get_area() const { return base * height / 2; }
-    double base;
-    double height;
-  };
-  std::vector<std::unique_ptr<shape_t>> shapes;
-  shapes.reserve(n);
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(std::make_unique<circle_t>(101));
-  }  // for
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(std::make_unique<square_t>(101));
-  }  // for
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(std::make_unique<triangle_t>(101, 202));
-  }  // for
-  std::vector<double> results;
-  results.reserve(n);
-  auto start = std::chrono::steady_clock::now();
-  for (size_t i = 0; i < shapes.size(); ++i) {
-    results[i] = shapes[i]->get_area();
-  }  // for
-  auto end = std::chrono::steady_clock::now();
-  return end - start;
+/* Build the engine's shapes, then measure computing their areas into a
+   vector of results, sized (not merely reserved) up front. */
+template <typename engine_t>
+static void run(const flags_t &flags, const vector<kind_t> &kinds,
+                counters_t &counters, report_t &report) {
+  if (!flags.selects("engines", engine_t::get_name())) {
+    return;
+  }  // if
+  auto shapes = engine_t::build(kinds);
+  vector<double> results(shapes.size());
+  stats_t stats =
+      run_trials(shapes.size(), trial_opts_t::from(flags), [&] {
+        for (size_t i = 0; i < shapes.size(); ++i) {
+          results[i] = engine_t::get_area(shapes[i]);
+        }  // for
+        keep(results);
+      }, &counters);
+  report.add({ engine_t::get_name(), shapes.size(), stats,
+               counters.get_counts() });
 }
 
-struct circle_t {
-  circle_t(double radius) : radius(radius) {}
-  double get_area() const { return 3.14 * radius * radius; }
-  double radius;
-};
-struct square_t {
-  square_t(double side) : side(side) {}
-  double get_area() const { return side * side; }
-  double side;
-};
-struct triangle_t {
-  triangle_t(double base, double height) : base(base), height(height) {}
-  double get_area() const { return base * height / 2; }
-  double base;
-  double height;
-};
-
-struct boost_get_area_t : boost::static_visitor<double> {
-  template <typename T>
-  double operator()(const T &t) const { return t.get_area(); }
-};
-
-auto boost_variant() {
-  using shape_t = boost::variant<circle_t, square_t, triangle_t>;
-  auto get_area = boost_get_area_t();
-  std::vector<shape_t> shapes;
-  shapes.reserve(n);
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(circle_t(101));
-  }  // for
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(square_t(101));
-  }  // for
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(triangle_t(101, 202));
+int main(int argc, char *argv[]) {
+  flags_t flags(argc, argv);
+  counters_t counters(flags, cerr);
+  report_t report(cout, flags);
+  for (size_t n : flags.get_counts("sizes", "1000,100000,10000000")) {
+    auto kinds = make_kinds(n);
+    run<virtual_engine_t>(flags, kinds, counters, report);
+    run<boost_engine_t>(flags, kinds, counters, report);
+    run<cppcon14_engine_t>(flags, kinds, counters, report);
+#if __cplusplus >= 201703L
+    run<std_engine_t>(flags, kinds, counters, report);
+#endif
+    run<switch_engine_t>(flags, kinds, counters, report);
+    run<fnptr_engine_t>(flags, kinds, counters, report);
   }  // for
-  std::vector<double> results;
-  results.reserve(n);
-  auto start = std::chrono::steady_clock::now();
-  for (size_t i = 0; i < shapes.size(); ++i) {
-    results[i] = boost::apply_visitor(get_area, shapes[i]);
-  }  // for
-  auto end = std::chrono::steady_clock::now();
-  return end - start;
+  return 0;
 }
-
-struct get_area_t {
-  using ret_t = double;
-  template <typename T>
-  double operator()(const T &that) { return that.get_area(); }
-};
-
-auto variant() {
-  using shape_t = variant_t<circle_t, square_t, triangle_t>;
-  auto get_area = get_area_t();
-  std::vector<shape_t> shapes;
-  shapes.reserve(n);
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(circle_t(101));
-  }  // for
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(square_t(101));
-  }  // for
-  for (size_t i = 0; i < n / 3; ++i) {
-    shapes.push_back(triangle_t(101, 202));
-  }  // for
-  std::vector<double> results;
-  results.reserve(n);
-  auto start = std::chrono::steady_clock::now();
-  for (size_t i = 0; i < shapes.size(); ++i) {
-    results[i] = apply(get_area, shapes[i]);
-  }  // for
-  auto end = std::chrono::steady_clock::now();
-  return end - start;
-}
-
-int main() {
-  std::cout << "took: " << std::chrono::duration_cast<std::chrono::seconds>(
-                               virtual_dispatch()).count() << std::endl;
-}
-
@@ -0,0 +1,139 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Measures what the extern template declarations in "val.h" and "calc.h" save
+when a program is split across many translation units.  We build a program
+out of several copies of "calc.test.cc", each compiled as its own object,
+first with CALC_NO_EXTERN_TEMPLATES defined (so every object instantiates
+the calculator's variants for itself) and then without (so only "calc.cc"
+does).  For each build we report the compiler's total CPU time, the total
+size of the objects, and the size of the linked program.  The compiler is
+taken from the CXX environment variable, or else defaults to clang++.
+
+Usage: split_build.bench [tus [out_dir]]
+--------------------------------------------------------------------------- */
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* Run a command to completion, adding its CPU time to the given total.
+   Returns false if the command couldn't be run or failed. */
+static bool run(const vector<string> &cmd, double &cpu_secs) {
+  vector<const char *> args;
+  for (const auto &arg : cmd) {
+    args.push_back(arg.c_str());
+  }
+  args.push_back(nullptr);
+  pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    execvp(args[0], const_cast<char *const *>(args.data()));
+    _exit(127);
+  }
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0) {
+    return false;
+  }
+  cpu_secs += usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+              usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* The size of a file in bytes, or zero if it doesn't exist. */
+static long get_file_size(const string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+/* The outcome of one build. */
+struct build_t {
+  double cpu_secs = 0;
+  long obj_bytes = 0, exe_bytes = 0;
+};
+
+/* Build the split program, with or without extern templates.
+   Returns false if any step of the build failed. */
+static bool build(
+    const string &cxx, size_t tus, const string &dir, bool use_extern,
+    build_t &result) {
+  vector<string> common = { cxx, "-std=c++1y", "-O2", "-c" };
+  if (!use_extern) {
+    common.push_back("-DCALC_NO_EXTERN_TEMPLATES");
+  }
+  string prefix = dir + (use_extern ? "/extern_" : "/implicit_");
+  vector<pair<string, string>> units;
+  for (size_t i = 0; i < tus; ++i) {
+    units.emplace_back("calc.test.cc", prefix + "calc_" + to_string(i) + ".o");
+  }
+  units.emplace_back("lick.cc", prefix + "lick.o");
+  if (use_extern) {
+    units.emplace_back("calc.cc", prefix + "calc.o");
+  }
+  vector<string> link = { cxx, "-o", prefix + "calc.test" };
+  for (const auto &unit : units) {
+    auto cmd = common;
+    cmd.insert(cmd.end(), { "-o", unit.second, unit.first });
+    if (!run(cmd, result.cpu_secs)) {
+      cerr << "failed to compile " << unit.first << endl;
+      return false;
+    }
+    result.obj_bytes += get_file_size(unit.second);
+    link.push_back(unit.second);
+  }
+  if (!run(link, result.cpu_secs)) {
+    cerr << "failed to link" << endl;
+    return false;
+  }
+  result.exe_bytes = get_file_size(prefix + "calc.test");
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  const char *env = getenv("CXX");
+  string cxx = env ? env : "clang++";
+  size_t tus = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 8;
+  string dir = (argc > 2) ? argv[2] : "../out/split";
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    cerr << "can't make " << dir << endl;
+    return EXIT_FAILURE;
+  }
+  cout << tus << " copies of calc.test.cc" << endl
+       << setw(10) << "build" << setw(12) << "cpu secs" << setw(14)
+       << "obj bytes" << setw(14) << "exe bytes" << endl;
+  for (bool use_extern : { false, true }) {
+    build_t result;
+    if (!build(cxx, tus, dir, use_extern, result)) {
+      return EXIT_FAILURE;
+    }
+    cout << setw(10) << (use_extern ? "extern" : "implicit") << setw(12)
+         << fixed << setprecision(2) << result.cpu_secs << setw(14)
+         << result.obj_bytes << setw(14) << result.exe_bytes << endl;
+  }
+  return EXIT_SUCCESS;
+}
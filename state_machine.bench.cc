@@ -0,0 +1,127 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Drive a protocol session through a repeating script of events, first with
+a state_machine_t and then the old way, with a binary match() of state and
+event which builds the next state as a new variant.
+
+Usage: state_machine.bench [n]
+--------------------------------------------------------------------------- */
+
+#include <vector>
+
+#include "bench.h"
+#include "state_machine.h"
+
+using namespace std;
+using namespace cppcon14::bench;
+using namespace cppcon14::variant;
+
+/* The states of a session. */
+struct idle_t {};
+struct connecting_t { int attempts; };
+struct open_t { long bytes; };
+struct closing_t {};
+
+/* The events which drive a session. */
+struct connect_t {};
+struct connected_t {};
+struct data_t { int size; };
+struct close_t {};
+struct closed_t {};
+
+using state_t = variant_t<idle_t, connecting_t, open_t, closing_t>;
+using event_t = variant_t<connect_t, connected_t, data_t, close_t, closed_t>;
+
+/* How a session moves from state to state. */
+struct session_t final {
+  connecting_t operator()(idle_t &, const connect_t &) {
+    return connecting_t{1};
+  }
+  void operator()(connecting_t &connecting, const connect_t &) {
+    ++connecting.attempts;
+  }
+  open_t operator()(connecting_t &, const connected_t &) {
+    return open_t{0};
+  }
+  void operator()(open_t &open, const data_t &data) {
+    open.bytes += data.size;
+  }
+  closing_t operator()(open_t &open, const close_t &) {
+    total += open.bytes;
+    return closing_t{};
+  }
+  idle_t operator()(closing_t &, const closed_t &) {
+    return idle_t{};
+  }
+  void on_entry(const open_t &) { ++opened; }
+  long total = 0;
+  long opened = 0;
+};
+
+/* The same transitions, as lambdas for a binary match(). */
+static state_t step(const state_t &state, const event_t &event, long &total) {
+  return match<state_t>(
+      state, event,
+      [](const idle_t &, const connect_t &) {
+        return state_t(connecting_t{1});
+      },
+      [](const connecting_t &connecting, const connect_t &) {
+        return state_t(connecting_t{connecting.attempts + 1});
+      },
+      [](const connecting_t &, const connected_t &) {
+        return state_t(open_t{0});
+      },
+      [](const open_t &open, const data_t &data) {
+        return state_t(open_t{open.bytes + data.size});
+      },
+      [&total](const open_t &open, const close_t &) {
+        total += open.bytes;
+        return state_t(closing_t{});
+      },
+      [](const closing_t &, const closed_t &) {
+        return state_t(idle_t{});
+      },
+      [&state](const auto &, const auto &) { return state; });
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = get_size(argc, argv, 100000000);
+  /* A script of 16 events: 14 transitions and 2 ignored events. */
+  vector<event_t> script = { connect_t{}, connect_t{}, connected_t{} };
+  for (int i = 0; i < 10; ++i) {
+    script.push_back(data_t{i});
+  }  // for
+  script.push_back(close_t{});
+  script.push_back(data_t{101});
+  script.push_back(closed_t{});
+  using machine_t = state_machine_t<session_t, state_t, event_t>;
+  machine_t machine{idle_t{}};
+  measure(cout, "state_machine_t", n, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      machine.fire(script[i % script.size()]);
+    }  // for
+  });
+  keep(machine.get_transitions().total);
+  state_t state = idle_t{};
+  long total = 0;
+  measure(cout, "match, rebuilding the state", n, [&] {
+    for (size_t i = 0; i < n; ++i) {
+      state = step(state, script[i % script.size()], total);
+    }  // for
+  });
+  keep(total);
+  return 0;
+}
@@ -0,0 +1,236 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A finite state machine whose state is a variant of state types and which is
+driven by a variant of event types.
+
+The transitions are a type with an overload of operator() for each (state,
+event) pair it cares about.  Each overload takes a mutable reference to the
+state and a const reference to the event, and returns either:
+
+  * void, in which case the machine stays in the same state, which the
+    overload may have changed in place; or
+  * a new state, of any of the state types, which the machine takes on.
+
+Pairs without an overload are ignored.  If the transitions also have
+on_entry() and on_exit() overloads for a state type, the machine calls them
+as it enters and leaves states of that type.  (A transition which returns a
+new state of the same type leaves and re-enters, but the new state is
+move-assigned over the old in place.)
+
+The machine builds a table, at compile time, of one function for each
+(state, event) pair, so firing an event is one indexed call, with no
+dispatch on the state and then again on the event.
+
+See "state_machine.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace variant {
+
+/* A state machine with the given transitions, whose states are given by a
+   variant_t of state types and whose events by a variant_t of event types. */
+template <typename transitions_t, typename states_t, typename events_t>
+class state_machine_t;
+
+template <typename transitions_t, typename... states_t, typename... events_t>
+class state_machine_t<transitions_t, variant_t<states_t...>,
+                      variant_t<events_t...>> final {
+  public:
+
+  /* The state we're in. */
+  using state_t = variant_t<states_t...>;
+
+  /* An event we can be fed. */
+  using event_t = variant_t<events_t...>;
+
+  /* Start off in the given state, entering it. */
+  explicit state_machine_t(
+      state_t initial, transitions_t transitions = transitions_t())
+      : transitions(std::move(transitions)), state(std::move(initial)) {
+    static constexpr void (*const enterers[])(state_machine_t &) = {
+      &enter_as<states_t>...
+    };
+    enterers[state.get_index()](*this);
+  }
+
+  /* The state we're in. */
+  const state_t &get_state() const noexcept {
+    assert(this);
+    return state;
+  }
+
+  /* The transitions we follow. */
+  transitions_t &get_transitions() noexcept {
+    assert(this);
+    return transitions;
+  }
+
+  /* Follow the transition, if any, for the event in our current state.
+     Returns true if there was one, or false if we ignored the event. */
+  bool fire(const event_t &event) {
+    assert(this);
+    const cell_t *table = get_table(std::make_index_sequence<
+        sizeof...(states_t) * sizeof...(events_t)>());
+    return table[state.get_index() * sizeof...(events_t) + event.get_index()](
+        *this, event);
+  }
+
+  /* As above, but for an event of a type known at compile time, so we need
+     only look up our current state. */
+  template <typename elem_t>
+  std::enable_if_t<index_of<elem_t, events_t...>() < sizeof...(events_t),
+                   bool>
+  fire(const elem_t &event) {
+    assert(this);
+    static constexpr bool (*const cells[])(state_machine_t &,
+                                           const elem_t &) = {
+      &step_as<states_t, elem_t>...
+    };
+    return cells[state.get_index()](*this, event);
+  }
+
+  private:
+
+  /* A cell of the table used by fire(), above. */
+  using cell_t = bool (*)(state_machine_t &, const event_t &);
+
+  /* The table used by fire(), above, with one cell per (state, event) pair,
+     in row-major order. */
+  template <size_t... cells>
+  static const cell_t *get_table(std::index_sequence<cells...>) {
+    static constexpr cell_t table[] = {
+      &cell<cells / sizeof...(events_t), cells % sizeof...(events_t)>...
+    };
+    return table;
+  }
+
+  /* A cell of the table: the state is at position state_idx and the event
+     at position event_idx. */
+  template <size_t state_idx, size_t event_idx>
+  static bool cell(state_machine_t &self, const event_t &event) {
+    return step_as<nth_t<state_idx, states_t...>>(
+        self, *event.template try_as<nth_t<event_idx, events_t...>>());
+  }
+
+  /* Feed an elem_t to the machine while it's in a cur_t state. */
+  template <typename cur_t, typename elem_t>
+  static bool step_as(state_machine_t &self, const elem_t &event) {
+    cur_t *cur = self.state.template try_as<cur_t>();
+    assert(cur);
+    return step(self, *cur, event, 0);
+  }
+
+  /* The transitions have an overload for this pair, so follow it. */
+  template <typename cur_t, typename elem_t>
+  static auto step(state_machine_t &self, cur_t &cur, const elem_t &event,
+                   int)
+      -> decltype(std::declval<transitions_t &>()(cur, event), true) {
+    follow(self, cur, event,
+           identity<decltype(self.transitions(cur, event))>());
+    return true;
+  }
+
+  /* The transitions ignore this pair. */
+  template <typename cur_t, typename elem_t>
+  static bool step(state_machine_t &, cur_t &, const elem_t &, long) {
+    return false;
+  }
+
+  /* The transition returns nothing, so we stay put. */
+  template <typename cur_t, typename elem_t>
+  static void follow(state_machine_t &self, cur_t &cur, const elem_t &event,
+                     identity<void>) {
+    self.transitions(cur, event);
+  }
+
+  /* The transition returns a next state, so we go there. */
+  template <typename cur_t, typename elem_t, typename next_t>
+  static void follow(state_machine_t &self, cur_t &cur, const elem_t &event,
+                     identity<next_t>) {
+    static_assert(
+        index_of<std::decay_t<next_t>, states_t...>() < sizeof...(states_t),
+        "A transition must return void or one of the state types.");
+    become(self, cur, self.transitions(cur, event));
+  }
+
+  /* Move from a state to another of the same type, in place. */
+  template <typename cur_t>
+  static void become(state_machine_t &self, cur_t &cur, cur_t &&next) {
+    exit(self.transitions, cur, 0);
+    cur = std::move(next);
+    enter(self.transitions, cur, 0);
+  }
+
+  /* Move from a state to one of another type. */
+  template <typename cur_t, typename next_t>
+  static void become(state_machine_t &self, cur_t &cur, next_t &&next) {
+    exit(self.transitions, cur, 0);
+    enter(self.transitions,
+          self.state.template emplace<std::decay_t<next_t>>(
+              std::forward<next_t>(next)),
+          0);
+  }
+
+  /* Enter our current state, which is a cur_t. */
+  template <typename cur_t>
+  static void enter_as(state_machine_t &self) {
+    enter(self.transitions, *self.state.template try_as<cur_t>(), 0);
+  }
+
+  /* Call the entry hook for the state, if there is one.  (We take the
+     transitions by a type of our own so that looking up the hook is
+     deferred until we're called, and so can fail quietly.) */
+  template <typename some_transitions_t, typename cur_t>
+  static auto enter(some_transitions_t &transitions, cur_t &cur, int)
+      -> decltype(transitions.on_entry(cur), void()) {
+    transitions.on_entry(cur);
+  }
+
+  /* There's no entry hook for the state. */
+  template <typename some_transitions_t, typename cur_t>
+  static void enter(some_transitions_t &, cur_t &, long) {}
+
+  /* Call the exit hook for the state, if there is one. */
+  template <typename some_transitions_t, typename cur_t>
+  static auto exit(some_transitions_t &transitions, cur_t &cur, int)
+      -> decltype(transitions.on_exit(cur), void()) {
+    transitions.on_exit(cur);
+  }
+
+  /* There's no exit hook for the state. */
+  template <typename some_transitions_t, typename cur_t>
+  static void exit(some_transitions_t &, cur_t &, long) {}
+
+  /* See accessor. */
+  transitions_t transitions;
+
+  /* See accessor. */
+  state_t state;
+
+};  // state_machine_t<transitions_t, variant_t<states_t...>,
+    //                 variant_t<events_t...>>
+
+}  // variant
+}  // cppcon14
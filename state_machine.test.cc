@@ -0,0 +1,108 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the state machine in "state_machine.h".
+--------------------------------------------------------------------------- */
+
+#include "state_machine.h"
+
+#include <string>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+
+/* The states of a connection. */
+struct idle_t {};
+struct connecting_t { int attempts; };
+struct open_t { int bytes; };
+
+/* The events which drive a connection. */
+struct connect_t {};
+struct connected_t {};
+struct data_t { int size; };
+struct close_t {};
+
+/* How a connection moves from state to state.  It writes down the hooks it
+   runs. */
+struct session_t final {
+  connecting_t operator()(idle_t &, const connect_t &) {
+    return connecting_t{1};
+  }
+  void operator()(connecting_t &connecting, const connect_t &) {
+    ++connecting.attempts;
+  }
+  open_t operator()(connecting_t &, const connected_t &) {
+    return open_t{0};
+  }
+  void operator()(open_t &open, const data_t &data) {
+    open.bytes += data.size;
+  }
+  open_t operator()(open_t &, const connected_t &) {
+    return open_t{0};
+  }
+  template <typename state_t>
+  idle_t operator()(state_t &, const close_t &) {
+    return idle_t{};
+  }
+  void on_entry(const open_t &) { log += "+open "; }
+  void on_exit(const open_t &) { log += "-open "; }
+  void on_entry(const idle_t &) { log += "+idle "; }
+  string log;
+};
+
+/* A connection. */
+using machine_t = state_machine_t<session_t,
+                                  variant_t<idle_t, connecting_t, open_t>,
+                                  variant_t<connect_t, connected_t, data_t,
+                                            close_t>>;
+
+FIXTURE(machine_transitions) {
+  machine_t machine{idle_t{}};
+  EXPECT_EQ(machine.get_transitions().log, "+idle ");
+  EXPECT_TRUE(machine.fire(machine_t::event_t(connect_t{})));
+  EXPECT_TRUE(machine.get_state().try_as<connecting_t>());
+  EXPECT_TRUE(machine.fire(machine_t::event_t(connected_t{})));
+  EXPECT_TRUE(machine.get_state().try_as<open_t>());
+  EXPECT_TRUE(machine.fire(machine_t::event_t(close_t{})));
+  EXPECT_TRUE(machine.get_state().try_as<idle_t>());
+  EXPECT_EQ(machine.get_transitions().log, "+idle +open -open +idle ");
+}
+
+FIXTURE(machine_in_place) {
+  machine_t machine{connecting_t{1}};
+  EXPECT_TRUE(machine.fire(connect_t{}));
+  EXPECT_TRUE(machine.fire(connect_t{}));
+  EXPECT_EQ(machine.get_state().as<connecting_t>().attempts, 3);
+  machine.fire(connected_t{});
+  machine.fire(data_t{10});
+  machine.fire(data_t{20});
+  EXPECT_EQ(machine.get_state().as<open_t>().bytes, 30);
+}
+
+FIXTURE(machine_same_type) {
+  machine_t machine{open_t{5}};
+  EXPECT_TRUE(machine.fire(connected_t{}));
+  EXPECT_EQ(machine.get_state().as<open_t>().bytes, 0);
+  EXPECT_EQ(machine.get_transitions().log, "+open -open +open ");
+}
+
+FIXTURE(machine_ignores) {
+  machine_t machine{idle_t{}};
+  EXPECT_FALSE(machine.fire(data_t{10}));
+  EXPECT_FALSE(machine.fire(machine_t::event_t(connected_t{})));
+  EXPECT_TRUE(machine.get_state().try_as<idle_t>());
+}
@@ -0,0 +1,170 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Interned strings, for the names of the calculator and its string literals.
+
+A symbol_t is a dense integer id standing for a string.  Making one looks
+the string up in a table shared by the whole program, adding it if it's new,
+so equal strings always get the same id, and the ids of n distinct strings
+are 0 through n - 1.  After that, copying, comparing and hashing a symbol
+are all just those of an int, and its string is stored once, however many
+symbols stand for it.  Strings are never removed from the table.
+
+The table is guarded by a mutex, so symbols may be made on any thread.
+
+See "symbol.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cppcon14 {
+namespace calc {
+
+/* A string, interned. */
+class symbol_t final {
+  public:
+
+  /* The type of an id. */
+  using id_t = uint32_t;
+
+  /* Hashes a symbol by its id. */
+  struct hash_t final {
+    size_t operator()(symbol_t that) const noexcept {
+      return that.id;
+    }
+  };
+
+  /* The empty string. */
+  symbol_t() noexcept
+      : id(0) {}
+
+  /* The given string. */
+  symbol_t(const std::string &name)
+      : id(get_table().intern(name)) {}
+
+  symbol_t(const char *name)
+      : symbol_t(std::string(name)) {}
+
+  /* The size characters at start. */
+  symbol_t(const char *start, size_t size)
+      : symbol_t(std::string(start, size)) {}
+
+  /* Our id. */
+  id_t get_id() const noexcept {
+    return id;
+  }
+
+  /* The string we stand for.  It lasts as long as the program does. */
+  const std::string &get_name() const {
+    return get_table().get_name(id);
+  }
+
+  /* The number of distinct strings interned so far. */
+  static size_t get_count() {
+    return get_table().get_count();
+  }
+
+  /* Comparisons, by id.  Less-than orders symbols by when they were first
+     interned, not alphabetically. */
+  friend bool operator==(symbol_t lhs, symbol_t rhs) noexcept {
+    return lhs.id == rhs.id;
+  }
+
+  friend bool operator!=(symbol_t lhs, symbol_t rhs) noexcept {
+    return lhs.id != rhs.id;
+  }
+
+  friend bool operator<(symbol_t lhs, symbol_t rhs) noexcept {
+    return lhs.id < rhs.id;
+  }
+
+  /* Write the string we stand for. */
+  friend std::ostream &operator<<(std::ostream &strm, symbol_t that) {
+    return strm << that.get_name();
+  }
+
+  private:
+
+  /* The strings and their ids. */
+  class table_t final {
+    public:
+
+    /* Start with just the empty string, which gets id 0. */
+    table_t() {
+      intern(std::string());
+    }
+
+    /* The id of the string, adding it if it's new. */
+    id_t intern(const std::string &name) {
+      assert(this);
+      std::lock_guard<std::mutex> lock(mutex);
+      auto result = ids.emplace(name, static_cast<id_t>(names.size()));
+      if (result.second) {
+        names.push_back(&result.first->first);
+      }  // if
+      return result.first->second;
+    }
+
+    /* The string with the id. */
+    const std::string &get_name(id_t id) {
+      assert(this);
+      std::lock_guard<std::mutex> lock(mutex);
+      assert(id < names.size());
+      return *names[id];
+    }
+
+    /* The number of strings. */
+    size_t get_count() {
+      assert(this);
+      std::lock_guard<std::mutex> lock(mutex);
+      return names.size();
+    }
+
+    private:
+
+    /* Guards the rest. */
+    std::mutex mutex;
+
+    /* The id of each string. */
+    std::unordered_map<std::string, id_t> ids;
+
+    /* Each string, by its id, pointing at the key in ids, which, being in
+       a node of its own, never moves. */
+    std::vector<const std::string *> names;
+
+  };  // table_t
+
+  /* The one table. */
+  static table_t &get_table() {
+    static table_t table;
+    return table;
+  }
+
+  /* The id of our string. */
+  id_t id;
+
+};  // symbol_t
+
+}  // calc
+}  // cppcon14
@@ -0,0 +1,85 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of the interning in "symbol.h".
+--------------------------------------------------------------------------- */
+
+#include "symbol.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::calc;
+
+FIXTURE(intern) {
+  EXPECT_EQ(symbol_t().get_id(), 0u);
+  EXPECT_EQ(symbol_t().get_name(), "");
+  EXPECT_TRUE(symbol_t("") == symbol_t());
+  size_t count = symbol_t::get_count();
+  symbol_t alpha("alpha"), beta(string("beta"));
+  /* Equal strings, however spelled, get the same id. */
+  const char text[] = "alphabet";
+  EXPECT_TRUE(symbol_t(text, 5) == alpha);
+  EXPECT_TRUE(symbol_t("beta") == beta);
+  EXPECT_TRUE(alpha != beta);
+  /* New strings get the next ids in turn. */
+  EXPECT_EQ(symbol_t::get_count(), count + 2);
+  EXPECT_EQ(alpha.get_id(), count);
+  EXPECT_EQ(beta.get_id(), count + 1);
+  EXPECT_TRUE(alpha < beta);
+  EXPECT_EQ(alpha.get_name(), "alpha");
+  EXPECT_EQ(beta.get_name(), "beta");
+  EXPECT_EQ(symbol_t::hash_t()(beta), beta.get_id());
+  ostringstream strm;
+  strm << alpha << ' ' << beta;
+  EXPECT_EQ(strm.str(), "alpha beta");
+}
+
+FIXTURE(threads) {
+  /* Threads interning the same strings all at once get the same ids, and
+     the ids stay dense. */
+  size_t count = symbol_t::get_count();
+  const size_t thread_count = 4, name_count = 1000;
+  vector<vector<symbol_t>> results(thread_count);
+  vector<thread> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&results, i] {
+      for (size_t j = 0; j < name_count; ++j) {
+        results[i].emplace_back("threads_" + to_string(j));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(symbol_t::get_count(), count + name_count);
+  unordered_set<symbol_t, symbol_t::hash_t> distinct;
+  for (size_t j = 0; j < name_count; ++j) {
+    for (size_t i = 1; i < thread_count; ++i) {
+      EXPECT_TRUE(results[i][j] == results[0][j]);
+    }
+    EXPECT_EQ(results[0][j].get_name(), "threads_" + to_string(j));
+    EXPECT_GE(results[0][j].get_id(), count);
+    EXPECT_LT(results[0][j].get_id(), count + name_count);
+    distinct.insert(results[0][j]);
+  }
+  EXPECT_EQ(distinct.size(), name_count);
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "horse.h"
+#include "variant.h"
+
 // ---------------------------------------------------------------------------
 // "car.h"
 
@@ -18,22 +21,12 @@ struct plane_t {
 // ---------------------------------------------------------------------------
 
 
-// ---------------------------------------------------------------------------
-// "horse.h"
-
-struct horse_t {
-  // stuff about neighing, running fast, and carrying people and cargo
-};
-// ---------------------------------------------------------------------------
-
-
 // ---------------------------------------------------------------------------
 // "transport.h"
 
 /*
 #include "car.h"
 #include "plane.h"
-#include "horse.h"
 */
 
 using transport_t = cppcon14::variant::variant_t<car_t, plane_t, horse_t>;
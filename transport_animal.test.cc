@@ -9,5 +9,11 @@ FIXTURE(transport_animal) {
   EXPECT_TRUE(can_transport_animal(transport, animal));
   animal = horse_t();
   EXPECT_FALSE(can_transport_animal(transport, animal));
+  transport = horse_t();
+  EXPECT_FALSE(can_transport_animal(transport, animal));
+  animal = cat_t();
+  EXPECT_TRUE(can_transport_animal(transport, animal));
+  transport = plane_t();
+  EXPECT_FALSE(can_transport_animal(transport, animal));
 }
 
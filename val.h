@@ -18,10 +18,14 @@ TODO
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <sstream>
-#include <std::string>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "symbol.h"
 #include "variant.h"
 
 namespace cppcon14 {
@@ -35,15 +39,19 @@ TODO
 struct expr_t;
 using expr_ptr_t = std::shared_ptr<expr_t>;
 
+/* Forward-declaration of the value type, for the benefit of the tokens. */
+struct val_t;
+using val_ptr_t = std::shared_ptr<val_t>;
+
 /* TODO */
 struct lambda_t final {
 
-  /* TODO */
-  using params_t = std::vector<std::string>;
+  /* The names of the parameters, interned. */
+  using params_t = std::vector<symbol_t>;
 
   /* TODO */
   lambda_t(params_t &&params, const expr_ptr_t &def)
-      : params(move(params)), def(move(def)) {}
+      : params(std::move(params)), def(def) {}
 
   /* TODO */
   params_t params;
@@ -53,9 +61,13 @@ struct lambda_t final {
 
 };  // lambda_t
 
+/* The variant underlying val_t. */
+using val_variant_t =
+    variant::variant_t<int, std::string, lambda_t, variant::null_t>;
+
 /* TODO */
 struct val_t final
-    : variant_t<int, std::string, lambda_t> {
+    : val_variant_t {
   using variant_t::variant_t;
 };
 
@@ -83,14 +95,24 @@ struct null_value_error_t final
 
 };  // null_value_error_t
 
+/* TODO */
+struct undef_ref_error_t final
+    : std::runtime_error {
+
+  /* TODO */
+  undef_ref_error_t()
+      : runtime_error("undefined ref error") {}
+
+};  // undef_ref_error_t
+
 /* TODO */
 struct unary_val_functor_t {
 
   /* TODO */
-  using fn1_t = val_t ();
+  using ret_t = val_t;
 
   /* TODO */
-  val_t operator()(nullptr_t) const {
+  val_t operator()(variant::null_t) const {
     throw null_value_error_t();
   }
 
@@ -106,22 +128,22 @@ struct unary_val_functor_t {
 struct binary_val_functor_t {
 
   /* TODO */
-  using fn2_t = val_t ();
+  using ret_t = val_t;
 
   /* TODO */
-  val_t operator()(nullptr_t, nullptr_t) const {
+  val_t operator()(variant::null_t, variant::null_t) const {
     throw null_value_error_t();
   }
 
   /* TODO */
   template <typename lhs_t>
-  val_t operator()(const lhs_t &, nullptr_t) const {
+  val_t operator()(const lhs_t &, variant::null_t) const {
     throw null_value_error_t();
   }
 
   /* TODO */
   template <typename rhs_t>
-  val_t operator()(nullptr_t, const rhs_t &) const {
+  val_t operator()(variant::null_t, const rhs_t &) const {
     throw null_value_error_t();
   }
 
@@ -163,7 +185,7 @@ struct to_int_t final
     return that;
   }
   val_t operator()(const std::string &that) const {
-    return stoi(that);
+    return std::stoi(that);
   }
 };
 
@@ -172,7 +194,7 @@ struct to_str_t final
     : unary_val_functor_t {
   using unary_val_functor_t::operator();
   val_t operator()(int that) const {
-    std::ostd::stringstream strm;
+    std::ostringstream strm;
     strm << that;
     return strm.str();
   }
@@ -205,7 +227,7 @@ struct mul_t final
     return lhs * rhs;
   }
   val_t operator()(const std::string &lhs, int rhs) const {
-    std::ostd::stringstream strm;
+    std::ostringstream strm;
     for (int i = 0; i < rhs; ++i) {
       strm << lhs;
     }
@@ -245,3 +267,33 @@ struct lt_t final
 
 }  // calc
 }  // cppcon14
+
+/* The variant underlying val_t, and the functors above as applied to it,
+   are instantiated just once, in "calc.cc". */
+#ifndef CALC_NO_EXTERN_TEMPLATES
+CPPCON14_VARIANT_EXTERN(
+    int, std::string, cppcon14::calc::lambda_t, cppcon14::variant::null_t);
+CPPCON14_VARIANT_EXTERN_APPLY(
+    cppcon14::calc::neg_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(
+    cppcon14::calc::not_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(
+    cppcon14::calc::to_int_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(
+    cppcon14::calc::to_str_t, cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(cppcon14::calc::add_t,
+                              cppcon14::calc::val_variant_t,
+                              cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(cppcon14::calc::mul_t,
+                              cppcon14::calc::val_variant_t,
+                              cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(cppcon14::calc::and_t,
+                              cppcon14::calc::val_variant_t,
+                              cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(cppcon14::calc::or_t,
+                              cppcon14::calc::val_variant_t,
+                              cppcon14::calc::val_variant_t);
+CPPCON14_VARIANT_EXTERN_APPLY(cppcon14::calc::lt_t,
+                              cppcon14::calc::val_variant_t,
+                              cppcon14::calc::val_variant_t);
+#endif
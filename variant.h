@@ -23,6 +23,8 @@ See "variant.test.cc" for examples of use.
 #include <cassert>
 #include <cstddef>
 #include <initializer_list>
+#include <memory>
+#include <new>
 #include <tuple>
 #include <type_traits>
 #include <typeinfo>
@@ -69,6 +71,46 @@ constexpr T max(std::initializer_list<T> elems) {
   return *max_element(std::begin(elems), std::end(elems));
 }
 
+/* How uninitialized_construct_using_allocator(), below, hands an allocator
+   to a T: not at all (0), after std::allocator_arg (1), or last (2). */
+template <typename T, typename alloc_t, typename... args_t>
+using uses_allocator_kind = std::integral_constant<
+    int,
+    !std::uses_allocator<T, alloc_t>::value ? 0 :
+    std::is_constructible<T, std::allocator_arg_t, const alloc_t &,
+                          args_t...>::value ? 1 : 2>;
+
+template <typename T, typename alloc_t, typename... args_t>
+T *construct_using_allocator_impl(T *ptr, const alloc_t &,
+                                  std::integral_constant<int, 0>,
+                                  args_t &&... args) {
+  return new (ptr) T(std::forward<args_t>(args)...);
+}
+
+template <typename T, typename alloc_t, typename... args_t>
+T *construct_using_allocator_impl(T *ptr, const alloc_t &alloc,
+                                  std::integral_constant<int, 1>,
+                                  args_t &&... args) {
+  return new (ptr) T(std::allocator_arg, alloc, std::forward<args_t>(args)...);
+}
+
+template <typename T, typename alloc_t, typename... args_t>
+T *construct_using_allocator_impl(T *ptr, const alloc_t &alloc,
+                                  std::integral_constant<int, 2>,
+                                  args_t &&... args) {
+  return new (ptr) T(std::forward<args_t>(args)..., alloc);
+}
+
+/* C++20 std::uninitialized_construct_using_allocator.  Construct a T at ptr
+   from args, handing it alloc as well if it uses allocators of that type. */
+template <typename T, typename alloc_t, typename... args_t>
+T *uninitialized_construct_using_allocator(T *ptr, const alloc_t &alloc,
+                                           args_t &&... args) {
+  return construct_using_allocator_impl(
+      ptr, alloc, uses_allocator_kind<T, alloc_t, args_t...>(),
+      std::forward<args_t>(args)...);
+}
+
 }  // lib
 
 namespace cppcon14 {
@@ -81,67 +123,164 @@ struct identity { using type = T; };
 /* The type that represents the null state. */
 struct null_t {};
 
+/* True iff. all the given conditions are true. */
+template <bool... conds>
+using all_of = std::is_same<std::integer_sequence<bool, true, conds...>,
+                            std::integer_sequence<bool, conds..., true>>;
+
+/* True iff. any of the given conditions is true. */
+template <bool... conds>
+using any_of = std::integral_constant<
+    bool, !std::is_same<std::integer_sequence<bool, false, conds...>,
+                        std::integer_sequence<bool, conds..., false>>::value>;
+
+/* True iff. the first of args_t is std::allocator_arg_t, meaning the rest
+   start with an allocator. */
+template <typename... args_t>
+struct leads_with_allocator_arg : std::false_type {};
+
+template <typename arg_t, typename... args_t>
+struct leads_with_allocator_arg<arg_t, args_t...>
+    : std::is_same<std::decay_t<arg_t>, std::allocator_arg_t> {};
+
+/* The position of elem_t among elems_t, or sizeof...(elems_t) if it isn't
+   there.  A variant uses this to number its states. */
+template <typename elem_t, typename... elems_t>
+constexpr size_t index_of() {
+  constexpr bool matches[] = { std::is_same<elem_t, elems_t>::value..., true };
+  size_t idx = 0;
+  while (!matches[idx]) {
+    ++idx;
+  }  // while
+  return idx;
+}
+
+/* ---------------------------------------------------------------------------
+Picking a type out of a pack by position.  We do this by inheriting from one
+indexed_t per type, all at once, and letting overload resolution find the
+base with the right index.  Unlike peeling off one type at a time, this
+doesn't nest instantiations, so the depth stays constant no matter how many
+types there are.
+--------------------------------------------------------------------------- */
+
+/* A type, tagged with its position in a pack. */
+template <size_t idx, typename elem_t>
+struct indexed_t { using type = elem_t; };
+
+/* Inherits one indexed_t for each type in a pack. */
+template <typename idxs_t, typename... elems_t>
+struct indexer_t;
+
+template <size_t... idxs, typename... elems_t>
+struct indexer_t<std::index_sequence<idxs...>, elems_t...>
+    : indexed_t<idxs, elems_t>... {};
+
+/* Never defined; used only to pick a base out of an indexer_t. */
+template <size_t idx, typename elem_t>
+indexed_t<idx, elem_t> select_indexed(const indexed_t<idx, elem_t> &);
+
+/* The type at position idx in elems_t. */
+template <size_t idx, typename... elems_t>
+using nth_t = typename decltype(select_indexed<idx>(
+    indexer_t<std::index_sequence_for<elems_t...>, elems_t...>()))::type;
+
 /**
  *  The base class for all visitors to variants.
  **/
 
-/* We'll define the visitor class recursively. */
-template <typename elem_t, typename... elems_t>
-struct visitor_t;
-
-/* The base case. */
+/* Handles one type of element. */
 template <typename elem_t>
-struct visitor_t<elem_t> {
+struct visitor_leaf_t {
 
   /* Override to handle an elem_t. */
   virtual void operator()(const elem_t &) const = 0;
 
-};  // visitor_t<elem_t>
+};  // visitor_leaf_t<elem_t>
 
-/* Each iteration of the recursive case handles one type of element. */
-template <typename elem_t, typename... more_elems_t>
-struct visitor_t : visitor_t<more_elems_t...> {
+/* Inherits a handler for each type of element, all at once rather than
+   recursively, so the depth of instantiation stays constant.  A derived
+   visitor overrides every handler, but the overloads aren't brought together
+   here, so a variant dispatches to a handler by way of its leaf. */
+template <typename... elems_t>
+struct visitor_t : visitor_leaf_t<elems_t>... {};
 
-  /* Pull the operator() overloads above us into scope. */
-  using visitor_t<more_elems_t...>::operator();
+/* ---------------------------------------------------------------------------
+A class that inherits from lambdas and results in an overloaded lambda.  To
+bring all the operator() overloads into scope, each node has to pull them up
+with a using declaration, so we can't inherit from the lambdas all at once.
+Instead, we build a balanced tree, splitting the lambdas in half at each
+node, so the depth of instantiation is logarithmic in the number of lambdas.
+--------------------------------------------------------------------------- */
 
-  /* Override to handle an elem_t. */
-  virtual void operator()(const elem_t &) const = 0;
+/* A lambda, tagged with its position, waiting to be moved into a leaf. */
+template <size_t idx, typename lambda_t>
+struct indexed_lambda_t { lambda_t *ptr; };
 
-};  // visitor_t
+/* The lambdas handed to make_overload(), collected for the tree's nodes. */
+template <typename idxs_t, typename... lambdas_t>
+struct lambda_pack_t;
 
-/* A class that inherits from lambdas and results in an overloaded lambda. */
-template <typename ret_t, typename... lambdas_t>
-struct overload_t;
+template <size_t... idxs, typename... lambdas_t>
+struct lambda_pack_t<std::index_sequence<idxs...>, lambdas_t...>
+    : indexed_lambda_t<idxs, lambdas_t>... {
+  lambda_pack_t(lambdas_t &... lambdas)
+      : indexed_lambda_t<idxs, lambdas_t>{&lambdas}... {}
+};
 
-/* Base case. */
-template <typename ret_t_, typename lambda_t>
-struct overload_t<ret_t_, lambda_t> : lambda_t {
+/* A node covering the lambdas in [begin, begin + size). */
+template <size_t begin, size_t size, typename... lambdas_t>
+struct overload_node_t
+    : overload_node_t<begin, size / 2, lambdas_t...>,
+      overload_node_t<begin + size / 2, size - size / 2, lambdas_t...> {
 
-  /* Used to look-up the expected return type of the lambdas. */
-  using ret_t = ret_t_;
+  using lhs_t = overload_node_t<begin, size / 2, lambdas_t...>;
+  using rhs_t = overload_node_t<begin + size / 2, size - size / 2, lambdas_t...>;
 
-  using lambda_t::operator();
+  using lhs_t::operator();
+  using rhs_t::operator();
 
-  overload_t(lambda_t lambda) : lambda_t(std::move(lambda)) {}
+  /* Hand the lambdas down to the leaves. */
+  template <typename pack_t>
+  overload_node_t(const pack_t &pack) : lhs_t(pack), rhs_t(pack) {}
 
-};  // overload_t<ret_t_, lambda_t>
+};  // overload_node_t<begin, size, lambdas_t...>
 
-/* Recursive case. */
-template <typename ret_t, typename lambda_t, typename... more_lambdas_t>
-struct overload_t<ret_t, lambda_t, more_lambdas_t...>
-    : lambda_t, overload_t<ret_t, more_lambdas_t...> {
+/* A leaf, which is one of the lambdas. */
+template <size_t begin, typename... lambdas_t>
+struct overload_node_t<begin, 1, lambdas_t...>
+    : nth_t<begin, lambdas_t...> {
 
-  using super_t = overload_t<ret_t, more_lambdas_t...>;
+  using lambda_t = nth_t<begin, lambdas_t...>;
 
   using lambda_t::operator();
-  using super_t::operator();
+
+  /* Move our lambda out of the pack. */
+  template <typename pack_t>
+  overload_node_t(const pack_t &pack)
+      : lambda_t(std::move(
+            *static_cast<const indexed_lambda_t<begin, lambda_t> &>(pack)
+                 .ptr)) {}
+
+};  // overload_node_t<begin, 1, lambdas_t...>
+
+/* The overloaded lambda itself. */
+template <typename ret_t_, typename... lambdas_t>
+struct overload_t final
+    : overload_node_t<0, sizeof...(lambdas_t), lambdas_t...> {
+
+  using root_t = overload_node_t<0, sizeof...(lambdas_t), lambdas_t...>;
+
+  /* Used to look-up the expected return type of the lambdas. */
+  using ret_t = ret_t_;
+
+  using root_t::operator();
 
   /* Cache the lambdas. */
-  overload_t(lambda_t lambda, more_lambdas_t... more_lambdas)
-      : lambda_t(std::move(lambda)), super_t(std::move(more_lambdas)...) {}
+  overload_t(lambdas_t... lambdas)
+      : root_t(lambda_pack_t<std::index_sequence_for<lambdas_t...>,
+                             lambdas_t...>(lambdas...)) {}
 
-};  // overload<ret_t, lambda_t, more_lambdas_t...>
+};  // overload_t<ret_t_, lambdas_t...>
 
 /* Factory function for overload. */
 template <typename ret_t, typename... lambdas_t>
@@ -150,6 +289,10 @@ auto make_overload(lambdas_t &&... lambdas) {
       std::forward<lambdas_t>(lambdas)...);
 }
 
+/* Defined below, but variant_t needs to befriend it. */
+template <typename ret_t, typename functor_t, typename... variants_t>
+struct applier_t;
+
 /**
  *  The variant class template itself.
  **/
@@ -174,6 +317,32 @@ class variant_t {
   static_assert(sizeof...(elems_t) > contains<null_t>::value,
                 "We need at least 1 state, and more than 1 if we are nullable.");
 
+  /* Variants of other types are our friends, so we can convert to and from
+     them without going through the public interface. */
+  template <typename... that_elems_t>
+  friend class variant_t;
+
+  /* The applier reaches straight into our storage. */
+  template <typename ret_t, typename functor_t, typename... variants_t>
+  friend struct applier_t;
+
+  /* True iff. we can hold every state of a variant_t<that_elems_t...>, so
+     converting from one can never fail.  We don't count ourselves, as we
+     have proper copy and move constructors for that. */
+  template <typename... that_elems_t>
+  using is_widening = std::integral_constant<
+      bool,
+      all_of<contains<that_elems_t>::value...>::value &&
+      !std::is_same<variant_t, variant_t<that_elems_t...>>::value>;
+
+  /* True iff. we share some, but not all, of the states of a
+     variant_t<that_elems_t...>, so converting from one might fail. */
+  template <typename... that_elems_t>
+  using is_narrowing = std::integral_constant<
+      bool,
+      any_of<contains<that_elems_t>::value...>::value &&
+      !all_of<contains<that_elems_t>::value...>::value>;
+
   public:
 
   /* The type of visitor we accept. */
@@ -196,6 +365,47 @@ class variant_t {
     tag = get_tag<std::decay_t<elem_t>>();
   }
 
+  /* The allocator-extended constructors.  We don't keep an allocator
+     ourselves, but we hand the given one to our contents as we construct
+     them, if their type uses allocators of that type.  This is
+     uses-allocator construction, as in the standard library, and
+     std::uses_allocator is specialized for variants (see below), so
+     containers and polymorphic allocators use these for us. */
+
+  /* Construct to a null state.  Only provided if we are nullable. */
+  template <typename alloc_t, typename T = null_t,
+            typename = std::enable_if_t<contains<T>::value>>
+  variant_t(std::allocator_arg_t, const alloc_t &) noexcept {
+    tag = get_null_tag();
+  }
+
+  /* Construct off of an element, handing it the allocator. */
+  template <typename alloc_t, typename elem_t,
+            typename = std::enable_if_t<contains<std::decay_t<elem_t>>::value>>
+  variant_t(std::allocator_arg_t, const alloc_t &alloc, elem_t &&elem) {
+    assert(&elem);
+    construct_elem<std::decay_t<elem_t>>(alloc, std::forward<elem_t>(elem));
+  }
+
+  /* Move-construct, handing our new contents the allocator, and leaving
+     the donor null if it has a null state.  Whether the donor's resources
+     can be taken over or must be copied is up to the contents. */
+  template <typename alloc_t>
+  variant_t(std::allocator_arg_t, const alloc_t &alloc, variant_t &&that) {
+    construct_from(alloc, std::move(that));
+    make_overload<void>(
+        [](std::true_type, auto &that) { that.reset(); },
+        [](std::false_type, auto &) {})(contains<null_t>(), that);
+  }
+
+  /* Copy-construct, handing our copy of the contents the allocator.  A
+     plain copy would give it whatever allocator its type chooses for
+     copies, which for polymorphic allocators is the global heap. */
+  template <typename alloc_t>
+  variant_t(std::allocator_arg_t, const alloc_t &alloc, const variant_t &that) {
+    construct_from(alloc, that);
+  }
+
   /* Move-construct, leaving the donor null if it has a null state. */
   variant_t(variant_t &&that) noexcept {
     tag = that.tag;
@@ -208,6 +418,42 @@ class variant_t {
     tag = that.tag;
   }
 
+  /* Move-construct from a variant whose states are a subset of ours, leaving
+     the donor null if it has a null state.  This is a widening, so it's
+     implicit and can't fail. */
+  template <typename... that_elems_t,
+            typename = std::enable_if_t<is_widening<that_elems_t...>::value>>
+  variant_t(variant_t<that_elems_t...> &&that) noexcept {
+    convert(std::move(that));
+  }
+
+  /* Copy-construct from a variant whose states are a subset of ours, leaving
+     the exemplar intact. */
+  template <typename... that_elems_t,
+            typename = std::enable_if_t<is_widening<that_elems_t...>::value>>
+  variant_t(const variant_t<that_elems_t...> &that) {
+    convert(that);
+  }
+
+  /* Move-construct from a variant which has states we lack.  This is a
+     narrowing, so it must be asked for explicitly.  If the donor is in a
+     state we can't hold, throw std::bad_cast and leave the donor intact. */
+  template <typename... that_elems_t,
+            typename = std::enable_if_t<is_narrowing<that_elems_t...>::value>,
+            typename = void>
+  explicit variant_t(variant_t<that_elems_t...> &&that) {
+    convert(std::move(that));
+  }
+
+  /* Copy-construct from a variant which has states we lack.  If the
+     exemplar is in a state we can't hold, throw std::bad_cast. */
+  template <typename... that_elems_t,
+            typename = std::enable_if_t<is_narrowing<that_elems_t...>::value>,
+            typename = void>
+  explicit variant_t(const variant_t<that_elems_t...> &that) {
+    convert(that);
+  }
+
   /* Destroy. */
   virtual ~variant_t() {
     assert(this);
@@ -243,6 +489,28 @@ class variant_t {
     return *this;
   }
 
+  /* Move-assign from a variant whose states are a subset of ours, leaving
+     the donor null if it has a null state. */
+  template <typename... that_elems_t,
+            typename = std::enable_if_t<is_widening<that_elems_t...>::value>>
+  variant_t &operator=(variant_t<that_elems_t...> &&that) noexcept {
+    assert(this);
+    assert(&that);
+    (tag->destroy)(*this);
+    convert(std::move(that));
+    return *this;
+  }
+
+  /* Copy-assign from a variant whose states are a subset of ours, leaving
+     the exemplar intact. */
+  template <typename... that_elems_t,
+            typename = std::enable_if_t<is_widening<that_elems_t...>::value>>
+  variant_t &operator=(const variant_t<that_elems_t...> &that) {
+    assert(this);
+    assert(&that);
+    return *this = variant_t(that);
+  }
+
   /* Accept the visitor and dispatch based on our contents. */
   void accept(const visitor_t &visitor) const {
     assert(this);
@@ -269,6 +537,13 @@ class variant_t {
     return (tag->get_type_info)();
   }
 
+  /* The position among our elems_t of the type of our contents.  If we're
+     null, this is the position of null_t. */
+  size_t get_index() const noexcept {
+    assert(this);
+    return tag->index;
+  }
+
   /* Be null. */
   template <typename..., typename T = null_t>
   std::enable_if_t<contains<T>::value, variant_t &> &reset() noexcept {
@@ -285,10 +560,48 @@ class variant_t {
   template <typename elem_t>
   std::enable_if_t<contains<elem_t>::value, const elem_t *> try_as() const {
     assert(this);
-    return apply(
-        make_overload<const elem_t *>([](const elem_t &val) { return &val; },
-                                      [](const auto &) { return nullptr; }),
-        *this);
+    return (tag->index == index_of<elem_t, elems_t...>())
+               ? &force_as<elem_t>()
+               : nullptr;
+  }
+
+  /* As above, but for a mutable variant, so the contents can be changed in
+     place.  Changing them doesn't change which state we're in. */
+  template <typename elem_t>
+  std::enable_if_t<contains<elem_t>::value, elem_t *> try_as() {
+    assert(this);
+    return (tag->index == index_of<elem_t, elems_t...>())
+               ? &force_as<elem_t>()
+               : nullptr;
+  }
+
+  /* Destroy our contents and construct an elem_t in their place, without
+     going through a temporary variant, and return the new contents.  If the
+     construction throws, we're left null; or, if we can't be null, fit only
+     to be destroyed or assigned to. */
+  template <typename elem_t, typename... args_t>
+  std::enable_if_t<contains<elem_t>::value &&
+                   !leads_with_allocator_arg<args_t...>::value,
+                   elem_t &> emplace(args_t &&... args) {
+    assert(this);
+    (tag->destroy)(*this);
+    tag = get_null_tag();
+    elem_t *elem = new (data) elem_t(std::forward<args_t>(args)...);
+    if (!std::is_same<elem_t, null_t>::value) {
+      tag = get_tag<elem_t>();
+    }  // if
+    return *elem;
+  }
+
+  /* As above, but handing the new contents the allocator, if their type uses
+     allocators of that type. */
+  template <typename elem_t, typename alloc_t, typename... args_t>
+  std::enable_if_t<contains<elem_t>::value, elem_t &> emplace(
+      std::allocator_arg_t, const alloc_t &alloc, args_t &&... args) {
+    assert(this);
+    (tag->destroy)(*this);
+    tag = get_null_tag();
+    return construct_elem<elem_t>(alloc, std::forward<args_t>(args)...);
   }
 
   private:
@@ -300,6 +613,10 @@ class variant_t {
      defining the instances of this type. */
   struct tag_t final {
 
+    /* The position among our elems_t of the type we handle.  The null tag
+       uses the position of null_t. */
+    size_t index;
+
     /* Move other into self and set other null. */
     void (*move_construct)(variant_t &self, variant_t &&other) noexcept;
 
@@ -338,11 +655,122 @@ class variant_t {
     return reinterpret_cast<const elem_t &>(data);
   }
 
+  /* Construct our contents as an elem_t, by uses-allocator construction,
+     and take on the tag for it.  Until then, our tag is untouched. */
+  template <typename elem_t, typename alloc_t, typename... args_t>
+  elem_t &construct_elem(const alloc_t &alloc, args_t &&... args) {
+    elem_t *elem = lib::uninitialized_construct_using_allocator(
+        &force_as<elem_t>(), alloc, std::forward<args_t>(args)...);
+    tag = std::is_same<elem_t, null_t>::value ? get_null_tag()
+                                              : get_tag<elem_t>();
+    return *elem;
+  }
+
+  /* Construct our contents from those of another variant of our type, by
+     uses-allocator construction, looking up its state in a table. */
+  template <typename alloc_t, typename that_t>
+  void construct_from(const alloc_t &alloc, that_t &&that) {
+    assert(&that);
+    static constexpr void (*const constructors[])(
+        variant_t &, const alloc_t &, that_t &&) = {
+      &construct_from_elem<elems_t, alloc_t, that_t>...
+    };
+    constructors[that.tag->index](*this, alloc, std::forward<that_t>(that));
+  }
+
+  /* An entry in the table used by construct_from(), above. */
+  template <typename elem_t, typename alloc_t, typename that_t>
+  static void construct_from_elem(variant_t &self, const alloc_t &alloc,
+                                  that_t &&that) {
+    self.construct_elem<elem_t>(
+        alloc, std::forward<that_t>(that).template force_as<elem_t>());
+  }
+
+  /* Take on the state of a variant of another type.  The donor's tag gives
+     us its index, which we look up in a remap table built at compile time.
+     Each entry knows how to carry one of the donor's types over into our
+     storage and which of our tags to use for it, so the conversion costs one
+     indirect call and a move (or copy) of the payload. */
+  template <typename that_t>
+  void convert(that_t &&that) {
+    assert(this);
+    assert(&that);
+    using donor_t = std::decay_t<that_t>;
+    convert_payload(std::forward<that_t>(that), identity<donor_t>());
+    leave_null(that,
+               std::integral_constant<
+                   bool,
+                   donor_t::template contains<null_t>::value &&
+                   !std::is_lvalue_reference<that_t>::value>());
+  }
+
+  /* Look up the donor's state in the remap table and carry it over. */
+  template <typename that_t, typename... that_elems_t>
+  void convert_payload(that_t &&that, identity<variant_t<that_elems_t...>>) {
+    static constexpr void (*const remap[])(variant_t &, that_t &&) = {
+      &remap_elem<that_elems_t, that_t>...
+    };
+    remap[that.tag->index](*this, std::forward<that_t>(that));
+  }
+
+  /* An entry in the remap table used by convert_payload(), above. */
+  template <typename elem_t, typename that_t>
+  static void remap_elem(variant_t &self, that_t &&that) {
+    assume_elem(
+        self, std::forward<that_t>(that), identity<elem_t>(), contains<elem_t>());
+  }
+
+  /* The donor holds an elem_t, which we can hold too. */
+  template <typename elem_t, typename that_t>
+  static void assume_elem(
+      variant_t &self, that_t &&that, identity<elem_t>, std::true_type) {
+    new (self.data)
+        elem_t(std::forward<that_t>(that).template force_as<elem_t>());
+    self.tag = get_tag<elem_t>();
+  }
+
+  /* The donor is null, so we become null. */
+  template <typename that_t>
+  static void assume_elem(
+      variant_t &self, that_t &&, identity<null_t>, std::true_type) {
+    self.tag = get_null_tag();
+  }
+
+  /* The donor holds an elem_t, which we can't hold. */
+  template <typename elem_t, typename that_t>
+  static void assume_elem(
+      variant_t &, that_t &&, identity<elem_t>, std::false_type) {
+    throw std::bad_cast();
+  }
+
+  /* Null a donor we've just moved from, just as our own move constructor
+     would. */
+  template <typename that_t>
+  static void leave_null(that_t &that, std::true_type) {
+    that.reset();
+  }
+
+  /* The donor was copied or can't be null, so leave it be. */
+  template <typename that_t>
+  static void leave_null(that_t &, std::false_type) {}
+
+  /* Our tags, one for each of our elems_t, in the same order.  This is
+     defined out of line, below, so that CPPCON14_VARIANT_EXTERN() can keep
+     it from being instantiated in every translation unit. */
+  static const tag_t *get_tags();
+
   /* The tag we use when we contain an instance of elem_t. */
   template <typename elem_t>
   static const tag_t *get_tag() {
-    static tag_t tag {
-      [](variant_t &self, variant_t &&other) {
+    return get_tags() + index_of<elem_t, elems_t...>();
+  }
+
+  /* Build the tag for elem_t, for use in our table of tags. */
+  template <typename elem_t>
+  static tag_t make_tag() {
+    return {
+      index_of<elem_t, elems_t...>(),  // index
+      [](variant_t &self, variant_t &&other) noexcept {
         new (self.data) elem_t(std::move(other).template force_as<elem_t>());
         make_overload<void>(
             [](std::true_type, auto &&other) { std::move(other).reset(); },
@@ -352,29 +780,31 @@ class variant_t {
       [](variant_t &self, const variant_t &other) {
         new (self.data) elem_t(other.force_as<elem_t>());
       },  // copy_construct
-      [](variant_t &self) { self.force_as<elem_t>().~elem_t(); },  // destroy
+      [](variant_t &self) noexcept {
+        self.force_as<elem_t>().~elem_t();
+      },  // destroy
       [](const variant_t &self, const visitor_t &visitor) {
-        visitor(self.force_as<elem_t>());
+        static_cast<const visitor_leaf_t<elem_t> &>(visitor)(
+            self.force_as<elem_t>());
       },  // accept
-      []() { return &typeid(elem_t); }  // get_type_info
+      []() noexcept { return &typeid(elem_t); }  // get_type_info
     };
-    return &tag;
   }
 
-  /* The tag we use iff. we're null. */
-  static const tag_t *get_null_tag() {
-    static tag_t tag {
-      [](variant_t &, variant_t &&) {},  // move_construct
-      [](variant_t &, const variant_t &) {},  // copy_construct
-      [](variant_t &) {},  // destroy
-      [](const variant_t &, const visitor_t &visitor) {
-        visitor(null_t());
-      },  // accept
-      []() -> const std::type_info * { return nullptr; }  // get_type_info
-    };
-    return &tag;
+  /* The tag we use iff. we're null.  Defined out of line, below. */
+  static const tag_t *get_null_tag();
+
+  /* Hand a null to a visitor. */
+  template <typename some_visitor_t>
+  static void accept_null(const some_visitor_t &visitor, std::true_type) {
+    static_cast<const visitor_leaf_t<null_t> &>(visitor)(null_t());
   }
 
+  /* We can't be null, so there's no handler for it.  This only exists so
+     that get_null_tag() can be explicitly instantiated for any variant. */
+  template <typename some_visitor_t>
+  static void accept_null(const some_visitor_t &, std::false_type) {}
+
   /* The tag which takes action for us.  Never null. */
   const tag_t *tag = nullptr;
 
@@ -385,169 +815,70 @@ class variant_t {
 
 };  // variant_t<elems_t...>
 
-/* ---------------------------------------------------------------------------
-As we deal with applying functors (in the next two big sections), it would be
-handy not to have to cope with differences between those which return a value
-and those which return void.  The following two function overloads unify the
-semantics of these cases by returning the result, if any, via indirection.  A
-function which returns a value must be given a non-null pointer to a location
-in which to store its result.  A function which returns void must be given a
-void pointer, which will be ignored an so can (and should) be null.
---------------------------------------------------------------------------- */
-
-template <typename some_visitor_t,
-          typename ret_t,
-          typename functor_t,
-          typename members_t,
-          typename variants_t,
-          typename... elems_t>
-class applier_t;
-
-template <typename some_visitor_t,
-          typename ret_t,
-          typename functor_t,
-          typename... members_t,
-          typename... variants_t>
-class applier_t<some_visitor_t,
-                ret_t,
-                functor_t,
-                std::tuple<const members_t &...>,
-                std::tuple<const variants_t &...>> : public some_visitor_t {
-  public:
-
-  applier_t(ret_t *ret,
-            functor_t &functor,
-            std::tuple<const members_t &...> &&members,
-            std::tuple<const variants_t &...> &&variants)
-      : functor(functor),
-        ret(ret),
-        members(std::move(members)),
-        variants(std::move(variants)) {}
-
-  functor_t &functor;
-
-  ret_t *ret;
-
-  std::tuple<const members_t &...> members;
-
-  std::tuple<const variants_t &...> variants;
-
-};  // applier_t<some_visitor_t,
-    //           ret_t,
-    //           functor_t,
-    //           members_t...,
-    //           variants_t...>
-
-template <typename some_visitor_t,
-          typename ret_t,
-          typename functor_t,
-          typename... members_t,
-          typename... variants_t,
-          typename elem_t,
-          typename... more_elems_t>
-class applier_t<some_visitor_t,
-                ret_t,
-                functor_t,
-                std::tuple<const members_t &...>,
-                std::tuple<const variants_t &...>,
-                elem_t,
-                more_elems_t...>
-    : public applier_t<some_visitor_t,
-                       ret_t,
-                       functor_t,
-                       std::tuple<const members_t &...>,
-                       std::tuple<const variants_t &...>,
-                       more_elems_t...> {
-  public:
-
-  /* Pass everything up to the base case. */
-  applier_t(ret_t *ret,
-            functor_t &functor,
-            std::tuple<const members_t &...> &&members,
-            std::tuple<const variants_t &...> &&variants)
-      : applier_t<some_visitor_t,
-                  ret_t,
-                  functor_t,
-                  std::tuple<const members_t &...>,
-                  std::tuple<const variants_t &...>,
-                  more_elems_t...>(
-            ret, functor, std::move(members), std::move(variants)) {}
-
-  /* Override of the definition in lhs_visitor_t.  This is version used
-     when the variant is non-null.  It is just a hand-off to
-     apply_tuple(), below. */
-  virtual void operator()(const elem_t &elem) const override final {
-    assert(this);
-    dispatch(std::index_sequence_for<members_t...>(),
-             elem,
-             std::index_sequence_for<variants_t...>());
-  }
+template <typename... elems_t>
+const typename variant_t<elems_t...>::tag_t *
+    variant_t<elems_t...>::get_tags() {
+  static const tag_t tags[] = { make_tag<elems_t>()... };
+  return tags;
+}
 
-  private:
+template <typename... elems_t>
+const typename variant_t<elems_t...>::tag_t *
+    variant_t<elems_t...>::get_null_tag() {
+  static const tag_t tag {
+    index_of<null_t, elems_t...>(),  // index
+    [](variant_t &, variant_t &&) noexcept {},  // move_construct
+    [](variant_t &, const variant_t &) {},  // copy_construct
+    [](variant_t &) noexcept {},  // destroy
+    [](const variant_t &, const visitor_t &visitor) {
+      accept_null(visitor, contains<null_t>());
+    },  // accept
+    []() noexcept -> const std::type_info * {
+      return nullptr;
+    }  // get_type_info
+  };
+  return &tag;
+}
 
-  template <typename... more_members_t>
-  void dispatch_impl(
-      std::tuple<const more_members_t &...> &&more_members) const {
-    make_overload<void>(
-        [&](auto *ret) {
-          *ret = lib::apply(this->functor, std::move(more_members));
-        },
-        [&](void *) { lib::apply(this->functor, std::move(more_members)); })
-      (this->ret);
-  }
+/* True iff. T is a variant_t, or derived from one. */
+template <typename... elems_t>
+std::true_type is_variant_test(const variant_t<elems_t...> *);
+std::false_type is_variant_test(const void *);
 
-  template <typename... more_members_t,
-            typename... elems_t,
-            typename... more_variants_t>
-  void dispatch_impl(std::tuple<const more_members_t &...> &&more_members,
-                     const variant_t<elems_t...> &variant,
-                     const more_variants_t &... more_variants) const {
-    using applier_t = applier_t<typename variant_t<elems_t...>::visitor_t,
-                                ret_t,
-                                functor_t,
-                                std::tuple<const more_members_t &...>,
-                                std::tuple<const more_variants_t &...>,
-                                elems_t...>;
-    assert(&variant);
-    variant.accept(applier_t(this->ret,
-                             this->functor,
-                             std::move(more_members),
-                             std::forward_as_tuple(more_variants...)));
-  }
-
-  template <size_t... i, size_t... j, size_t... k>
-  void dispatch(std::index_sequence<i...>,
-                const elem_t &elem,
-                std::index_sequence<j...>) const {
-    dispatch_impl(std::forward_as_tuple(std::get<i>(this->members)..., elem),
-                  std::get<j>(this->variants)...);
-  }
-
-};  //  applier_t<some_visitor_t,
-    //            ret_t,
-    //            functor_t,
-    //            members_t...,
-    //            variants_t...,
-    //            elem_t,
-    //            more_elems_t...>
+template <typename T>
+using is_variant = decltype(is_variant_test(std::declval<T *>()));
 
 /* ---------------------------------------------------------------------------
-A helper for picking apart a template parameter of function type.  We'll use
-explicit specializations to separate two cases: functions which return non-
-void and functions which return void.  Within each, we'll define an apply()
-function which will apply a functor to a variant, passing zero or more
-additional arguments.
+As we deal with applying functors, it would be handy not to have to cope with
+differences between those which return a value and those which return void.
+The storage for a result unifies these cases.  We call the functor by way of
+set(), which keeps the result, if any, and get() hands it back.
 --------------------------------------------------------------------------- */
 
-/* Returning non-void. */
+/* Returning non-void.  The result is constructed in place, so it needn't
+   be default-constructible or assignable. */
 template <typename ret_t>
 struct storage_t {
 
+  storage_t() noexcept {}
+
+  ~storage_t() {
+    if (full) {
+      ret.~ret_t();
+    }  // if
+  }
+
+  template <typename functor_t, typename... args_t>
+  void set(functor_t &functor, const args_t &... args) {
+    new (&ret) ret_t(functor(args...));
+    full = true;
+  }
+
   ret_t get() { return std::move(ret); }
 
-  ret_t *ptr() { return &ret; }
+  union { ret_t ret; };
 
-  ret_t ret;
+  bool full = false;
 
 };  // storage_t
 
@@ -555,32 +886,200 @@ struct storage_t {
 template <>
 struct storage_t<void> {
 
-  void get() && {}
+  template <typename functor_t, typename... args_t>
+  void set(functor_t &functor, const args_t &... args) {
+    functor(args...);
+  }
 
-  void *ptr() { return nullptr; }
+  void get() && {}
 
 };  // storage_t<void>
 
+/* ---------------------------------------------------------------------------
+Applying a functor to one or more variants.  We resolve the variants one at
+a time, left to right.  For each, we look up its state in a table of function
+pointers, one entry per type the variant can hold, built at compile time.
+The entry moves on to the next variant, remembering the type it resolved as
+a template argument.  Once every variant is resolved, we know the type of
+each one's contents, so we call the functor directly on them.
+
+Each table is built by a single pack expansion, so the depth of instantiation
+grows only with the number of variants, not with the number of types they
+hold.  Each variant costs one indirect call, and each combination of types
+costs a single small function, with no tuples or visitors in between.
+--------------------------------------------------------------------------- */
+
+template <typename ret_t, typename functor_t, typename... variants_t>
+struct applier_t final {
+
+  /* The storage for our result. */
+  using storage_t = variant::storage_t<ret_t>;
+
+  /* Apply the functor to the variants, keeping the result in ret.  This is
+     defined out of line, below, so that CPPCON14_VARIANT_EXTERN_APPLY() can
+     keep it, and the tables it pulls in, from being instantiated in every
+     translation unit. */
+  static void run(storage_t &ret,
+                  functor_t &functor,
+                  const variants_t &... variants);
+
+  /* Resolve the next variant by way of its table, or, if they've all been
+     resolved, call the functor. */
+  template <typename... resolved_t>
+  static void dispatch(storage_t &ret,
+                       functor_t &functor,
+                       const variants_t &... variants) {
+    dispatch_next<resolved_t...>(
+        ret,
+        functor,
+        std::integral_constant<bool, sizeof...(resolved_t) <
+                                         sizeof...(variants_t)>(),
+        variants...);
+  }
+
+  private:
+
+  /* There's another variant to resolve. */
+  template <typename... resolved_t>
+  static void dispatch_next(storage_t &ret,
+                            functor_t &functor,
+                            std::true_type,
+                            const variants_t &... variants) {
+    using next_t = nth_t<sizeof...(resolved_t), variants_t...>;
+    const next_t &next = std::get<sizeof...(resolved_t)>(
+        std::forward_as_tuple(variants...));
+    assert(&next);
+    get_table<resolved_t...>(identity<next_t>())[next.tag->index](
+        ret, functor, variants...);
+  }
+
+  /* Every variant has been resolved, so call the functor. */
+  template <typename... resolved_t>
+  static void dispatch_next(storage_t &ret,
+                            functor_t &functor,
+                            std::false_type,
+                            const variants_t &... variants) {
+    ret.set(functor, get_elem(variants, identity<resolved_t>())...);
+  }
+
+  /* The table for the next variant, which is a variant_t<elems_t...>. */
+  template <typename... resolved_t, typename... elems_t>
+  static auto get_table(identity<variant_t<elems_t...>>) {
+    using entry_t = void (*)(storage_t &, functor_t &, const variants_t &...);
+    static constexpr entry_t table[] = { &dispatch<resolved_t..., elems_t>... };
+    return table;
+  }
+
+  /* The contents of a variant which holds an elem_t. */
+  template <typename variant_t, typename elem_t>
+  static const elem_t &get_elem(const variant_t &variant, identity<elem_t>) {
+    return variant.template force_as<elem_t>();
+  }
+
+  /* The contents of a null variant. */
+  template <typename variant_t>
+  static const null_t &get_elem(const variant_t &, identity<null_t>) {
+    static constexpr null_t null {};
+    return null;
+  }
+
+};  // applier_t<ret_t, functor_t, variants_t...>
+
+template <typename ret_t, typename functor_t, typename... variants_t>
+void applier_t<ret_t, functor_t, variants_t...>::run(
+    storage_t &ret, functor_t &functor, const variants_t &... variants) {
+  dispatch<>(ret, functor, variants...);
+}
+
+/* Apply a functor to the variants, given as exactly their variant_t types. */
+template <typename functor_t, typename... variants_t>
+decltype(auto) apply_variants(functor_t &functor,
+                              const variants_t &... variants) {
+  using ret_t = typename std::decay_t<functor_t>::ret_t;
+  using applier_t = applier_t<ret_t, functor_t, variants_t...>;
+  typename applier_t::storage_t ret;
+  applier_t::run(ret, functor, variants...);
+  return std::move(ret).get();
+}
+
+/* A variant of any type, as exactly its variant_t type, rather than some
+   class derived from it. */
+template <typename... elems_t>
+const variant_t<elems_t...> &as_variant(const variant_t<elems_t...> &that) {
+  return that;
+}
+
 template <typename functor_t,
           typename... elems_t,
           typename... more_variants_t>
 decltype(auto) apply(functor_t &&functor,
                      const variant_t<elems_t...> &variant,
                      const more_variants_t &... more_variants) {
-  using ret_t = typename std::decay_t<functor_t>::ret_t;
-  using applier_t = applier_t<visitor_t<elems_t...>,
-                              ret_t,
-                              functor_t,
-                              std::tuple<>,
-                              std::tuple<const more_variants_t &...>,
-                              elems_t...>;
   assert(&variant);
-  storage_t<ret_t> ret;
-  variant.accept(applier_t(ret.ptr(),
-                           functor,
-                           std::forward_as_tuple(),
-                           std::forward_as_tuple(more_variants...)));
-  return std::move(ret).get();
+  return apply_variants(functor, variant, as_variant(more_variants)...);
+}
+
+/* ---------------------------------------------------------------------------
+Applying a functor which wants to know, at compile time, the position of each
+element's type among the types of its variant.  We wrap the functor in an
+adapter which looks up the positions from the resolved types and passes them
+along, then apply the adapter as usual.  The adapter inlines away, so this
+costs the same single dispatch per variant as plain apply().
+--------------------------------------------------------------------------- */
+
+/* The position of elem_t among the types of a variant_t, as a
+   std::integral_constant. */
+template <typename elem_t, typename variant_t>
+struct index_in;
+
+template <typename elem_t, typename... elems_t>
+struct index_in<elem_t, variant_t<elems_t...>> {
+  using type = std::integral_constant<size_t, index_of<elem_t, elems_t...>()>;
+};
+
+template <typename elem_t, typename variant_t>
+using index_in_t = typename index_in<elem_t, variant_t>::type;
+
+/* Wraps a functor, handing it the positions of the elements along with the
+   elements themselves.  With one variant, the position is passed as a
+   std::integral_constant; with more, as a std::tuple of them. */
+template <typename functor_t, typename... variants_t>
+struct indexed_functor_t final {
+
+  using ret_t = typename std::decay_t<functor_t>::ret_t;
+
+  template <typename elem_t>
+  ret_t operator()(const elem_t &elem) const {
+    return functor(index_in_t<elem_t, nth_t<0, variants_t...>>(), elem);
+  }
+
+  template <typename... elems_t>
+  std::enable_if_t<(sizeof...(elems_t) > 1), ret_t> operator()(
+      const elems_t &... elems) const {
+    return functor(std::tuple<index_in_t<elems_t, variants_t>...>(),
+                   elems...);
+  }
+
+  functor_t &functor;
+
+};  // indexed_functor_t<functor_t, variants_t...>
+
+/* Apply the functor to the variants, as apply() does, but pass it the
+   positions of the elements' types ahead of the elements.  That is, for one
+   variant, call functor(std::integral_constant<size_t, I>(), elem), and for
+   several, call functor(std::tuple<std::integral_constant<size_t, I>,
+   ...>(), elems...). */
+template <typename functor_t,
+          typename... elems_t,
+          typename... more_variants_t>
+decltype(auto) apply_indexed(functor_t &&functor,
+                             const variant_t<elems_t...> &variant,
+                             const more_variants_t &... more_variants) {
+  indexed_functor_t<std::remove_reference_t<functor_t>,
+                    variant_t<elems_t...>,
+                    std::decay_t<decltype(as_variant(more_variants))>...>
+      indexed{functor};
+  return apply(indexed, variant, more_variants...);
 }
 
 template <typename ret_t, typename... elems_t, typename... lambdas_t>
@@ -613,3 +1112,52 @@ decltype(auto) match(const std::tuple<variants_t...> &that,
 
 }  // variant
 }  // cppcon14
+
+namespace std {
+
+/* A variant uses allocators of a given type iff. any of its elements do, in
+   which case it takes them by way of std::allocator_arg. */
+template <typename... elems_t, typename alloc_t>
+struct uses_allocator<cppcon14::variant::variant_t<elems_t...>, alloc_t>
+    : cppcon14::variant::any_of<uses_allocator<elems_t, alloc_t>::value...> {};
+
+}  // std
+
+/* ---------------------------------------------------------------------------
+Cutting rebuild times.  Every translation unit which uses a variant normally
+instantiates its tags, and every translation unit which applies a functor to
+some variants instantiates the dispatch tables for that combination.  In a
+large build, most of that work is thrown away by the linker.
+
+To do it just once, declare the instantiations extern in the header which
+defines your variant, after the definition and at global scope:
+
+  CPPCON14_VARIANT_EXTERN(int, std::string, null_t);
+  CPPCON14_VARIANT_EXTERN_APPLY(my_functor_t, my_variant_t);
+
+and then, in exactly one .cc file, instantiate them:
+
+  CPPCON14_VARIANT_INSTANTIATE(int, std::string, null_t);
+  CPPCON14_VARIANT_INSTANTIATE_APPLY(my_functor_t, my_variant_t);
+
+The variants named in the _APPLY macros must be exactly variant_t types, not
+classes derived from them, and the functor must be given exactly as apply()
+sees it; that is, const if you apply a const functor (such as *this within a
+const member function).  The _APPLY macros can't take a functor whose type
+has a comma in it, so use an alias for one of those.  See "calc.h" and
+"calc.cc" for an example.
+--------------------------------------------------------------------------- */
+
+#define CPPCON14_VARIANT_EXTERN(...)  \
+    extern template class ::cppcon14::variant::variant_t<__VA_ARGS__>
+
+#define CPPCON14_VARIANT_INSTANTIATE(...)  \
+    template class ::cppcon14::variant::variant_t<__VA_ARGS__>
+
+#define CPPCON14_VARIANT_EXTERN_APPLY(functor_t, ...)  \
+    extern template struct ::cppcon14::variant::applier_t<  \
+        std::decay_t<functor_t>::ret_t, functor_t, __VA_ARGS__>
+
+#define CPPCON14_VARIANT_INSTANTIATE_APPLY(functor_t, ...)  \
+    template struct ::cppcon14::variant::applier_t<  \
+        std::decay_t<functor_t>::ret_t, functor_t, __VA_ARGS__>
@@ -117,6 +117,32 @@ FIXTURE(try_as_null) {
   EXPECT_FALSE(c.try_as<int>());
 }
 
+FIXTURE(get_index) {
+  int_or_str_or_null_t a, b(101), c(hello);
+  EXPECT_EQ(a.get_index(), 2u);
+  EXPECT_EQ(b.get_index(), 0u);
+  EXPECT_EQ(c.get_index(), 1u);
+}
+
+FIXTURE(try_as_mutable) {
+  int_or_str_or_null_t a(101);
+  if (EXPECT_TRUE(a.try_as<int>())) {
+    *a.try_as<int>() = 202;
+  }
+  EXPECT_EQ(a.as<int>(), 202);
+  EXPECT_FALSE(a.try_as<string>());
+}
+
+FIXTURE(emplace) {
+  int_or_str_or_null_t a(101);
+  EXPECT_EQ(a.emplace<string>(3, 'x'), "xxx");
+  EXPECT_EQ(a.as<string>(), "xxx");
+  a.emplace<null_t>();
+  EXPECT_FALSE(a);
+  a.emplace<int>(303);
+  EXPECT_EQ(a.as<int>(), 303);
+}
+
 FIXTURE(reset_null) {
   int_or_str_or_null_t a = hello;
   EXPECT_TRUE(a);
@@ -452,3 +478,156 @@ FIXTURE(pair_writer_non_null) {
   int_or_str_t lhs(101), rhs(202);
   EXPECT_EQ(apply(pair_writer_non_null_t(), lhs, rhs), "101, 202");
 }
+
+/**
+ *   Conversion between variants.
+ **/
+
+/* The same states as int_or_str_t, but in a different order. */
+using str_or_int_t = variant_t<string, int>;
+
+FIXTURE(widening_copy_ctor) {
+  int_or_str_t a = hello;
+  int_or_str_or_null_t b = a;
+  EXPECT_EQ(a.as<string>(), hello);
+  if (EXPECT_TRUE(b)) {
+    EXPECT_EQ(b.as<string>(), hello);
+  }
+  str_or_int_t c = a;
+  EXPECT_EQ(c.as<string>(), hello);
+}
+
+FIXTURE(widening_move_ctor) {
+  int_or_str_t a = hello;
+  int_or_str_or_null_t b = move(a);
+  if (EXPECT_TRUE(b)) {
+    EXPECT_EQ(b.as<string>(), hello);
+  }
+  int_or_str_or_null_t c = int_or_str_t(101);
+  if (EXPECT_TRUE(c)) {
+    EXPECT_EQ(c.as<int>(), 101);
+  }
+}
+
+FIXTURE(widening_assign) {
+  int_or_str_t a = hello, b = 101;
+  int_or_str_or_null_t c;
+  c = a;
+  if (EXPECT_TRUE(c)) {
+    EXPECT_EQ(c.as<string>(), hello);
+  }
+  c = move(b);
+  if (EXPECT_TRUE(c)) {
+    EXPECT_EQ(c.as<int>(), 101);
+  }
+}
+
+FIXTURE(narrowing_ctor) {
+  int_or_str_or_null_t a = hello, b;
+  int_or_str_t c(a);
+  EXPECT_EQ(c.as<string>(), hello);
+  int_or_str_t d(move(a));
+  EXPECT_EQ(d.as<string>(), hello);
+  EXPECT_FALSE(a);
+  bool caught = false;
+  try {
+    int_or_str_t e(b);
+  } catch (const bad_cast &) {
+    caught = true;
+  }
+  EXPECT_TRUE(caught);
+}
+
+/**
+ *   Many alternatives.
+ **/
+
+/* A variant with more alternatives than lambdas fit in a single node of
+   the overload tree. */
+using many_t = variant_t<int, string, double, char, bool, null_t>;
+
+FIXTURE(match_many) {
+  auto describe = [](const many_t &that) {
+    return match<string>(that,
+                         [](int) { return "int"; },
+                         [](const string &) { return "string"; },
+                         [](double) { return "double"; },
+                         [](char) { return "char"; },
+                         [](bool) { return "bool"; },
+                         [](null_t) { return "null"; });
+  };
+  EXPECT_EQ(describe(many_t(101)), "int");
+  EXPECT_EQ(describe(many_t(hello)), "string");
+  EXPECT_EQ(describe(many_t(1.5)), "double");
+  EXPECT_EQ(describe(many_t('x')), "char");
+  EXPECT_EQ(describe(many_t(true)), "bool");
+  EXPECT_EQ(describe(many_t()), "null");
+}
+
+FIXTURE(match_returns_non_default_constructible) {
+  using int_or_str_t = variant_t<int, string>;
+  auto swap_kind = [](const int_or_str_t &that) {
+    return match<int_or_str_t>(
+        that, [](int val) { return int_or_str_t(to_string(val)); },
+        [](const string &val) { return int_or_str_t(stoi(val)); });
+  };
+  EXPECT_EQ(swap_kind(int_or_str_t(101)).as<string>(), "101");
+  EXPECT_EQ(swap_kind(int_or_str_t(string("202"))).as<int>(), 202);
+}
+
+/* Writes down the position and value of what it's handed. */
+struct positioner_t final {
+  using ret_t = string;
+  template <size_t idx, typename elem_t>
+  string operator()(integral_constant<size_t, idx>, const elem_t &) const {
+    return to_string(idx);
+  }
+  template <size_t lhs_idx, size_t rhs_idx, typename lhs_t, typename rhs_t>
+  string operator()(tuple<integral_constant<size_t, lhs_idx>,
+                          integral_constant<size_t, rhs_idx>>,
+                    const lhs_t &, const rhs_t &) const {
+    return to_string(lhs_idx) + "," + to_string(rhs_idx);
+  }
+};
+
+FIXTURE(apply_indexed) {
+  EXPECT_EQ(apply_indexed(positioner_t(), int_or_str_or_null_t(101)), "0");
+  EXPECT_EQ(apply_indexed(positioner_t(), int_or_str_or_null_t(hello)), "1");
+  EXPECT_EQ(apply_indexed(positioner_t(), int_or_str_or_null_t()), "2");
+  /* The index is a constant, usable as a template argument. */
+  size_t sizes[3] = {};
+  auto counter = make_overload<void>([&sizes](auto idx, const auto &) {
+    ++get<decltype(idx)::value>(tie(sizes[0], sizes[1], sizes[2]));
+  });
+  apply_indexed(counter, int_or_str_or_null_t(hello));
+  EXPECT_EQ(sizes[1], 1u);
+}
+
+FIXTURE(apply_indexed_binary) {
+  EXPECT_EQ(apply_indexed(positioner_t(), int_or_str_or_null_t(hello),
+                          int_or_str_or_null_t()),
+            "1,2");
+  EXPECT_EQ(apply_indexed(positioner_t(), int_or_str_or_null_t(101),
+                          variant_t<double, int>(1.5)),
+            "0,0");
+}
+
+/* A hand-written visitor, accepted directly rather than applied. */
+struct namer_t final : int_or_str_or_null_t::visitor_t {
+  virtual void operator()(const int &) const override { *name = "int"; }
+  virtual void operator()(const string &) const override { *name = "string"; }
+  virtual void operator()(const null_t &) const override { *name = "null"; }
+  string *name;
+};
+
+FIXTURE(accept_visitor) {
+  string name;
+  namer_t namer;
+  namer.name = &name;
+  int_or_str_or_null_t(101).accept(namer);
+  EXPECT_EQ(name, "int");
+  int_or_str_or_null_t(hello).accept(namer);
+  EXPECT_EQ(name, "string");
+  int_or_str_or_null_t().accept(namer);
+  EXPECT_EQ(name, "null");
+}
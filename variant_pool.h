@@ -0,0 +1,425 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+A pool of heterogeneous objects, referred to by generational handles.
+
+Each of the pool's types gets its own slab, which grows in fixed-size chunks
+and so never moves the objects it holds.  A handle names a type, a cell in
+that type's slab, and the generation of the cell at the time the handle was
+issued.  Erasing an object bumps the generation of its cell, so a dangling
+handle is detected with a single comparison.
+
+See "variant_pool.test.cc" for examples of use.
+--------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "variant.h"
+
+namespace cppcon14 {
+namespace variant {
+
+/* A pool of objects of the given types. */
+template <typename... elems_t>
+class variant_pool_t final {
+  public:
+
+  /* We keep the index of the type in the top 8 bits of a handle. */
+  static_assert(sizeof...(elems_t) <= 256, "Too many types for a pool.");
+
+  /* The number of cells in each chunk of a slab.  Must be a power of 2. */
+  static constexpr size_t chunk_size = 4096;
+
+  /* Names an object in the pool.  A default-constructed handle names
+     nothing. */
+  class handle_t final {
+    public:
+
+    /* A handle to nothing. */
+    handle_t() noexcept : cell(UINT32_MAX), type_and_gen(0) {}
+
+    /* The index among elems_t of the type of object we name. */
+    size_t get_index() const noexcept {
+      assert(this);
+      return type_and_gen >> 24;
+    }
+
+    /* True iff. the handles name the same object. */
+    bool operator==(const handle_t &that) const noexcept {
+      assert(this);
+      assert(&that);
+      return cell == that.cell && type_and_gen == that.type_and_gen;
+    }
+
+    /* True iff. the handles name different objects. */
+    bool operator!=(const handle_t &that) const noexcept {
+      return !(*this == that);
+    }
+
+    private:
+
+    /* Cache the parts. */
+    handle_t(size_t index, uint32_t cell, uint32_t gen) noexcept
+        : cell(cell),
+          type_and_gen(static_cast<uint32_t>(index << 24) | gen) {}
+
+    /* The generation of the cell at the time we were issued. */
+    uint32_t get_gen() const noexcept {
+      assert(this);
+      return type_and_gen & gen_mask;
+    }
+
+    /* The index of our cell within its slab. */
+    uint32_t cell;
+
+    /* The index of our type (top 8 bits) and our generation (the rest). */
+    uint32_t type_and_gen;
+
+    friend class variant_pool_t;
+
+  };  // handle_t
+
+  /* No copying or moving. */
+  variant_pool_t(const variant_pool_t &) = delete;
+  variant_pool_t &operator=(const variant_pool_t &) = delete;
+
+  /* An empty pool. */
+  variant_pool_t() = default;
+
+  /* Construct a new elem_t in the pool and return a handle to it.
+     Amortized O(1); never moves an existing object. */
+  template <typename elem_t, typename... args_t>
+  handle_t emplace(args_t &&... args) {
+    assert(this);
+    constexpr size_t index = index_of<elem_t, elems_t...>();
+    static_assert(index < sizeof...(elems_t), "Type not in pool.");
+    auto &slab = std::get<index>(slabs);
+    uint32_t cell = slab.alloc(std::forward<args_t>(args)...);
+    return handle_t(index, cell, slab.get_gen(cell));
+  }
+
+  /* Copy the contents of a variant into the pool and return a handle to
+     the new object. */
+  handle_t insert(const variant_t<elems_t...> &that) {
+    assert(this);
+    return apply(inserter_t{*this}, that);
+  }
+
+  /* Destroy the object named by the handle.  Returns false, and does
+     nothing, if the handle is dangling. */
+  bool erase(handle_t handle) {
+    assert(this);
+    static constexpr bool (*const erasers[])(variant_pool_t &, handle_t) = {
+      &erase_as<elems_t>...
+    };
+    return handle.cell != UINT32_MAX &&
+           erasers[handle.get_index()](*this, handle);
+  }
+
+  /* True iff. the handle names an object still in the pool. */
+  bool contains(handle_t handle) const noexcept {
+    assert(this);
+    static constexpr bool (*const checkers[])(const variant_pool_t &,
+                                              handle_t) = {
+      &contains_as<elems_t>...
+    };
+    return handle.cell != UINT32_MAX &&
+           checkers[handle.get_index()](*this, handle);
+  }
+
+  /* The object named by the handle, or a null pointer if the handle is
+     dangling or names an object of another type. */
+  template <typename elem_t>
+  elem_t *try_get(handle_t handle) noexcept {
+    assert(this);
+    constexpr size_t index = index_of<elem_t, elems_t...>();
+    static_assert(index < sizeof...(elems_t), "Type not in pool.");
+    auto &slab = std::get<index>(slabs);
+    return (handle.get_index() == index &&
+            slab.is_live(handle.cell, handle.get_gen()))
+               ? &slab.at(handle.cell)
+               : nullptr;
+  }
+
+  /* The object named by the handle, or a null pointer if the handle is
+     dangling or names an object of another type. */
+  template <typename elem_t>
+  const elem_t *try_get(handle_t handle) const noexcept {
+    return const_cast<variant_pool_t *>(this)->template try_get<elem_t>(handle);
+  }
+
+  /* Call fn on each elem_t in the pool, in the order of the cells of the
+     slab.  Objects of other types are never touched, so the loop stays in
+     the one slab and fn is called directly, without dispatching. */
+  template <typename elem_t, typename fn_t>
+  void for_each(fn_t &&fn) {
+    assert(this);
+    std::get<index_of<elem_t, elems_t...>()>(slabs).for_each(fn);
+  }
+
+  /* Call fn on each elem_t in the pool, in the order of the cells of the
+     slab. */
+  template <typename elem_t, typename fn_t>
+  void for_each(fn_t &&fn) const {
+    assert(this);
+    std::get<index_of<elem_t, elems_t...>()>(slabs).for_each(fn);
+  }
+
+  /* Call fn on every object in the pool, one slab at a time. */
+  template <typename fn_t>
+  void for_each_all(fn_t &&fn) {
+    assert(this);
+    (void)std::initializer_list<int>{ (for_each<elems_t>(fn), 0)... };
+  }
+
+  /* The number of objects in the pool. */
+  size_t size() const noexcept {
+    assert(this);
+    return size_impl(std::index_sequence_for<elems_t...>());
+  }
+
+  /* The number of elem_t in the pool. */
+  template <typename elem_t>
+  size_t size() const noexcept {
+    assert(this);
+    return std::get<index_of<elem_t, elems_t...>()>(slabs).get_size();
+  }
+
+  private:
+
+  /* The bits of a handle which hold the generation. */
+  static constexpr uint32_t gen_mask = (1u << 24) - 1;
+
+  /* Marks the end of a slab's free list. */
+  static constexpr uint32_t no_cell = UINT32_MAX;
+
+  /* The storage for one type of object. */
+  template <typename elem_t>
+  class slab_t final {
+    public:
+
+    /* No copying or moving. */
+    slab_t(const slab_t &) = delete;
+    slab_t &operator=(const slab_t &) = delete;
+
+    /* An empty slab. */
+    slab_t() = default;
+
+    /* Destroy whatever we still hold. */
+    ~slab_t() {
+      auto destroy = [](elem_t &elem) { elem.~elem_t(); };
+      for_each(destroy);
+    }
+
+    /* Construct an elem_t in a free cell, growing by a chunk if there isn't
+       one, and return the index of the cell. */
+    template <typename... args_t>
+    uint32_t alloc(args_t &&... args) {
+      assert(this);
+      if (free_head == no_cell) {
+        grow();
+      }  // if
+      uint32_t idx = free_head;
+      cell_t &cell = get_cell(idx);
+      new (cell.data) elem_t(std::forward<args_t>(args)...);
+      free_head = cell.next_free;
+      cell.live = true;
+      ++size;
+      return idx;
+    }
+
+    /* Destroy the elem_t in a cell, if the given generation is current,
+       and put the cell on the free list. */
+    bool free(uint32_t idx, uint32_t gen) {
+      assert(this);
+      if (!is_live(idx, gen)) {
+        return false;
+      }  // if
+      cell_t &cell = get_cell(idx);
+      reinterpret_cast<elem_t &>(cell.data).~elem_t();
+      cell.live = false;
+      cell.gen = (cell.gen + 1) & gen_mask;
+      cell.next_free = free_head;
+      free_head = idx;
+      --size;
+      return true;
+    }
+
+    /* True iff. the cell holds an object of the given generation. */
+    bool is_live(uint32_t idx, uint32_t gen) const noexcept {
+      assert(this);
+      if (idx >= chunks.size() * chunk_size) {
+        return false;
+      }  // if
+      const cell_t &cell = get_cell(idx);
+      return cell.live && cell.gen == gen;
+    }
+
+    /* The current generation of a cell. */
+    uint32_t get_gen(uint32_t idx) const noexcept {
+      assert(this);
+      return get_cell(idx).gen;
+    }
+
+    /* The object in a live cell. */
+    elem_t &at(uint32_t idx) noexcept {
+      assert(this);
+      return reinterpret_cast<elem_t &>(get_cell(idx).data);
+    }
+
+    /* Call fn on each live object, chunk by chunk. */
+    template <typename fn_t>
+    void for_each(fn_t &fn) {
+      assert(this);
+      for (auto &chunk : chunks) {
+        for (size_t i = 0; i < chunk_size; ++i) {
+          cell_t &cell = chunk[i];
+          if (cell.live) {
+            fn(reinterpret_cast<elem_t &>(cell.data));
+          }  // if
+        }  // for
+      }  // for
+    }
+
+    /* Call fn on each live object, chunk by chunk. */
+    template <typename fn_t>
+    void for_each(fn_t &fn) const {
+      assert(this);
+      for (const auto &chunk : chunks) {
+        for (size_t i = 0; i < chunk_size; ++i) {
+          const cell_t &cell = chunk[i];
+          if (cell.live) {
+            fn(reinterpret_cast<const elem_t &>(cell.data));
+          }  // if
+        }  // for
+      }  // for
+    }
+
+    /* The number of live objects. */
+    size_t get_size() const noexcept {
+      assert(this);
+      return size;
+    }
+
+    private:
+
+    /* A place for one object, plus the bookkeeping to go with it. */
+    struct cell_t final {
+
+      /* The object itself, when live. */
+      alignas(elem_t) char data[sizeof(elem_t)];
+
+      /* Bumped each time the object in this cell is destroyed. */
+      uint32_t gen = 0;
+
+      /* The next cell on the free list, when not live. */
+      uint32_t next_free;
+
+      /* True iff. data holds an object. */
+      bool live = false;
+
+    };  // cell_t
+
+    /* Add a chunk and thread its cells onto the free list, lowest index
+       first, so we fill the chunk in order. */
+    void grow() {
+      assert(this);
+      uint32_t base = static_cast<uint32_t>(chunks.size() * chunk_size);
+      chunks.emplace_back(new cell_t[chunk_size]);
+      cell_t *chunk = chunks.back().get();
+      for (size_t i = 0; i < chunk_size; ++i) {
+        chunk[i].next_free = (i + 1 < chunk_size)
+                                 ? static_cast<uint32_t>(base + i + 1)
+                                 : free_head;
+      }  // for
+      free_head = base;
+    }
+
+    /* The cell at the given index. */
+    cell_t &get_cell(uint32_t idx) noexcept {
+      return chunks[idx / chunk_size][idx % chunk_size];
+    }
+
+    /* The cell at the given index. */
+    const cell_t &get_cell(uint32_t idx) const noexcept {
+      return chunks[idx / chunk_size][idx % chunk_size];
+    }
+
+    /* Our chunks.  Growing this vector moves only the pointers. */
+    std::vector<std::unique_ptr<cell_t[]>> chunks;
+
+    /* The first free cell, or no_cell if there isn't one. */
+    uint32_t free_head = no_cell;
+
+    /* The number of live objects. */
+    size_t size = 0;
+
+  };  // slab_t<elem_t>
+
+  /* Used by insert() to copy an element out of a variant. */
+  struct inserter_t final {
+
+    using ret_t = handle_t;
+
+    template <typename elem_t>
+    handle_t operator()(const elem_t &elem) const {
+      return pool.template emplace<elem_t>(elem);
+    }
+
+    variant_pool_t &pool;
+
+  };  // inserter_t
+
+  /* An entry in the table used by erase(). */
+  template <typename elem_t>
+  static bool erase_as(variant_pool_t &self, handle_t handle) {
+    return std::get<index_of<elem_t, elems_t...>()>(self.slabs)
+        .free(handle.cell, handle.get_gen());
+  }
+
+  /* An entry in the table used by contains(). */
+  template <typename elem_t>
+  static bool contains_as(const variant_pool_t &self, handle_t handle) {
+    return std::get<index_of<elem_t, elems_t...>()>(self.slabs)
+        .is_live(handle.cell, handle.get_gen());
+  }
+
+  /* Sum the sizes of our slabs. */
+  template <size_t... i>
+  size_t size_impl(std::index_sequence<i...>) const noexcept {
+    size_t result = 0;
+    (void)std::initializer_list<int>{
+        (result += std::get<i>(slabs).get_size(), 0)... };
+    return result;
+  }
+
+  /* One slab per type. */
+  std::tuple<slab_t<elems_t>...> slabs;
+
+};  // variant_pool_t<elems_t...>
+
+}  // variant
+}  // cppcon14
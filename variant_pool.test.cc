@@ -0,0 +1,98 @@
+/* ---------------------------------------------------------------------------
+Copyright 2014
+  Jason Lucas (JasonL9000@gmail.com) and
+  Michael Park (mcypark@gmail.com).
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+  HTTP://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Unit tests for and examples of variant_pool_t.
+--------------------------------------------------------------------------- */
+
+#include "variant_pool.h"
+
+#include <string>
+
+#include "lick.h"
+
+using namespace std;
+using namespace cppcon14::variant;
+
+/* A pool of ints and strings. */
+using pool_t = variant_pool_t<int, string>;
+
+FIXTURE(pool_emplace) {
+  pool_t pool;
+  auto a = pool.emplace<int>(101);
+  auto b = pool.emplace<string>("hello");
+  EXPECT_EQ(pool.size(), 2u);
+  EXPECT_EQ(a.get_index(), 0u);
+  EXPECT_EQ(b.get_index(), 1u);
+  if (EXPECT_TRUE(pool.try_get<int>(a))) {
+    EXPECT_EQ(*pool.try_get<int>(a), 101);
+  }
+  if (EXPECT_TRUE(pool.try_get<string>(b))) {
+    EXPECT_EQ(*pool.try_get<string>(b), "hello");
+  }
+  EXPECT_FALSE(pool.try_get<string>(a));
+  EXPECT_FALSE(pool.try_get<int>(b));
+}
+
+FIXTURE(pool_insert) {
+  pool_t pool;
+  auto a = pool.insert(variant_t<int, string>(string("doctor")));
+  if (EXPECT_TRUE(pool.try_get<string>(a))) {
+    EXPECT_EQ(*pool.try_get<string>(a), "doctor");
+  }
+}
+
+FIXTURE(pool_dangling) {
+  pool_t pool;
+  pool_t::handle_t nothing;
+  EXPECT_FALSE(pool.contains(nothing));
+  EXPECT_FALSE(pool.erase(nothing));
+  auto a = pool.emplace<string>("hello");
+  EXPECT_TRUE(pool.contains(a));
+  EXPECT_TRUE(pool.erase(a));
+  EXPECT_FALSE(pool.contains(a));
+  EXPECT_FALSE(pool.erase(a));
+  EXPECT_FALSE(pool.try_get<string>(a));
+  /* The cell is reused, but the old handle still dangles. */
+  auto b = pool.emplace<string>("doctor");
+  EXPECT_TRUE(a != b);
+  EXPECT_FALSE(pool.try_get<string>(a));
+  EXPECT_TRUE(pool.try_get<string>(b));
+}
+
+FIXTURE(pool_stable) {
+  pool_t pool;
+  auto a = pool.emplace<int>(0);
+  const int *ptr = pool.try_get<int>(a);
+  for (int i = 1; i < 10000; ++i) {
+    pool.emplace<int>(i);
+  }
+  EXPECT_TRUE(ptr == pool.try_get<int>(a));
+  EXPECT_EQ(pool.size<int>(), 10000u);
+}
+
+FIXTURE(pool_for_each) {
+  pool_t pool;
+  auto a = pool.emplace<int>(1);
+  pool.emplace<int>(2);
+  pool.emplace<int>(3);
+  pool.emplace<string>("hello");
+  pool.erase(a);
+  int sum = 0;
+  pool.for_each<int>([&](int that) { sum += that; });
+  EXPECT_EQ(sum, 5);
+  size_t count = 0;
+  pool.for_each_all([&](const auto &) { ++count; });
+  EXPECT_EQ(count, 3u);
+}